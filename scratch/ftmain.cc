@@ -14,6 +14,7 @@
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/queue.h"
 #include "ns3/drop-tail-queue.h"
+#include "ns3/error-model.h"
 #include "ns3/config-store-module.h"
 
 #include <tuple>
@@ -67,6 +68,45 @@ int SEED = 424244;
 // used to increase(multiply) all bandwidths by (PACKET_SIZE+HEADER_SIZE)/PACKET_SIZE
 int HEADER_SIZE = 30;
 
+// keep the routes built by CreateRouting() in dataPath/routing.fib and load them from
+// there in later runs; the file is rebuilt when graph.txt or routing.txt change
+bool USE_FIB_SNAPSHOT = false;
+
+// attach the output interfaces of its path to every packet (FtSourceRouteTag) instead of
+// installing the routes of CreateRouting(); transit nodes forward without a lookup
+bool USE_SOURCE_ROUTING = false;
+
+// install label switched paths (FtLabelTag swapped at every hop) instead of the flow routes
+// of CreateRouting(); a hop indexes its label table instead of searching the flowId
+bool USE_LABEL_SWITCHING = false;
+
+// seconds the labels of the old path of a rerouted flow stay installed; must cover the queueing
+// and propagation delay of the path, a label freed earlier may be allocated to another path
+double LABEL_DRAIN_TIME = 1;
+
+// with flow routes, give every hop a backup next hop towards a later node of its path, taken
+// in place of the route while its link is down (edge events with bandwidth 0)
+bool USE_FAST_REROUTE = false;
+
+// number of packet departures every FtOnOffApplication draws at once; the packets of such a
+// train due within BURST_WINDOW are sent by one event, 1 keeps one event per packet.  The
+// events are divided by about BURST_WINDOW / packet time (at most BURST_SIZE), so a train
+// saves events only with a window of several packet times
+int BURST_SIZE = 1;
+
+// how early (in seconds) a packet of a train may be sent; 0 is one packet time at the rate
+// of the application, which keeps one event per CBR packet; larger windows send fewer
+// events but make the traffic burstier
+double BURST_WINDOW = 0;
+
+// generate the traffic of each demand with one FtMultiPathSource sending on all its paths,
+// instead of one FtOnOffApplication per path; sinks stay one per path
+bool USE_MULTI_PATH_SOURCE = false;
+
+// classify packets by their UDP destination port, which is the flowId of the path (see
+// CreateApplications), instead of searching the FtTag; needs every flowId below 65536
+bool USE_PORT_FLOW_ID = false;
+
 
 // increase(multiply) all bandwidths (initial and after events) by the returned value
 // in order to take into account HEADER_SIZE
@@ -318,6 +358,16 @@ std::vector<int> event_app_flowid;
 // dataRate value onOff app dataRate change event;
 // same units as in initial state are assumed 
 std::vector<double> event_app_datarate;
+// number of events moving a flow to another path (optional section of the events file)
+int no_route_events;
+// time of reroute event; in seconds
+std::vector<double> event_route_time;
+// flowId of reroute event
+std::vector<int> event_route_flowid;
+// new path of reroute event as list of pairs, pair = {node id, output interface}
+std::vector<std::vector<std::pair<int, int>>> event_route_output_interfaces;
+// new path of reroute event as list of edge ids
+std::vector<std::vector<int>> event_route_edge_ids;
 
 
 // read events and fill appropriate events structeres
@@ -351,6 +401,32 @@ ReadEvents(std::string filePath)
       //NS_LOG_INFO(event_app_time[appEventId] << " " << event_app_flowid[appEventId] << " " << event_app_datarate[appEventId]);
     }
 
+    // reroute events: time flowId noVertices, then one "edgeId vertexId outputInterface"
+    // line per vertex as in the paths file; older events files end before this section
+    if(!(fileStream >> no_route_events)){
+      no_route_events = 0;
+    }
+    event_route_time.resize(no_route_events);
+    event_route_flowid.resize(no_route_events);
+    event_route_output_interfaces.resize(no_route_events);
+    event_route_edge_ids.resize(no_route_events);
+    for(int routeEventId = 0; routeEventId < no_route_events; ++routeEventId){
+      int curNoVerticiesInPath;
+      fileStream >> event_route_time[routeEventId];
+      fileStream >> event_route_flowid[routeEventId];
+      fileStream >> curNoVerticiesInPath;
+      event_route_output_interfaces[routeEventId].resize(curNoVerticiesInPath);
+      event_route_edge_ids[routeEventId].resize(curNoVerticiesInPath);
+      for(int vertexId = 0; vertexId < curNoVerticiesInPath; ++vertexId){
+        int curEdgeId;
+        int curVertexId;
+        int curOutputInterfaceId;
+        fileStream >> curEdgeId >> curVertexId >> curOutputInterfaceId;
+        event_route_output_interfaces[routeEventId][vertexId] = std::make_pair(curVertexId, curOutputInterfaceId);
+        event_route_edge_ids[routeEventId][vertexId] = curEdgeId;
+      }
+    }
+
     fileStream.close();
   }else{
     NS_LOG_INFO("--- ERROR: Events FILE NOT OPENED!!!");
@@ -375,10 +451,18 @@ InternetStackHelper internetStack;
 // ptrs to FtOnOffApplications for each demand and path;
 // filled in CreateApplications(), used later in events
 std::vector<std::vector<Ptr<Application>>> demandPathOnOffApps;
+// ptrs to FtMultiPathSources for each demand, used instead of demandPathOnOffApps
+// with USE_MULTI_PATH_SOURCE; the path index of a source is the pathId
+std::vector<Ptr<FtMultiPathSource>> demandMultiPathSources;
 // ptrs to PacketSink apps for each demand and path; 
 // filled in CreateApplications(), 
 // used later in events and getting stats of recieved bytes
 std::vector<std::vector<Ptr<Application>>> demandPathSinkApps;
+// label of the first hop of each demand and path;
+// filled in CreateLabelRouting(), used in CreateApplications()
+std::vector<std::vector<uint32_t>> demandPathLabels;
+// true for the edges taken down by an edge event, access by edgeId
+std::vector<bool> edgeDown;
 //////////////////////// end simulation structures
 
 
@@ -431,77 +515,258 @@ CreateEdges()
 }
 
 
+// get ipv4 address, that is assigned to the net device of demandId destination node and
+// at the same time belongs to last edge of pathId; used to create traffic generating apps
+Ipv4Address
+GetDestinationAddress(int demandId, int pathId)
+{
+  int pathLength = demand_path_no_vertices[demandId][pathId];
+  int lastEdgeId = demand_path_edge_ids[demandId][pathId][pathLength - 1];
+  Ipv4Address toAddress = (edges[lastEdgeId].first == demand_to[demandId]) ? 
+                          ipv4InterfaceContainers[lastEdgeId].GetAddress(0) :
+                          ipv4InterfaceContainers[lastEdgeId].GetAddress(1);
+  return toAddress; 
+}
+
+
+// address of the node at the other end of edgeId, seen from vertexId; next hop of a path
+Ipv4Address
+GetNextHopAddress(int edgeId, int vertexId)
+{
+  // if current nodeId == first node of cur edge, then we need second nodeId as next hop
+  return (edges[edgeId].first == vertexId) ?
+         ipv4InterfaceContainers[edgeId].GetAddress(1) :
+         ipv4InterfaceContainers[edgeId].GetAddress(0);
+}
+
+
+// routing table entries of the current path of pathId, one per vertex, towards destinationAddress
+std::vector<FtIpv4StaticRoutingHelper::FlowRoute>
+GetPathFlowRoutes(int demandId, int pathId, Ipv4Address destinationAddress)
+{
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> flowRoutes;
+  int curFlowId = demand_path_flowids[demandId][pathId];
+  int curPathLength = demand_path_edge_ids[demandId][pathId].size();
+  //vertexId - only for iteration throw each vertex in current path; 0,1,...,pathSize-1; used also for edge iterating
+  //curVertexId - actual nodeId
+  for(int vertexId = 0; vertexId < curPathLength; ++vertexId){
+    int curVertexId = demand_path_output_interfaces[demandId][pathId][vertexId].first;
+    int curOutputInterfaceId = demand_path_output_interfaces[demandId][pathId][vertexId].second;
+    int curPathEdgeId = demand_path_edge_ids[demandId][pathId][vertexId];
+    Ipv4Address curToAddress = GetNextHopAddress(curPathEdgeId, curVertexId);
+
+    FtIpv4StaticRoutingHelper::FlowRoute flowRoute;
+    flowRoute.flowId = curFlowId;
+    flowRoute.node = nodes.Get(curVertexId);
+    flowRoute.dest = destinationAddress;
+    flowRoute.nextHop = curToAddress;
+    flowRoute.interface = curOutputInterfaceId;
+    flowRoutes.push_back(flowRoute);
+    NS_LOG_INFO(curPathEdgeId << " " << curVertexId << " " << curOutputInterfaceId);
+    NS_LOG_INFO("---routing entry:" << curFlowId << " " << destinationAddress << " " << curToAddress << " " << curOutputInterfaceId);
+  }
+  return flowRoutes;
+}
+
+
+// output interface index of edgeId on vertexId
+uint32_t
+GetEdgeInterface(int edgeId, int vertexId)
+{
+  Ptr<NetDevice> device = (edges[edgeId].first == vertexId) ?
+                          netDeviceContainers[edgeId].Get(0) :
+                          netDeviceContainers[edgeId].Get(1);
+  return nodes.Get(vertexId)->GetObject<Ipv4>()->GetInterfaceForDevice(device);
+}
+
+
+// backup next hops of the current path of pathId: every vertex that has an edge, other than
+// the one of its path, to a node further down the path (or to the destination) gets that edge
+// as backup; the nearest such node is taken, it forwards the flow on the rest of the path
+std::vector<FtIpv4StaticRoutingHelper::FlowRoute>
+GetPathBackupRoutes(int demandId, int pathId, Ipv4Address destinationAddress, const std::vector<std::vector<int>> & nodeEdges)
+{
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> backupRoutes;
+  int curFlowId = demand_path_flowids[demandId][pathId];
+  int curPathLength = demand_path_edge_ids[demandId][pathId].size();
+  // position of each node on the path, the destination node being at curPathLength
+  std::vector<int> pathPosition(V, -1);
+  for(int vertexId = 0; vertexId < curPathLength; ++vertexId){
+    pathPosition[demand_path_output_interfaces[demandId][pathId][vertexId].first] = vertexId;
+  }
+  pathPosition[demand_to[demandId]] = curPathLength;
+  for(int vertexId = 0; vertexId < curPathLength; ++vertexId){
+    int curVertexId = demand_path_output_interfaces[demandId][pathId][vertexId].first;
+    int curPathEdgeId = demand_path_edge_ids[demandId][pathId][vertexId];
+    int backupEdgeId = -1;
+    int backupPosition = curPathLength + 1;
+    for(int edgeId : nodeEdges[curVertexId]){
+      int otherVertexId = (edges[edgeId].first == curVertexId) ? edges[edgeId].second : edges[edgeId].first;
+      int position = pathPosition[otherVertexId];
+      if(edgeId != curPathEdgeId && position > vertexId + 1 && position < backupPosition){
+        backupEdgeId = edgeId;
+        backupPosition = position;
+      }
+    }
+    if(backupEdgeId < 0){
+      continue;
+    }
+    FtIpv4StaticRoutingHelper::FlowRoute backupRoute;
+    backupRoute.flowId = curFlowId;
+    backupRoute.node = nodes.Get(curVertexId);
+    backupRoute.dest = destinationAddress;
+    backupRoute.nextHop = GetNextHopAddress(backupEdgeId, curVertexId);
+    backupRoute.interface = GetEdgeInterface(backupEdgeId, curVertexId);
+    backupRoutes.push_back(backupRoute);
+  }
+  return backupRoutes;
+}
+
+
+// edge ids of every node, used to look for backup next hops
+std::vector<std::vector<int>>
+GetNodeEdges()
+{
+  std::vector<std::vector<int>> nodeEdges(V);
+  for(int edgeId = 0; edgeId < E; ++edgeId){
+    nodeEdges[edges[edgeId].first].push_back(edgeId);
+    nodeEdges[edges[edgeId].second].push_back(edgeId);
+  }
+  return nodeEdges;
+}
+
+
+// preinstall the backup next hops of all paths on top of the flow routes
+void
+CreateBackupRouting()
+{
+  NS_LOG_INFO("--- Create backup routing");
+  std::vector<std::vector<int>> nodeEdges = GetNodeEdges();
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> backupRoutes;
+  for(int demandId = 0; demandId < D; ++demandId){
+    for(int pathId = 0; pathId < demand_no_paths[demandId]; ++pathId){
+      std::vector<FtIpv4StaticRoutingHelper::FlowRoute> pathBackups = GetPathBackupRoutes(demandId, pathId, GetDestinationAddress(demandId, pathId), nodeEdges);
+      backupRoutes.insert(backupRoutes.end(), pathBackups.begin(), pathBackups.end());
+    }
+  }
+  uint32_t protectedRoutes = ipv4RoutingHelper.AddBackupRoutes(backupRoutes);
+  NS_LOG_INFO("---" << protectedRoutes << " routes protected by a backup next hop");
+  NS_LOG_INFO("--- End create backup routing");
+}
+
+
 // add all routing table entries based on information from ReadDemandPaths() 
 void
 CreateRouting()
 {
   NS_LOG_INFO("--- Create routing");
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> flowRoutes;
   for(int demandId = 0; demandId < D; ++demandId){
     for(int pathId = 0; pathId < demand_no_paths[demandId]; ++pathId){
       int curFlowId = demand_path_flowids[demandId][pathId];
       int curPathLength = demand_path_edge_ids[demandId][pathId].size();
       int curPathLastEdgeId = demand_path_edge_ids[demandId][pathId][curPathLength - 1];
-      Ipv4Address curDemandDestinationAddress = (edges[curPathLastEdgeId].first == demand_to[demandId]) ? 
-                                                ipv4InterfaceContainers[curPathLastEdgeId].GetAddress(0) :
-                                                ipv4InterfaceContainers[curPathLastEdgeId].GetAddress(1);
+      Ipv4Address curDemandDestinationAddress = GetDestinationAddress(demandId, pathId);
       NS_LOG_INFO(curFlowId);   
       NS_LOG_INFO(curPathLength);
       NS_LOG_INFO(curPathLastEdgeId);
       NS_LOG_INFO(curDemandDestinationAddress);
-      
-      //vertexId - only for iteration throw each vertex in current path; 0,1,...,pathSize-1; used also for edge iterating
-      //curVertexId - actual nodeId
-      for(int vertexId = 0; vertexId < curPathLength; ++vertexId){
-        int curVertexId = demand_path_output_interfaces[demandId][pathId][vertexId].first;
-        int curOutputInterfaceId = demand_path_output_interfaces[demandId][pathId][vertexId].second;
-        int curPathEdgeId = demand_path_edge_ids[demandId][pathId][vertexId];
-        // if current nodeId == first node of cur edge, then we need second nodeId as curToAddress
-        Ipv4Address curToAddress = (edges[curPathEdgeId].first == curVertexId) ? 
-                                                ipv4InterfaceContainers[curPathEdgeId].GetAddress(1) :
-                                                ipv4InterfaceContainers[curPathEdgeId].GetAddress(0);
-
-        // ipv4 of current node
-        Ptr<Ipv4> curIpv4 = (nodes.Get(curVertexId))->GetObject<Ipv4>();
-        // pointer to static routing(routing table) of current node
-        Ptr<FtIpv4StaticRouting> curVertexStaticRouting = ipv4RoutingHelper.GetStaticRouting(curIpv4);
-        // adding one current entry to routing table
-        curVertexStaticRouting->AddHostRouteTo(curFlowId, curDemandDestinationAddress, curToAddress, curOutputInterfaceId);
-        NS_LOG_INFO(curPathEdgeId << " " << curVertexId << " " << curOutputInterfaceId);
-        NS_LOG_INFO("---adding routing entry:" << curFlowId << " " << curDemandDestinationAddress << " " << curToAddress << " " << curOutputInterfaceId);
-      }                                  
+
+      // routing table entries of the path; all entries are installed at once below
+      std::vector<FtIpv4StaticRoutingHelper::FlowRoute> pathRoutes = GetPathFlowRoutes(demandId, pathId, curDemandDestinationAddress);
+      flowRoutes.insert(flowRoutes.end(), pathRoutes.begin(), pathRoutes.end());
     }
   }
+  ipv4RoutingHelper.AddFlowRoutes(flowRoutes);
+  // merge the routes of consecutive flowIds leaving a node the same way and compile them
+  // into the forwarding tables; reroute events later update single flows in place
+  for(uint32_t nodeId = 0; nodeId < nodes.GetN(); ++nodeId){
+    Ptr<Ipv4> curIpv4 = nodes.Get(nodeId)->GetObject<Ipv4>();
+    Ptr<FtIpv4StaticRouting> curRouting = ipv4RoutingHelper.GetStaticRouting(curIpv4);
+    uint32_t aggregated = curRouting->AggregateFlowRoutes();
+    NS_LOG_INFO("---node " << nodeId << ": " << aggregated << " routes aggregated into " << curRouting->GetNFlowRangeRoutes() << " ranges");
+    curRouting->Freeze();
+  }
   NS_LOG_INFO("--- End create routing");
 }
 
 
-// get ipv4 address, that is assigned to the net device of demandId destination node and
-// at the same time belongs to last edge of pathId; used to create traffic generating apps
-Ipv4Address
-GetDestinationAddress(int demandId, int pathId)
+// hops of the label switched path of the current path of pathId
+std::vector<FtIpv4StaticRoutingHelper::PathHop>
+GetPathLabelHops(int demandId, int pathId)
 {
-  int pathLength = demand_path_no_vertices[demandId][pathId];
-  int lastEdgeId = demand_path_edge_ids[demandId][pathId][pathLength - 1];
-  Ipv4Address toAddress = (edges[lastEdgeId].first == demand_to[demandId]) ? 
-                          ipv4InterfaceContainers[lastEdgeId].GetAddress(0) :
-                          ipv4InterfaceContainers[lastEdgeId].GetAddress(1);
-  return toAddress; 
+  std::vector<FtIpv4StaticRoutingHelper::PathHop> hops;
+  int curPathLength = demand_path_edge_ids[demandId][pathId].size();
+  for(int vertexId = 0; vertexId < curPathLength; ++vertexId){
+    int curVertexId = demand_path_output_interfaces[demandId][pathId][vertexId].first;
+    int curPathEdgeId = demand_path_edge_ids[demandId][pathId][vertexId];
+    FtIpv4StaticRoutingHelper::PathHop hop;
+    hop.node = nodes.Get(curVertexId);
+    hop.nextHop = GetNextHopAddress(curPathEdgeId, curVertexId);
+    hop.interface = demand_path_output_interfaces[demandId][pathId][vertexId].second;
+    hops.push_back(hop);
+  }
+  return hops;
 }
 
 
-// convert double datarate value into string with FLOW_UNIT
-// handles 0.0 datarate value, setting to very low datarate value 
-std::string
-GetDataRateString(double dataRate)
+// install the label switched path of the current path of pathId, returns the label of its first hop
+uint32_t
+AddPathLabelRoutes(int demandId, int pathId)
+{
+  return ipv4RoutingHelper.AddLabelPath(GetPathLabelHops(demandId, pathId));
+}
+
+
+// free the labels of a label switched path that is no longer used
+void
+RemovePathLabelRoutes(std::vector<FtIpv4StaticRoutingHelper::PathHop> hops, uint32_t label)
 {
-  // If initialy current dataRate == 0.0 (i.e., path is not used), 
-  // set its dataRate to low value ("1bps" for instance).
-  // This way next send packet event will be scheduled at time packetSize/dataRate,
-  // t = 25B / 1bps = 200s, t should exceed simulation time (increasing the packetSize may be needed).      
-  std::string dataRateString = (abs(dataRate) < 0.0000001) ? 
-                                "1bps" : 
-                                std::to_string(dataRate) + FLOW_UNIT;
-  return dataRateString;
+  NS_LOG_INFO("--- Remove label path with first label " << label << " at " << Simulator::Now().GetSeconds());
+  ipv4RoutingHelper.RemoveLabelPath(hops, label);
+}
+
+
+// install one label switched path for every demand path, based on information from ReadDemandPaths()
+void
+CreateLabelRouting()
+{
+  NS_LOG_INFO("--- Create label routing");
+  demandPathLabels.resize(D);
+  for(int demandId = 0; demandId < D; ++demandId){
+    demandPathLabels[demandId].resize(demand_no_paths[demandId]);
+    for(int pathId = 0; pathId < demand_no_paths[demandId]; ++pathId){
+      demandPathLabels[demandId][pathId] = AddPathLabelRoutes(demandId, pathId);
+      NS_LOG_INFO("---label path:" << demand_path_flowids[demandId][pathId] << " first label " << demandPathLabels[demandId][pathId]);
+    }
+  }
+  NS_LOG_INFO("--- End create label routing");
+}
+
+
+// convert double datarate value with FLOW_UNIT into DataRate
+// a 0.0 datarate value gives a stopped app (FtOnOffApplication sends nothing at rate 0)
+DataRate
+GetDataRate(double dataRate)
+{
+  if(abs(dataRate) < 0.0000001){
+    return DataRate(0);
+  }
+  return DataRate(std::to_string(dataRate) + FLOW_UNIT);
+}
+
+
+// source route of the current path of pathId, one hop per vertex
+FtSourceRouteTag
+GetPathSourceRoute(int demandId, int pathId)
+{
+  FtSourceRouteTag sourceRoute;
+  int pathLength = demand_path_edge_ids[demandId][pathId].size();
+  for(int vertexId = 0; vertexId < pathLength; ++vertexId){
+    sourceRoute.AddHop(demand_path_output_interfaces[demandId][pathId][vertexId].first,
+                       demand_path_output_interfaces[demandId][pathId][vertexId].second);
+  }
+  return sourceRoute;
 }
 
 
@@ -526,39 +791,75 @@ CreateApplications()
   ftOnOffHelper.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1000]"));
   ftOnOffHelper.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
   ftOnOffHelper.SetAttribute("UsePoissonProcess", BooleanValue(USE_POISSON_PROCESS));
+  ftOnOffHelper.SetAttribute("BurstSize", UintegerValue(BURST_SIZE));
+  ftOnOffHelper.SetAttribute("BurstWindow", TimeValue(Seconds(BURST_WINDOW)));
   
   //PacketSinkHelper packetSinkHelper(protocol, Address(InetSocketAddress(Ipv4Address("14.14.14.14"), port)));   
   PacketSinkHelper packetSinkHelper(protocol, Address(InetSocketAddress(Ipv4Address::GetAny(), temp_port))); 
 
   demandPathOnOffApps.resize(D);
   demandPathSinkApps.resize(D);
+  demandMultiPathSources.resize(D);
   for(int demandId = 0; demandId < D; ++demandId){
     demandPathOnOffApps[demandId].resize(demand_no_paths[demandId]);
     demandPathSinkApps[demandId].resize(demand_no_paths[demandId]);
+    if(USE_MULTI_PATH_SOURCE){
+      Ptr<FtMultiPathSource> source = CreateObject<FtMultiPathSource>();
+      source->SetAttribute("PacketSize", UintegerValue(PACKET_SIZE));
+      source->SetAttribute("UsePoissonProcess", BooleanValue(USE_POISSON_PROCESS));
+      // sampling splits a Poisson stream into Poisson streams, like one app per path;
+      // round-robin keeps the shares of a CBR stream exact
+      source->SetAttribute("PathSelection", EnumValue(USE_POISSON_PROCESS ? FtMultiPathSource::WEIGHTED_SAMPLING
+                                                                          : FtMultiPathSource::DEFICIT_ROUND_ROBIN));
+      nodes.Get(demand_fr[demandId])->AddApplication(source);
+      source->SetStartTime(onOffStartTime);
+      source->SetStopTime(onOffStopTime);
+      demandMultiPathSources[demandId] = source;
+    }
     for(int pathId = 0; pathId < demand_no_paths[demandId]; ++pathId){
       // setting path-specific attributes
 
       // same port in both OnOff and PacketSink apps
       int port = demand_path_flowids[demandId][pathId];
       Ipv4Address destinationAddress = GetDestinationAddress(demandId, pathId);
-      ftOnOffHelper.SetAttribute("Remote", AddressValue(InetSocketAddress(destinationAddress, port)));
-      
-      std::string dataRateString = GetDataRateString(demand_path_initial_flow[demandId][pathId]);
-      DataRate dataRate = DataRate(dataRateString);
-      ftOnOffHelper.SetAttribute("DataRate", DataRateValue(dataRate));
+      DataRate dataRate = GetDataRate(demand_path_initial_flow[demandId][pathId]);
       int flowId = demand_path_flowids[demandId][pathId];
-      ftOnOffHelper.SetAttribute("FlowId", UintegerValue(flowId));
+      if(USE_PORT_FLOW_ID && (flowId < 0 || flowId > 65535)){
+        NS_FATAL_ERROR("flowId " << flowId << " of demand " << demandId << " path " << pathId
+                       << " does not fit in a port, run without --portFlowId");
+      }
+      if(USE_MULTI_PATH_SOURCE){
+        Ptr<FtMultiPathSource> source = demandMultiPathSources[demandId];
+        source->AddPath(InetSocketAddress(destinationAddress, port), flowId, dataRate);
+        if(USE_LABEL_SWITCHING){
+          source->SetPathLabel(pathId, demandPathLabels[demandId][pathId]);
+        }
+        if(USE_SOURCE_ROUTING){
+          source->SetPathSourceRoute(pathId, GetPathSourceRoute(demandId, pathId));
+        }
+      }else{
+        ftOnOffHelper.SetAttribute("Remote", AddressValue(InetSocketAddress(destinationAddress, port)));
+        ftOnOffHelper.SetAttribute("DataRate", DataRateValue(dataRate));
+        ftOnOffHelper.SetAttribute("FlowId", UintegerValue(flowId));
+        if(USE_LABEL_SWITCHING){
+          ftOnOffHelper.SetAttribute("Label", UintegerValue(demandPathLabels[demandId][pathId]));
+        }
 
-      ApplicationContainer onOffAppContainer = ftOnOffHelper.Install(nodes.Get(demand_fr[demandId]));
-      onOffAppContainer.Start(onOffStartTime);
-      onOffAppContainer.Stop(onOffStopTime);      
-      //Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication> (onOffAppContainer.Get(0));
-      //onOffApp->ScheduleStartAppOnTime(onOffStartTime);
-      //onOffApp->ScheduleStopAppOnTime(onOffStopTime);
+        ApplicationContainer onOffAppContainer = ftOnOffHelper.Install(nodes.Get(demand_fr[demandId]));
+        onOffAppContainer.Start(onOffStartTime);
+        onOffAppContainer.Stop(onOffStopTime);
+        //Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication> (onOffAppContainer.Get(0));
+        //onOffApp->ScheduleStartAppOnTime(onOffStartTime);
+        //onOffApp->ScheduleStopAppOnTime(onOffStopTime);
 
-      // current onOff app has been installed only on one node (i.e. demands source node), 
-      // onOffAppContainer has only one app, get here 0th app 
-      demandPathOnOffApps[demandId][pathId] = onOffAppContainer.Get(0);
+        // current onOff app has been installed only on one node (i.e. demands source node),
+        // onOffAppContainer has only one app, get here 0th app
+        demandPathOnOffApps[demandId][pathId] = onOffAppContainer.Get(0);
+
+        if(USE_SOURCE_ROUTING){
+          DynamicCast<FtOnOffApplication>(onOffAppContainer.Get(0))->SetSourceRoute(GetPathSourceRoute(demandId, pathId));
+        }
+      }
 
       // sink app
       packetSinkHelper.SetAttribute("Local", AddressValue(InetSocketAddress(destinationAddress, port)));
@@ -572,6 +873,28 @@ CreateApplications()
 }
 
 
+// current datarate of the traffic of pathId, from its app or from the source of the demand
+DataRate
+GetPathDataRate(int demandId, int pathId)
+{
+  if(USE_MULTI_PATH_SOURCE){
+    return demandMultiPathSources[demandId]->GetPathRate(pathId);
+  }
+  return DynamicCast<FtOnOffApplication>(demandPathOnOffApps[demandId][pathId])->GetRate();
+}
+
+
+// bytes sent so far on pathId, from its app or from the source of the demand
+uint64_t
+GetPathTotalSent(int demandId, int pathId)
+{
+  if(USE_MULTI_PATH_SOURCE){
+    return demandMultiPathSources[demandId]->GetPathTotalSent(pathId);
+  }
+  return DynamicCast<FtOnOffApplication>(demandPathOnOffApps[demandId][pathId])->GetTotalSent();
+}
+
+
 // change datarate of the edge in both directions
 void 
 ChangeBandwidth(const StringValue & dataRateValue, NetDeviceContainer & devices)
@@ -589,60 +912,154 @@ ChangeBandwidth(const StringValue & dataRateValue, NetDeviceContainer & devices)
 }
 
 
-// schedule link datarate change
-void 
-ScheduleDataRateChange(const Time & scheduleTime, const StringValue & dataRateValue, NetDeviceContainer & devices)
+// take the edge down or back up: the Ipv4 interfaces of both ends are set down/up, which
+// withdraws or restores the routes through them, and while the edge is down its devices
+// drop every received packet, including those already on the wire
+void
+SetEdgeState(int edgeId, bool up)
 {
-  Simulator::Schedule (scheduleTime, &ChangeBandwidth, dataRateValue, devices);
+  if(edgeDown[edgeId] == !up){
+    // already in that state
+    return;
+  }
+  NS_LOG_INFO("--- Edge " << edgeId << (up ? " up" : " down") << " at " << Simulator::Now().GetSeconds());
+  edgeDown[edgeId] = !up;
+  for(uint32_t deviceId = 0; deviceId < 2; ++deviceId){
+    Ptr<NetDevice> device = netDeviceContainers[edgeId].Get(deviceId);
+    Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+    int32_t interface = ipv4->GetInterfaceForDevice(device);
+    if(up){
+      device->SetAttribute("ReceiveErrorModel", PointerValue(Ptr<ErrorModel>()));
+      ipv4->SetUp(interface);
+    }else{
+      Ptr<RateErrorModel> errorModel = CreateObject<RateErrorModel>();
+      errorModel->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+      errorModel->SetRate(1.0);
+      device->SetAttribute("ReceiveErrorModel", PointerValue(errorModel));
+      ipv4->SetDown(interface);
+    }
+  }
 }
 
 
-// When scheduling app datarate change, first change datarate value
-// then turn off and almost immediately turn it on.
-// This way datarate changes like 0->x or x->0 will work properly.
+// schedule link datarate change
 void 
-ChangeTrafficRate(const StringValue & trafficRateValue, Ptr<Application> application, const Time & scheduleTime)
+ScheduleDataRateChange(const Time & scheduleTime, const StringValue & dataRateValue, NetDeviceContainer & devices)
 {
-  Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication> (application);
-  onOffApp->ScheduleStopAppOnTime(NanoSeconds(10.0));
-  application->SetAttribute("DataRate", StringValue(trafficRateValue));
-  StringValue dr0;
-  onOffApp->GetAttribute("DataRate", dr0);
-  //NS_LOG_INFO("-------after app datarate arg " << trafficRateValue.Get());
-  //NS_LOG_INFO("-------after app datarate " << dr0.Get());
-  onOffApp->ScheduleStartAppOnTime(NanoSeconds(20.0)); 
+  Simulator::Schedule (scheduleTime, &ChangeBandwidth, dataRateValue, devices);
 }
 
 
-// schedule traffic generator datarate
-void 
-ScheduleTrafficRateChange(const Time & scheduleTime, const StringValue & trafficRateValue, Ptr<Application> application)
+// Move the flow of pathId to the path of routeEventId. Only the nodes whose hop changes are
+// updated; destinationAddress stays the one the apps of the path were created with.
+void
+ChangePath(int demandId, int pathId, Ipv4Address destinationAddress, int routeEventId)
 {
-  Simulator::Schedule (scheduleTime, &ChangeTrafficRate, trafficRateValue, application, scheduleTime); 
+  int flowId = demand_path_flowids[demandId][pathId];
+  NS_LOG_INFO("--- Reroute flow " << flowId << " at " << Simulator::Now().GetSeconds());
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> oldRoutes = GetPathFlowRoutes(demandId, pathId, destinationAddress);
+  std::vector<FtIpv4StaticRoutingHelper::PathHop> oldLabelHops;
+  if(USE_LABEL_SWITCHING){
+    oldLabelHops = GetPathLabelHops(demandId, pathId);
+  }
+  // the new path becomes the current one, so that later reroutes of the flow start from it
+  demand_path_output_interfaces[demandId][pathId] = event_route_output_interfaces[routeEventId];
+  demand_path_edge_ids[demandId][pathId] = event_route_edge_ids[routeEventId];
+  demand_path_no_vertices[demandId][pathId] = event_route_edge_ids[routeEventId].size();
+  Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication>(demandPathOnOffApps[demandId][pathId]);
+  if(USE_SOURCE_ROUTING){
+    if(USE_MULTI_PATH_SOURCE){
+      demandMultiPathSources[demandId]->SetPathSourceRoute(pathId, GetPathSourceRoute(demandId, pathId));
+    }else{
+      onOffApp->SetSourceRoute(GetPathSourceRoute(demandId, pathId));
+    }
+  }else if(USE_LABEL_SWITCHING){
+    // labels of the old path stay installed until the packets already sent on it drained
+    Simulator::Schedule(Seconds(LABEL_DRAIN_TIME), &RemovePathLabelRoutes, oldLabelHops, demandPathLabels[demandId][pathId]);
+    demandPathLabels[demandId][pathId] = AddPathLabelRoutes(demandId, pathId);
+    if(USE_MULTI_PATH_SOURCE){
+      demandMultiPathSources[demandId]->SetPathLabel(pathId, demandPathLabels[demandId][pathId]);
+    }else{
+      onOffApp->SetAttribute("Label", UintegerValue(demandPathLabels[demandId][pathId]));
+    }
+  }else{
+    std::vector<FtIpv4StaticRoutingHelper::FlowRoute> newRoutes = GetPathFlowRoutes(demandId, pathId, destinationAddress);
+    ipv4RoutingHelper.RerouteFlows(oldRoutes, newRoutes);
+    if(USE_FAST_REROUTE){
+      // backups of the hops kept from the old path are replaced as well
+      ipv4RoutingHelper.AddBackupRoutes(GetPathBackupRoutes(demandId, pathId, destinationAddress, GetNodeEdges()));
+    }
+  }
 }
 
 
 // add events to the simulator (schedule) 
-// edge bandwidth changes and onOff app datarate changes 
+// edge bandwidth changes, onOff app datarate changes and reroutes
 void
 CreateEvents()
 {
   NS_LOG_INFO("--- Create events");
+  edgeDown.assign(E, false);
   for(int edgeEventId = 0; edgeEventId < no_edge_events; ++edgeEventId){
+    // bandwidth 0 is a link failure; any other bandwidth brings a failed link back up
+    bool up = event_edge_bandwidth[edgeEventId] > 0.0;
+    Simulator::Schedule(Seconds(event_edge_time[edgeEventId]), &SetEdgeState, event_edge_id[edgeEventId], up);
+    if(!up){
+      continue;
+    }
     ScheduleDataRateChange(Seconds(event_edge_time[edgeEventId]), 
                            StringValue(std::to_string(event_edge_bandwidth[edgeEventId]) + FLOW_UNIT), 
                            netDeviceContainers[event_edge_id[edgeEventId]]);
   }
 
+  // app datarate changes become one rate schedule per app (or per multi-path source);
+  // the app keeps only its next change in the event queue
+  std::vector<std::vector<std::vector<std::pair<Time, DataRate>>>> demandPathRateSchedules(D);
+  std::vector<std::vector<FtMultiPathSource::RateChange>> demandRateSchedules(D);
+  for(int demandId = 0; demandId < D; ++demandId){
+    demandPathRateSchedules[demandId].resize(demand_no_paths[demandId]);
+  }
   for(int appEventId = 0; appEventId < no_app_events; ++appEventId){
     std::pair<int, int> demandPathIds = GetDemandPathIdsByFlowId(event_app_flowid[appEventId]);
     int demandId = demandPathIds.first;
     int pathId = demandPathIds.second;
-    std::string dataRateString = GetDataRateString(event_app_datarate[appEventId]);
-    //std::string dataRateString = GetDataRateString(0.9);
-    ScheduleTrafficRateChange(Seconds(event_app_time[appEventId]),
-                              StringValue(dataRateString),
-                              demandPathOnOffApps[demandId][pathId]);
+    if(demandId < 0){
+      continue;
+    }
+    // parsed once here, not when the change is applied
+    if(USE_MULTI_PATH_SOURCE){
+      FtMultiPathSource::RateChange change;
+      change.time = Seconds(event_app_time[appEventId]);
+      change.path = pathId;
+      change.rate = GetDataRate(event_app_datarate[appEventId]);
+      demandRateSchedules[demandId].push_back(change);
+      continue;
+    }
+    demandPathRateSchedules[demandId][pathId].emplace_back(Seconds(event_app_time[appEventId]),
+                                                           GetDataRate(event_app_datarate[appEventId]));
+  }
+  for(int demandId = 0; demandId < D; ++demandId){
+    if(!demandRateSchedules[demandId].empty()){
+      demandMultiPathSources[demandId]->SetRateSchedule(demandRateSchedules[demandId]);
+    }
+    for(int pathId = 0; pathId < demand_no_paths[demandId]; ++pathId){
+      if(!demandPathRateSchedules[demandId][pathId].empty()){
+        DynamicCast<FtOnOffApplication>(demandPathOnOffApps[demandId][pathId])->SetRateSchedule(demandPathRateSchedules[demandId][pathId]);
+      }
+    }
+  }
+
+  for(int routeEventId = 0; routeEventId < no_route_events; ++routeEventId){
+    std::pair<int, int> demandPathIds = GetDemandPathIdsByFlowId(event_route_flowid[routeEventId]);
+    int demandId = demandPathIds.first;
+    int pathId = demandPathIds.second;
+    if(demandId < 0 || event_route_edge_ids[routeEventId].empty()){
+      NS_LOG_INFO("--- ERROR: reroute event " << routeEventId << " skipped !!!");
+      continue;
+    }
+    // routes of the flow keep the destination of its apps, taken from the path of the paths file
+    Simulator::Schedule(Seconds(event_route_time[routeEventId]), &ChangePath,
+                        demandId, pathId, GetDestinationAddress(demandId, pathId), routeEventId);
   }
   NS_LOG_INFO("--- End create events");
 }
@@ -668,8 +1085,7 @@ SaveFlowSentRecievedBytes(int & demandId, int & pathId)
   Ptr<PacketSink> packetSinkApp = DynamicCast<PacketSink> (demandPathSinkApps[demandId][pathId]);
   uint64_t totalRecieved = packetSinkApp->GetTotalRx();
   
-  Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication> (demandPathOnOffApps[demandId][pathId]);
-  uint64_t totalSent = onOffApp->GetTotalSent();
+  uint64_t totalSent = GetPathTotalSent(demandId, pathId);
 
   std::string sample = std::to_string(Simulator::Now().GetSeconds()) + " " + 
                                       std::to_string(totalSent) + " " + 
@@ -853,14 +1269,7 @@ CheckEdgeLoad(int & edgeId, int & nodeId)
 	  	}
 	  }
 	  if(pathUsesEdge){
-    	Ptr<FtOnOffApplication> onOffApp = DynamicCast<FtOnOffApplication> (demandPathOnOffApps[demandId][pathId]);
-  		StringValue dataRateString;
-  		onOffApp->GetAttribute("DataRate", dataRateString);
-  		DataRate dataRate(dataRateString.Get());
-		// skip datarata = 1 as it 0 actually
-  		if(dataRate.GetBitRate() != 1){
-  			totalLoad += dataRate.GetBitRate();
-  		}
+  		totalLoad += GetPathDataRate(demandId, pathId).GetBitRate();
 	  }
 
     }
@@ -930,7 +1339,30 @@ runSimulation(std::string path)
   CreateEdges();
   
   ReadDemandPaths(routingFilePath);
-  CreateRouting();
+  std::string fibSnapshotFilePath = dataPath + "routing.fib";
+  uint64_t fibSnapshotDigest = 0;
+  if(USE_FIB_SNAPSHOT){
+    std::vector<std::string> routeInputs;
+    routeInputs.push_back(graphFilePath);
+    routeInputs.push_back(routingFilePath);
+    fibSnapshotDigest = FtIpv4StaticRoutingHelper::GetFilesDigest(routeInputs);
+  }
+  if(USE_SOURCE_ROUTING){
+    NS_LOG_INFO("--- Source routing, no routes created");
+  }
+  else if(USE_LABEL_SWITCHING){
+    CreateLabelRouting();
+  }
+  else if(!USE_FIB_SNAPSHOT || !FtIpv4StaticRoutingHelper::LoadRoutesAll(fibSnapshotFilePath, fibSnapshotDigest)){
+    CreateRouting();
+    if(USE_FIB_SNAPSHOT){
+      FtIpv4StaticRoutingHelper::SaveRoutesAll(fibSnapshotFilePath, fibSnapshotDigest);
+    }
+  }
+  if(USE_FAST_REROUTE && !USE_SOURCE_ROUTING && !USE_LABEL_SWITCHING){
+    // backups are not part of the snapshot, they are added to loaded routes as well
+    CreateBackupRouting();
+  }
   CreateApplications();
   
   ReadEvents(eventsFilePath);
@@ -976,6 +1408,9 @@ runSimulation(std::string path)
   NS_LOG_INFO("\n################ START SIMULATION ################\n");
   Simulator::Run ();
   NS_LOG_INFO("\n################ END SIMULATION ################\n");
+
+  Ptr<OutputStreamWrapper> routingStats = Create<OutputStreamWrapper> (dataPath + "routing-stats.txt", std::ios::out);
+  FtIpv4StaticRoutingHelper::PrintStatisticsAll (routingStats);
   
   double total_time = get_time() - start_time;
   NS_LOG_INFO("--- ini time = " + std::to_string(init_time) + "s");
@@ -996,7 +1431,22 @@ main (int argc, char *argv[])
   //std::string dataPath = "/Desktop/simdata/n2e1d1/";
   std::string dataPath = "/Desktop/simdata/rep_poisson/DL-quad-mid-simple-alpha05-beta1-fix/ftest4/";
   cmd.AddValue("dataPath", "Path with input data", dataPath);
+  cmd.AddValue("fibSnapshot", "Load routes from dataPath/routing.fib, or write it after CreateRouting", USE_FIB_SNAPSHOT);
+  cmd.AddValue("sourceRouting", "Carry the path in every packet instead of creating routes", USE_SOURCE_ROUTING);
+  cmd.AddValue("labelSwitching", "Install label switched paths instead of flow routes", USE_LABEL_SWITCHING);
+  cmd.AddValue("labelDrainTime", "Seconds the labels of the old path of a rerouted flow stay installed", LABEL_DRAIN_TIME);
+  cmd.AddValue("fastReroute", "Preinstall backup next hops taken while a link is down", USE_FAST_REROUTE);
+  cmd.AddValue("burstSize", "Packet departures drawn at once by every traffic generator; events drop by "
+               "about burstWindow / packet time, at most burstSize", BURST_SIZE);
+  cmd.AddValue("burstWindow", "Seconds a packet of a train may be sent early (0 = one packet time)", BURST_WINDOW);
+  cmd.AddValue("multiPathSource", "Generate the traffic of each demand with one app for all its paths", USE_MULTI_PATH_SOURCE);
+  cmd.AddValue("portFlowId", "Classify packets by UDP destination port (flowIds below 65536)", USE_PORT_FLOW_ID);
   cmd.Parse (argc, argv);
+  if(USE_PORT_FLOW_ID){
+    Config::SetDefault("ns3::FtIpv4StaticRouting::FlowIdSource", StringValue("DestinationPort"));
+  }
+  Config::SetDefault("ns3::FtIpv4StaticRouting::SourceRouting", BooleanValue(USE_SOURCE_ROUTING));
+  Config::SetDefault("ns3::FtIpv4StaticRouting::LabelSwitching", BooleanValue(USE_LABEL_SWITCHING));
   Time::SetResolution (Time::NS);
 
   RngSeedManager::SetSeed(SEED);
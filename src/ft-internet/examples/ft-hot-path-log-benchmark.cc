@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Benchmark of the ft-internet hot paths, to compare a build configured with
+ * --disable-ft-hot-path-logging against a default one.
+ *
+ * Two nodes are connected by a SimpleNetDevice link.  The first phase calls
+ * FtIpv4StaticRouting::RouteOutput of the sender for flow tagged packets with
+ * the route cache disabled, so that every call scans the routes of its flow.
+ * The second phase runs an FtOnOffApplication between the nodes, which goes
+ * through SendPacket, RouteOutput and RouteInput for every packet.
+ *
+ * Run it once per build mode; the difference of the reported times is the
+ * cost of the compiled-in hot path logging.  With NS_LOG enabled, the
+ * difference also grows with the log level of FtIpv4StaticRouting and
+ * FtOnOffApplication (see NS_LOG).
+ */
+
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/ft-ipv4-static-routing-helper.h"
+#include "ns3/ft-on-off-helper.h"
+#include "ns3/ft-tag.h"
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t flows = 64;
+  uint32_t routesPerFlow = 16;
+  uint32_t lookups = 1000000;
+  double duration = 10.0;
+
+  CommandLine cmd;
+  cmd.AddValue ("flows", "Number of flows with routes on the sender", flows);
+  cmd.AddValue ("routesPerFlow", "Number of host routes of every flow", routesPerFlow);
+  cmd.AddValue ("lookups", "Number of RouteOutput calls of the first phase", lookups);
+  cmd.AddValue ("duration", "Simulated seconds of the FtOnOffApplication phase", duration);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::FtIpv4StaticRouting::RouteCacheSize", UintegerValue (0));
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  NetDeviceContainer devices;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetChannel (channel);
+      nodes.Get (i)->AddDevice (device);
+      devices.Add (device);
+    }
+
+  FtIpv4StaticRoutingHelper routingHelper;
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (routingHelper);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  Ipv4Address sink = interfaces.GetAddress (1);
+
+  // Every flow has routes to other hosts before the one to the sink, so a
+  // lookup of the sink examines routesPerFlow entries
+  std::vector<FtIpv4StaticRoutingHelper::FlowRoute> routes;
+  for (uint32_t flowId = 1; flowId <= flows; flowId++)
+    {
+      for (uint32_t r = 0; r < routesPerFlow; r++)
+        {
+          FtIpv4StaticRoutingHelper::FlowRoute route;
+          route.flowId = flowId;
+          route.node = nodes.Get (0);
+          route.dest = r + 1 < routesPerFlow ? Ipv4Address (0x0a020000 + r) : sink;
+          route.nextHop = sink;
+          route.interface = 1;
+          routes.push_back (route);
+        }
+    }
+  routingHelper.AddFlowRoutes (routes);
+
+  Ptr<FtIpv4StaticRouting> routing = routingHelper.GetStaticRouting (nodes.Get (0)->GetObject<Ipv4> ());
+  std::vector<Ptr<Packet> > packets;
+  for (uint32_t flowId = 1; flowId <= flows; flowId++)
+    {
+      FtTag tag;
+      tag.SetSimpleValue (flowId);
+      Ptr<Packet> packet = Create<Packet> (100);
+      packet->AddByteTag (tag);
+      packets.push_back (packet);
+    }
+  Ipv4Header header;
+  header.SetSource (interfaces.GetAddress (0));
+  header.SetDestination (sink);
+
+  SystemWallClockMs clock;
+  uint32_t found = 0;
+  clock.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      Socket::SocketErrno sockerr;
+      if (routing->RouteOutput (packets[i % packets.size ()], header, 0, sockerr))
+        {
+          found++;
+        }
+    }
+  int64_t lookupMs = clock.End ();
+
+  Ptr<Socket> sinkSocket = Socket::CreateSocket (nodes.Get (1), UdpSocketFactory::GetTypeId ());
+  sinkSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  FtOnOffHelper onOff ("ns3::UdpSocketFactory", InetSocketAddress (sink, 9));
+  onOff.SetAttribute ("FlowId", UintegerValue (1));
+  onOff.SetAttribute ("DataRate", DataRateValue (DataRate ("100Mbps")));
+  onOff.SetAttribute ("PacketSize", UintegerValue (1000));
+  onOff.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1000]"));
+  onOff.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  ApplicationContainer apps = onOff.Install (nodes.Get (0));
+  apps.Start (Seconds (0.0));
+  apps.Stop (Seconds (duration));
+
+  routing->ResetStatistics ();
+  clock.Start ();
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  int64_t simulationMs = clock.End ();
+  uint64_t sent = routing->GetStatistics ().routeOutput;
+  Simulator::Destroy ();
+
+#ifdef FT_INTERNET_NO_HOT_PATH_LOG
+  std::cout << "hot path logging: compiled out" << std::endl;
+#else
+  std::cout << "hot path logging: compiled in" << std::endl;
+#endif
+  std::cout << "RouteOutput: " << lookups << " calls over " << routesPerFlow
+            << " routes per flow, " << lookupMs << " ms (" << found << " found)" << std::endl;
+  std::cout << "FtOnOffApplication: " << sent << " packets, " << simulationMs << " ms" << std::endl;
+  return found == lookups ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Microbenchmark of the longest prefix match used for routes without flowId:
+ * FtIpv4PrefixTrie against the linear table scan of Ipv4StaticRouting.
+ *
+ * The table looks like the one of a core node: one /30 interface route per
+ * link, a few /24 aggregates and a default route.  Both lookups run over the
+ * same random destinations and their results are compared.
+ */
+
+#include <iostream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/ft-ipv4-routing-table.h"
+#include "ns3/ft-ipv4-prefix-trie.h"
+
+using namespace ns3;
+
+// Same selection rules as Ipv4StaticRouting::LookupStatic (dest, oif)
+static bool
+LinearLookup (const FtIpv4RoutingTable &table, Ipv4Address dest, uint32_t &result)
+{
+  bool found = false;
+  uint16_t longest_mask = 0;
+  uint32_t shortest_metric = 0xffffffff;
+  for (uint32_t i = 0; i < table.GetN (); i++)
+    {
+      uint32_t slot = table.GetSlot (i);
+      if (!table.GetMask (slot).IsMatch (dest, table.GetDest (slot)))
+        {
+          continue;
+        }
+      uint16_t masklen = table.GetMask (slot).GetPrefixLength ();
+      if (masklen < longest_mask)
+        {
+          continue;
+        }
+      if (masklen > longest_mask)
+        {
+          shortest_metric = 0xffffffff;
+        }
+      longest_mask = masklen;
+      if (table.GetMetric (slot) > shortest_metric)
+        {
+          continue;
+        }
+      shortest_metric = table.GetMetric (slot);
+      result = slot;
+      found = true;
+      if (masklen == 32)
+        {
+          break;
+        }
+    }
+  return found;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t links = 500;
+  uint32_t lookups = 1000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("links", "Number of /30 interface routes", links);
+  cmd.AddValue ("lookups", "Number of lookups per structure", lookups);
+  cmd.Parse (argc, argv);
+
+  FtIpv4RoutingTable table;
+  FtIpv4PrefixTrie trie;
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+
+  // 10.0.0.0/8 split in /30 links, 10.<n>.0.0/24 aggregates, default route
+  std::vector<Ipv4Address> networks;
+  for (uint32_t i = 0; i < links; i++)
+    {
+      networks.push_back (Ipv4Address (0x0a000000 + (i << 2)));
+    }
+  for (uint32_t i = 0; i < networks.size (); i++)
+    {
+      uint32_t slot = table.Add (0, networks[i], Ipv4Mask ("255.255.255.252"),
+                                 Ipv4Address::GetZero (), 1 + i, 0);
+      FtIpv4PrefixTrie::Route route = { slot, 1 + i, 0, table.GetSequence (slot) };
+      trie.Insert (networks[i], Ipv4Mask ("255.255.255.252"), route);
+    }
+  for (uint32_t i = 0; i < links / 64 + 1; i++)
+    {
+      Ipv4Address network (0x0a000000 + (i << 8));
+      uint32_t slot = table.Add (0, network, Ipv4Mask ("255.255.255.0"),
+                                 Ipv4Address (0x0a000001), 1, 1);
+      FtIpv4PrefixTrie::Route route = { slot, 1, 1, table.GetSequence (slot) };
+      trie.Insert (network, Ipv4Mask ("255.255.255.0"), route);
+    }
+  uint32_t slot = table.Add (0, Ipv4Address::GetZero (), Ipv4Mask::GetZero (),
+                             Ipv4Address (0x0a000001), 1, 0);
+  FtIpv4PrefixTrie::Route route = { slot, 1, 0, table.GetSequence (slot) };
+  trie.Insert (Ipv4Address::GetZero (), Ipv4Mask::GetZero (), route);
+
+  std::vector<Ipv4Address> destinations;
+  for (uint32_t i = 0; i < 4096; i++)
+    {
+      destinations.push_back (Ipv4Address (0x0a000000 + random->GetInteger (0, links * 4 + 1024)));
+    }
+
+  SystemWallClockMs clock;
+  uint32_t result;
+  uint32_t linearSum = 0;
+  clock.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      if (LinearLookup (table, destinations[i % destinations.size ()], result))
+        {
+          linearSum += result;
+        }
+    }
+  int64_t linearMs = clock.End ();
+
+  uint32_t trieSum = 0;
+  uint32_t examined = 0;
+  clock.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      if (trie.Lookup (destinations[i % destinations.size ()], true, 0, result, examined))
+        {
+          trieSum += result;
+        }
+    }
+  int64_t trieMs = clock.End ();
+
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < destinations.size (); i++)
+    {
+      uint32_t linearSlot = 0;
+      uint32_t trieSlot = 0;
+      bool linearFound = LinearLookup (table, destinations[i], linearSlot);
+      bool trieFound = trie.Lookup (destinations[i], true, 0, trieSlot, examined);
+      if (linearFound != trieFound || linearSlot != trieSlot)
+        {
+          mismatches++;
+        }
+    }
+
+  std::cout << "routes: " << table.GetN () << ", lookups: " << lookups << std::endl;
+  std::cout << "linear scan: " << linearMs << " ms (checksum " << linearSum << ")" << std::endl;
+  std::cout << "prefix trie: " << trieMs << " ms (checksum " << trieSum << ")" << std::endl;
+  std::cout << "mismatches: " << mismatches << std::endl;
+  return mismatches == 0 ? 0 : 1;
+}
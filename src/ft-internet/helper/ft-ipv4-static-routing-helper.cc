@@ -1,6 +1,13 @@
 /*
  * This class is based on ns3::Ipv4StaticRoutingHelper with slight modifications:
  * - a helper class to create ns3::FtIpv4StaticRouting instead of ns3::Ipv4StaticRouting objects
+ * - AddFlowRoutes installs a whole set of flow host routes in one pass
+ * - RerouteFlows replaces the routes of flows, touching only the hops that change
+ * - AddBackupRoutes preinstalls fast reroute backup next hops
+ * - PrintStatisticsAll(At) dumps the lookup statistics of all nodes
+ * - SaveRoutesAll/LoadRoutesAll keep the static routes of all nodes in one binary file,
+ *   tied to the scenario files by a digest (GetFilesDigest)
+ * - AddLabelPath assigns the labels of a label switched path, RemoveLabelPath frees them
  * - note: multicast part is not modified
  */
 
@@ -23,14 +30,19 @@
  */
 
 #include <vector>
+#include <algorithm>
+#include <fstream>
 #include "ns3/log.h"
 #include "ns3/ptr.h"
 #include "ns3/names.h"
 #include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/ipv4-list-routing.h"
 #include "ns3/assert.h"
+#include "ns3/abort.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ft-ipv4-static-routing-helper.h"
@@ -39,6 +51,11 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("FtIpv4StaticRoutingHelper");
 
+/// First word of a route file, "FTRT"
+static const uint32_t ROUTE_FILE_MAGIC = 0x54525446;
+/// Format of the route file; bump it when the layout changes
+static const uint32_t ROUTE_FILE_VERSION = 3;
+
 FtIpv4StaticRoutingHelper::FtIpv4StaticRoutingHelper()
 {
 }
@@ -91,6 +108,303 @@ FtIpv4StaticRoutingHelper::GetStaticRouting (Ptr<Ipv4> ipv4) const
   return 0;
 }
 
+void
+FtIpv4StaticRoutingHelper::AddFlowRoutes (const std::vector<FlowRoute> &routes) const
+{
+  NS_LOG_FUNCTION (this << routes.size ());
+
+  // Group the routes by node id (counting sort, keeps the order within a node)
+  uint32_t nNodes = 0;
+  for (std::vector<FlowRoute>::const_iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      nNodes = std::max (nNodes, i->node->GetId () + 1);
+    }
+  std::vector<uint32_t> first (nNodes + 1, 0);
+  for (std::vector<FlowRoute>::const_iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      first[i->node->GetId () + 1]++;
+    }
+  for (uint32_t n = 0; n < nNodes; n++)
+    {
+      first[n + 1] += first[n];
+    }
+  std::vector<uint32_t> byNode (routes.size ());
+  std::vector<uint32_t> next (first.begin (), first.end () - 1);
+  for (uint32_t r = 0; r < routes.size (); r++)
+    {
+      byNode[next[routes[r].node->GetId ()]++] = r;
+    }
+
+  for (uint32_t n = 0; n < nNodes; n++)
+    {
+      if (first[n] == first[n + 1])
+        {
+          continue;
+        }
+      Ptr<Node> node = routes[byNode[first[n]]].node;
+      Ptr<FtIpv4StaticRouting> routing = GetStaticRouting (node->GetObject<Ipv4> ());
+      NS_ASSERT_MSG (routing, "FtIpv4StaticRoutingHelper::AddFlowRoutes(): "
+                     "no FtIpv4StaticRouting on node " << n);
+      routing->ReserveRoutes (first[n + 1] - first[n]);
+      for (uint32_t k = first[n]; k < first[n + 1]; k++)
+        {
+          const FlowRoute &route = routes[byNode[k]];
+          routing->AddHostRouteTo (route.flowId, route.dest, route.nextHop, route.interface);
+        }
+    }
+}
+
+/**
+ * \return true if both routes are the same host route of the same flow
+ */
+static bool
+IsSameFlowRoute (const FtIpv4StaticRoutingHelper::FlowRoute &a, const FtIpv4StaticRoutingHelper::FlowRoute &b)
+{
+  return a.flowId == b.flowId && a.node == b.node && a.dest == b.dest
+         && a.nextHop == b.nextHop && a.interface == b.interface;
+}
+
+void
+FtIpv4StaticRoutingHelper::RerouteFlows (const std::vector<FlowRoute> &oldRoutes,
+                                         const std::vector<FlowRoute> &newRoutes) const
+{
+  NS_LOG_FUNCTION (this << oldRoutes.size () << newRoutes.size ());
+  // Paths are short, a quadratic match is cheaper than sorting them
+  std::vector<bool> kept (newRoutes.size (), false);
+  for (std::vector<FlowRoute>::const_iterator i = oldRoutes.begin (); i != oldRoutes.end (); i++)
+    {
+      bool same = false;
+      for (uint32_t k = 0; k < newRoutes.size () && !same; k++)
+        {
+          if (!kept[k] && IsSameFlowRoute (*i, newRoutes[k]))
+            {
+              kept[k] = true;
+              same = true;
+            }
+        }
+      if (same)
+        {
+          continue;
+        }
+      Ptr<FtIpv4StaticRouting> routing = GetStaticRouting (i->node->GetObject<Ipv4> ());
+      NS_ASSERT_MSG (routing, "FtIpv4StaticRoutingHelper::RerouteFlows(): "
+                     "no FtIpv4StaticRouting on node " << i->node->GetId ());
+      if (!routing->RemoveFlowRoute (i->flowId, i->dest))
+        {
+          // the new hop would be added next to a stale one that may win
+          NS_FATAL_ERROR ("FtIpv4StaticRoutingHelper::RerouteFlows(): no route of flow " << i->flowId
+                          << " to " << i->dest << " on node " << i->node->GetId ());
+        }
+    }
+  std::vector<FlowRoute> added;
+  for (uint32_t k = 0; k < newRoutes.size (); k++)
+    {
+      if (!kept[k])
+        {
+          added.push_back (newRoutes[k]);
+        }
+    }
+  AddFlowRoutes (added);
+}
+
+uint32_t
+FtIpv4StaticRoutingHelper::AddBackupRoutes (const std::vector<FlowRoute> &backups) const
+{
+  NS_LOG_FUNCTION (this << backups.size ());
+  uint32_t protectedRoutes = 0;
+  for (std::vector<FlowRoute>::const_iterator i = backups.begin (); i != backups.end (); i++)
+    {
+      Ptr<FtIpv4StaticRouting> routing = GetStaticRouting (i->node->GetObject<Ipv4> ());
+      NS_ASSERT_MSG (routing, "FtIpv4StaticRoutingHelper::AddBackupRoutes(): "
+                     "no FtIpv4StaticRouting on node " << i->node->GetId ());
+      if (routing->AddBackupRouteTo (i->flowId, i->dest, i->nextHop, i->interface))
+        {
+          protectedRoutes++;
+        }
+      else
+        {
+          NS_LOG_WARN ("No route of flow " << i->flowId << " to " << i->dest
+                       << " to protect on node " << i->node->GetId ());
+        }
+    }
+  return protectedRoutes;
+}
+
+uint32_t
+FtIpv4StaticRoutingHelper::AddLabelPath (const std::vector<PathHop> &hops) const
+{
+  NS_LOG_FUNCTION (this << hops.size ());
+  uint32_t label = 0;
+  for (std::vector<PathHop>::const_reverse_iterator i = hops.rbegin (); i != hops.rend (); i++)
+    {
+      Ptr<FtIpv4StaticRouting> routing = GetStaticRouting (i->node->GetObject<Ipv4> ());
+      NS_ASSERT_MSG (routing, "FtIpv4StaticRoutingHelper::AddLabelPath(): "
+                     "no FtIpv4StaticRouting on node " << i->node->GetId ());
+      label = routing->AddLabelRoute (label, i->nextHop, i->interface);
+    }
+  return label;
+}
+
+void
+FtIpv4StaticRoutingHelper::RemoveLabelPath (const std::vector<PathHop> &hops, uint32_t label) const
+{
+  NS_LOG_FUNCTION (this << hops.size () << label);
+  for (std::vector<PathHop>::const_iterator i = hops.begin (); i != hops.end () && label != 0; i++)
+    {
+      Ptr<FtIpv4StaticRouting> routing = GetStaticRouting (i->node->GetObject<Ipv4> ());
+      NS_ASSERT_MSG (routing, "FtIpv4StaticRoutingHelper::RemoveLabelPath(): "
+                     "no FtIpv4StaticRouting on node " << i->node->GetId ());
+      label = routing->RemoveLabelRoute (label);
+    }
+}
+
+void
+FtIpv4StaticRoutingHelper::PrintStatisticsAll (Ptr<OutputStreamWrapper> stream)
+{
+  NS_LOG_FUNCTION (stream);
+  FtIpv4StaticRoutingHelper helper;
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (i)->GetObject<Ipv4> ();
+      if (ipv4 == 0)
+        {
+          continue;
+        }
+      Ptr<FtIpv4StaticRouting> routing = helper.GetStaticRouting (ipv4);
+      if (routing)
+        {
+          routing->PrintStatistics (stream);
+        }
+    }
+}
+
+void
+FtIpv4StaticRoutingHelper::PrintStatisticsAllAt (Time printTime, Ptr<OutputStreamWrapper> stream)
+{
+  NS_LOG_FUNCTION (printTime << stream);
+  Simulator::Schedule (printTime, &FtIpv4StaticRoutingHelper::PrintStatisticsAll, stream);
+}
+
+void
+FtIpv4StaticRoutingHelper::SaveRoutesAll (std::string filename, uint64_t digest)
+{
+  NS_LOG_FUNCTION (filename << digest);
+  std::ofstream os (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!os.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open route file " << filename);
+    }
+  FtIpv4StaticRoutingHelper helper;
+  std::vector<Ptr<FtIpv4StaticRouting> > routings;
+  std::vector<uint32_t> nodeIds;
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (i)->GetObject<Ipv4> ();
+      if (ipv4 == 0)
+        {
+          continue;
+        }
+      Ptr<FtIpv4StaticRouting> routing = helper.GetStaticRouting (ipv4);
+      if (routing)
+        {
+          routings.push_back (routing);
+          nodeIds.push_back (i);
+        }
+    }
+
+  uint32_t header[6] = { ROUTE_FILE_MAGIC, ROUTE_FILE_VERSION, NodeList::GetNNodes (),
+                         static_cast<uint32_t> (routings.size ()),
+                         static_cast<uint32_t> (digest), static_cast<uint32_t> (digest >> 32) };
+  os.write (reinterpret_cast<const char *> (header), sizeof (header));
+  for (uint32_t i = 0; i < routings.size (); i++)
+    {
+      os.write (reinterpret_cast<const char *> (&nodeIds[i]), sizeof (uint32_t));
+      routings[i]->SerializeRoutes (os);
+    }
+  if (os.fail ())
+    {
+      NS_FATAL_ERROR ("Cannot write route file " << filename);
+    }
+}
+
+bool
+FtIpv4StaticRoutingHelper::LoadRoutesAll (std::string filename, uint64_t digest)
+{
+  NS_LOG_FUNCTION (filename << digest);
+  std::ifstream is (filename.c_str (), std::ios::in | std::ios::binary);
+  if (!is.is_open ())
+    {
+      NS_LOG_LOGIC ("No route file " << filename);
+      return false;
+    }
+  uint32_t header[6];
+  is.read (reinterpret_cast<char *> (header), sizeof (header));
+  if (is.fail () || header[0] != ROUTE_FILE_MAGIC || header[1] != ROUTE_FILE_VERSION)
+    {
+      NS_LOG_WARN ("Route file " << filename << " has an unknown format");
+      return false;
+    }
+  if (header[2] != NodeList::GetNNodes ())
+    {
+      NS_LOG_WARN ("Route file " << filename << " was written for " << header[2] << " nodes");
+      return false;
+    }
+  if (((static_cast<uint64_t> (header[5]) << 32) | header[4]) != digest)
+    {
+      NS_LOG_WARN ("Route file " << filename << " was written for other scenario files");
+      return false;
+    }
+
+  // past the header a failure would leave some nodes with their routes
+  // and others without, so the remaining errors are fatal
+  FtIpv4StaticRoutingHelper helper;
+  for (uint32_t i = 0; i < header[3]; i++)
+    {
+      uint32_t nodeId;
+      is.read (reinterpret_cast<char *> (&nodeId), sizeof (uint32_t));
+      if (is.fail () || nodeId >= NodeList::GetNNodes ())
+        {
+          NS_FATAL_ERROR ("Route file " << filename << " is corrupt");
+        }
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (nodeId)->GetObject<Ipv4> ();
+      NS_ABORT_MSG_IF (ipv4 == 0, "Node " << nodeId << " has no Ipv4");
+      Ptr<FtIpv4StaticRouting> routing = helper.GetStaticRouting (ipv4);
+      NS_ABORT_MSG_IF (routing == 0, "Node " << nodeId << " has no FtIpv4StaticRouting");
+      if (!routing->DeserializeRoutes (is))
+        {
+          NS_FATAL_ERROR ("Cannot read the routes of node " << nodeId << " from " << filename);
+        }
+    }
+  return true;
+}
+
+uint64_t
+FtIpv4StaticRoutingHelper::GetFilesDigest (const std::vector<std::string> &filenames)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  uint64_t digest = 14695981039346656037ULL;
+  char buffer[4096];
+  for (std::vector<std::string>::const_iterator i = filenames.begin (); i != filenames.end (); i++)
+    {
+      std::ifstream is (i->c_str (), std::ios::in | std::ios::binary);
+      uint64_t length = 0;
+      while (is.is_open () && is.read (buffer, sizeof (buffer)).gcount () > 0)
+        {
+          for (std::streamsize k = 0; k < is.gcount (); k++)
+            {
+              digest = (digest ^ static_cast<uint8_t> (buffer[k])) * 1099511628211ULL;
+            }
+          length += is.gcount ();
+        }
+      // the length separates the files, "ab" + "c" differs from "a" + "bc"
+      for (uint32_t k = 0; k < 8; k++)
+        {
+          digest = (digest ^ static_cast<uint8_t> (length >> (8 * k))) * 1099511628211ULL;
+        }
+    }
+  return digest;
+}
+
 void
 FtIpv4StaticRoutingHelper::AddMulticastRoute (
   Ptr<Node> n,
@@ -1,6 +1,13 @@
 /*
  * This class is based on ns3::Ipv4StaticRoutingHelper with slight modifications:
  * - a helper class to create ns3::FtIpv4StaticRouting instead of ns3::Ipv4StaticRouting objects
+ * - AddFlowRoutes installs a whole set of flow host routes in one pass
+ * - RerouteFlows replaces the routes of flows, touching only the hops that change
+ * - AddBackupRoutes preinstalls fast reroute backup next hops
+ * - PrintStatisticsAll(At) dumps the lookup statistics of all nodes
+ * - SaveRoutesAll/LoadRoutesAll keep the static routes of all nodes in one binary file,
+ *   tied to the scenario files by a digest (GetFilesDigest)
+ * - AddLabelPath assigns the labels of a label switched path, RemoveLabelPath frees them
  * - note: multicast part is not modified
  */
 
@@ -34,6 +41,9 @@
 #include "ns3/ipv4-routing-helper.h"
 #include "ns3/node-container.h"
 #include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/output-stream-wrapper.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -48,6 +58,28 @@ namespace ns3 {
 class FtIpv4StaticRoutingHelper : public Ipv4RoutingHelper
 {
 public:
+  /**
+   * \brief A flow host route, as installed by AddFlowRoutes.
+   */
+  struct FlowRoute
+  {
+    uint32_t flowId;                //!< flow id of the route
+    Ptr<Node> node;                 //!< node the route is installed on
+    Ipv4Address dest;               //!< destination host
+    Ipv4Address nextHop;            //!< next hop
+    uint32_t interface;             //!< output interface index
+  };
+
+  /**
+   * \brief A hop of a label switched path, as installed by AddLabelPath.
+   */
+  struct PathHop
+  {
+    Ptr<Node> node;                 //!< node forwarding the packets
+    Ipv4Address nextHop;            //!< next hop
+    uint32_t interface;             //!< output interface index
+  };
+
   /*
    * Construct an FtIpv4StaticRoutingHelper object, used to make configuration
    * of static routing easier.
@@ -86,6 +118,127 @@ public:
    */
   Ptr<FtIpv4StaticRouting> GetStaticRouting (Ptr<Ipv4> ipv4) const;
 
+  /**
+   * \brief Install many flow host routes at once.
+   *
+   * Equivalent to calling FtIpv4StaticRouting::AddHostRouteTo (flowId, dest,
+   * nextHop, interface) on the routing of each route's node, in the order of
+   * the vector, but the routing object of every node is looked up only once
+   * and its table is grown once to its final size.
+   *
+   * \param routes the routes to install
+   */
+  void AddFlowRoutes (const std::vector<FlowRoute> &routes) const;
+
+  /**
+   * \brief Move flows from one set of host routes to another.
+   *
+   * Routes of oldRoutes that are not in newRoutes are removed with
+   * FtIpv4StaticRouting::RemoveFlowRoute, then routes of newRoutes that
+   * are not in oldRoutes are added.  Hops common to both are left alone,
+   * so only the nodes whose hop changed are touched.  Every route of
+   * oldRoutes must be installed, possibly parked on a down interface; a
+   * missing one is a fatal error.
+   *
+   * \param oldRoutes the routes currently installed
+   * \param newRoutes the routes to install instead
+   */
+  void RerouteFlows (const std::vector<FlowRoute> &oldRoutes,
+                     const std::vector<FlowRoute> &newRoutes) const;
+
+  /**
+   * \brief Preinstall backup next hops.
+   *
+   * Each entry is the backup of the route its flow uses to reach dest on
+   * its node, see FtIpv4StaticRouting::AddBackupRouteTo.
+   *
+   * \param backups the backups, nextHop and interface being those of the
+   * backup
+   * \return number of routes protected
+   */
+  uint32_t AddBackupRoutes (const std::vector<FlowRoute> &backups) const;
+
+  /**
+   * \brief Install a label switched path.
+   *
+   * A label route is added on every hop, from the last one backwards, so
+   * that each hop swaps in the label allocated by the next one
+   * (FtIpv4StaticRouting::AddLabelRoute); the last hop swaps in label 0.
+   *
+   * \param hops the hops of the path, from the source node
+   * \return the label of the first hop, to be carried by the packets the
+   * source sends (FtOnOffApplication Label attribute)
+   */
+  uint32_t AddLabelPath (const std::vector<PathHop> &hops) const;
+
+  /**
+   * \brief Remove a label switched path installed by AddLabelPath.
+   *
+   * The label routes are removed from the first hop on, each hop giving the
+   * label of the next one; packets still carrying a label of the path are
+   * dropped or, once the label is allocated again, misrouted, so the path
+   * should be removed only after they drained.
+   *
+   * \param hops the hops of the path, from the source node
+   * \param label the label of the first hop, returned by AddLabelPath
+   */
+  void RemoveLabelPath (const std::vector<PathHop> &hops, uint32_t label) const;
+
+  /**
+   * \brief Print the lookup statistics and memory usage of all nodes.
+   *
+   * Nodes without an FtIpv4StaticRouting are skipped.
+   *
+   * \param stream the ostream the statistics are printed to
+   */
+  static void PrintStatisticsAll (Ptr<OutputStreamWrapper> stream);
+
+  /**
+   * \brief Print the lookup statistics and memory usage of all nodes at a
+   * particular time.
+   *
+   * \param printTime the time at which the statistics are printed
+   * \param stream the ostream the statistics are printed to
+   */
+  static void PrintStatisticsAllAt (Time printTime, Ptr<OutputStreamWrapper> stream);
+
+  /**
+   * \brief Write the static unicast routes of all nodes to a binary file.
+   *
+   * The file starts with a magic number, a format version, the number of
+   * nodes and the digest of the scenario, followed by the node id and the
+   * routes (FtIpv4StaticRouting::SerializeRoutes) of every node with an
+   * FtIpv4StaticRouting.
+   *
+   * \param filename the file to write
+   * \param digest digest of the inputs the routes were built from (see
+   * GetFilesDigest), checked by LoadRoutesAll
+   */
+  static void SaveRoutesAll (std::string filename, uint64_t digest = 0);
+
+  /**
+   * \brief Add the routes of a file written by SaveRoutesAll to all nodes.
+   *
+   * The nodes, their interfaces and the connected routes must have been
+   * created as in the run that wrote the file; each node's routes are
+   * inserted in one bulk pass instead of being rebuilt from the scenario.
+   *
+   * \param filename the file to read
+   * \param digest digest of the current inputs, which must be the one
+   * given to SaveRoutesAll
+   * \return false if the file cannot be opened or does not match the
+   * current nodes or inputs
+   */
+  static bool LoadRoutesAll (std::string filename, uint64_t digest = 0);
+
+  /**
+   * \brief Digest of the contents of files, to tie a route file to the
+   * scenario files its routes were built from.
+   * \param filenames the files; a missing file counts as empty
+   * \return 64 bit FNV-1a hash of the length and contents of every file
+   */
+  static uint64_t GetFilesDigest (const std::vector<std::string> &filenames);
+
   /**
    * \brief Add a multicast route to a node and net device using explicit 
    * Ptr<Node> and Ptr<NetDevice>
@@ -0,0 +1,34 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Logging macros for the per-packet and per-route-entry code of the
+ * ft-internet module (route lookups, RouteInput/RouteOutput, route
+ * insertion, FtOnOffApplication send path).
+ *
+ * They forward to NS_LOG_FUNCTION, NS_LOG_LOGIC and NS_LOG_INFO, unless the
+ * module is configured with --disable-ft-hot-path-logging, which defines
+ * FT_INTERNET_NO_HOT_PATH_LOG: then they expand to nothing and their
+ * arguments are never evaluated, even in builds where NS_LOG is enabled.
+ * Logging outside of the hot paths is not affected.
+ */
+
+#ifndef FT_HOT_PATH_LOG_H
+#define FT_HOT_PATH_LOG_H
+
+#include "ns3/log.h"
+
+#ifdef FT_INTERNET_NO_HOT_PATH_LOG
+
+#define FT_HOT_LOG_FUNCTION(parameters)
+#define FT_HOT_LOG_LOGIC(msg)
+#define FT_HOT_LOG_INFO(msg)
+
+#else /* FT_INTERNET_NO_HOT_PATH_LOG */
+
+#define FT_HOT_LOG_FUNCTION(parameters) NS_LOG_FUNCTION (parameters)
+#define FT_HOT_LOG_LOGIC(msg) NS_LOG_LOGIC (msg)
+#define FT_HOT_LOG_INFO(msg) NS_LOG_INFO (msg)
+
+#endif /* FT_INTERNET_NO_HOT_PATH_LOG */
+
+#endif /* FT_HOT_PATH_LOG_H */
@@ -0,0 +1,207 @@
+/*
+ * Read-optimized forwarding table for the flow routes of FtIpv4StaticRouting:
+ * - built once from the per-flow candidate lists (see FtIpv4StaticRouting::Freeze)
+ * - flows are found through a perfect hash of their flow id
+ * - the routes of all flows are stored in one flat array, sorted by flow id
+ *   and by lookup preference, without entries that can never be selected
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ft-ipv4-flow-fib.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtIpv4FlowFib");
+
+static const uint32_t EMPTY_POSITION = 0xffffffff;
+static const uint32_t MAX_SEED_TRIES = 1 << 16;
+
+FtIpv4FlowFib::FtIpv4FlowFib ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+FtIpv4FlowFib::Clear (void)
+{
+  m_flows.clear ();
+  m_entries.clear ();
+  m_seeds.clear ();
+  m_position.clear ();
+}
+
+void
+FtIpv4FlowFib::Reserve (uint32_t flows, uint32_t entries)
+{
+  m_flows.reserve (flows);
+  m_entries.reserve (entries);
+}
+
+void
+FtIpv4FlowFib::AddFlow (uint32_t flowId)
+{
+  NS_ASSERT_MSG (m_flows.empty () || m_flows.back ().flowId < flowId,
+                 "FtIpv4FlowFib::AddFlow (): flow ids must be added in increasing order");
+  Flow flow;
+  flow.flowId = flowId;
+  flow.begin = m_entries.size ();
+  flow.end = m_entries.size ();
+  m_flows.push_back (flow);
+}
+
+void
+FtIpv4FlowFib::AddEntry (const Entry &entry)
+{
+  NS_ASSERT (!m_flows.empty ());
+  Flow &flow = m_flows.back ();
+  for (uint32_t i = flow.begin; i < flow.end; i++)
+    {
+      const Entry &e = m_entries[i];
+      if (e.mask == entry.mask
+          && (e.network & e.mask) == (entry.network & entry.mask)
+          && e.interface == entry.interface)
+        {
+          NS_LOG_LOGIC ("Flow " << flow.flowId << ": route in slot " << entry.slot
+                        << " is shadowed by slot " << e.slot);
+          return;
+        }
+    }
+  m_entries.push_back (entry);
+  flow.end++;
+}
+
+uint32_t
+FtIpv4FlowFib::Hash (uint32_t key, uint32_t seed)
+{
+  // murmur3 finalizer
+  uint32_t h = key ^ (seed * 0x9e3779b9);
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+bool
+FtIpv4FlowFib::Place (uint32_t size)
+{
+  uint32_t nBuckets = m_flows.size () / 4 + 1;
+  std::vector<std::vector<uint32_t> > buckets (nBuckets);
+  for (uint32_t i = 0; i < m_flows.size (); i++)
+    {
+      buckets[Hash (m_flows[i].flowId, 0) % nBuckets].push_back (i);
+    }
+
+  // Place the largest buckets first, while the table is still empty
+  std::vector<std::pair<uint32_t, uint32_t> > order;
+  for (uint32_t b = 0; b < nBuckets; b++)
+    {
+      order.push_back (std::make_pair (buckets[b].size (), b));
+    }
+  std::sort (order.rbegin (), order.rend ());
+
+  m_seeds.assign (nBuckets, 0);
+  m_position.assign (size, EMPTY_POSITION);
+  std::vector<uint32_t> positions;
+  for (uint32_t o = 0; o < order.size () && order[o].first > 0; o++)
+    {
+      const std::vector<uint32_t> &bucket = buckets[order[o].second];
+      bool placed = false;
+      for (uint32_t seed = 1; seed < MAX_SEED_TRIES && !placed; seed++)
+        {
+          positions.clear ();
+          placed = true;
+          for (uint32_t k = 0; k < bucket.size (); k++)
+            {
+              uint32_t position = Hash (m_flows[bucket[k]].flowId, seed) % size;
+              if (m_position[position] != EMPTY_POSITION
+                  || std::find (positions.begin (), positions.end (), position) != positions.end ())
+                {
+                  placed = false;
+                  break;
+                }
+              positions.push_back (position);
+            }
+          if (placed)
+            {
+              m_seeds[order[o].second] = seed;
+              for (uint32_t k = 0; k < bucket.size (); k++)
+                {
+                  m_position[positions[k]] = bucket[k];
+                }
+            }
+        }
+      if (!placed)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+FtIpv4FlowFib::Build (void)
+{
+  NS_LOG_FUNCTION (this << m_flows.size () << m_entries.size ());
+  if (m_flows.empty ())
+    {
+      m_seeds.clear ();
+      m_position.clear ();
+      return;
+    }
+  uint32_t size = m_flows.size () + m_flows.size () / 4 + 1;
+  while (!Place (size))
+    {
+      NS_LOG_LOGIC ("No perfect hash with " << size << " positions, growing");
+      size += size / 4 + 1;
+    }
+}
+
+bool
+FtIpv4FlowFib::Find (uint32_t flowId, const Entry *&begin, const Entry *&end) const
+{
+  if (m_position.empty ())
+    {
+      return false;
+    }
+  uint32_t seed = m_seeds[Hash (flowId, 0) % m_seeds.size ()];
+  uint32_t index = m_position[Hash (flowId, seed) % m_position.size ()];
+  if (index == EMPTY_POSITION || m_flows[index].flowId != flowId)
+    {
+      return false;
+    }
+  const Flow &flow = m_flows[index];
+  begin = &m_entries[0] + flow.begin;
+  end = &m_entries[0] + flow.end;
+  return true;
+}
+
+uint32_t
+FtIpv4FlowFib::GetNFlows (void) const
+{
+  return m_flows.size ();
+}
+
+uint32_t
+FtIpv4FlowFib::GetNEntries (void) const
+{
+  return m_entries.size ();
+}
+
+uint64_t
+FtIpv4FlowFib::GetMemoryUsage (void) const
+{
+  uint64_t bytes = sizeof (*this);
+  bytes += m_flows.capacity () * sizeof (Flow);
+  bytes += m_entries.capacity () * sizeof (Entry);
+  bytes += m_seeds.capacity () * sizeof (uint32_t);
+  bytes += m_position.capacity () * sizeof (uint32_t);
+  return bytes;
+}
+
+} // namespace ns3
@@ -0,0 +1,137 @@
+/*
+ * Read-optimized forwarding table for the flow routes of FtIpv4StaticRouting:
+ * - built once from the per-flow candidate lists (see FtIpv4StaticRouting::Freeze)
+ * - flows are found through a perfect hash of their flow id
+ * - the routes of all flows are stored in one flat array, sorted by flow id
+ *   and by lookup preference, without entries that can never be selected
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef FT_IPV4_FLOW_FIB_H
+#define FT_IPV4_FLOW_FIB_H
+
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup ipv4Routing
+ *
+ * \brief Immutable flow id to routes map.
+ *
+ * The table is filled with AddFlow/AddEntry, flow ids in increasing order
+ * and the entries of a flow in lookup preference order, then sealed with
+ * Build.  Build computes a hash-and-displace perfect hash over the flow ids:
+ * a first hash selects a bucket, and the displacement seed stored for that
+ * bucket selects a position in which no other flow id lands.  A lookup is
+ * therefore two hash computations and one key comparison.
+ *
+ * This is not a reference counted object.
+ */
+class FtIpv4FlowFib
+{
+public:
+  /**
+   * \brief A route of a flow.
+   */
+  struct Entry
+  {
+    uint32_t network;               //!< destination network
+    uint32_t mask;                  //!< destination network mask
+    uint32_t interface;             //!< output interface index
+    uint32_t slot;                  //!< slot of the route in the routing table
+  };
+
+  FtIpv4FlowFib ();
+
+  /**
+   * \brief Remove all flows.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Reserve storage.
+   * \param flows number of flows
+   * \param entries number of entries over all flows
+   */
+  void Reserve (uint32_t flows, uint32_t entries);
+
+  /**
+   * \brief Start the entries of a new flow.
+   * \param flowId flow id, greater than the previous one
+   */
+  void AddFlow (uint32_t flowId);
+
+  /**
+   * \brief Append an entry to the current flow.
+   *
+   * The entry is dropped if an earlier entry of the flow has the same
+   * destination, mask and interface, as it could never be selected.
+   *
+   * \param entry the entry
+   */
+  void AddEntry (const Entry &entry);
+
+  /**
+   * \brief Compute the perfect hash over the added flows.
+   */
+  void Build (void);
+
+  /**
+   * \brief Find the entries of a flow.
+   * \param flowId flow id
+   * \param begin first entry of the flow, set only on success
+   * \param end past the last entry of the flow, set only on success
+   * \return true if the flow has entries
+   */
+  bool Find (uint32_t flowId, const Entry *&begin, const Entry *&end) const;
+
+  /**
+   * \return number of flows
+   */
+  uint32_t GetNFlows (void) const;
+
+  /**
+   * \return number of entries over all flows
+   */
+  uint32_t GetNEntries (void) const;
+
+  /**
+   * \return bytes allocated by the table
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /// The entries of a flow
+  struct Flow
+  {
+    uint32_t flowId;                //!< flow id
+    uint32_t begin;                 //!< first entry in m_entries
+    uint32_t end;                   //!< past the last entry in m_entries
+  };
+
+  /**
+   * \param key flow id
+   * \param seed hash seed
+   * \return 32 bit hash of the key
+   */
+  static uint32_t Hash (uint32_t key, uint32_t seed);
+
+  /**
+   * \brief Try to place every flow with the given table size.
+   * \param size number of positions
+   * \return true on success
+   */
+  bool Place (uint32_t size);
+
+  std::vector<Flow> m_flows;        //!< flows, by flow id
+  std::vector<Entry> m_entries;     //!< entries of all flows
+  std::vector<uint32_t> m_seeds;    //!< displacement seed of every bucket
+  std::vector<uint32_t> m_position; //!< index in m_flows by hash position
+};
+
+} // namespace ns3
+
+#endif /* FT_IPV4_FLOW_FIB_H */
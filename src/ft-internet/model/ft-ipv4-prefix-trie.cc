@@ -0,0 +1,277 @@
+/*
+ * Longest prefix match structure for the routes of FtIpv4StaticRouting
+ * that are not bound to a flow (flowId 0):
+ * - contiguous masks are stored in a binary trie, one level per address bit
+ * - routes with a non-contiguous mask are kept in a small sorted side list
+ * - the selection rules of the linear table scan (metric, insertion order,
+ *   output interface filter) are preserved
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ft-ipv4-prefix-trie.h"
+#include "ft-hot-path-log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtIpv4PrefixTrie");
+
+FtIpv4PrefixTrie::FtIpv4PrefixTrie ()
+  : m_n (0)
+{
+  NS_LOG_FUNCTION (this);
+  Clear ();
+}
+
+bool
+FtIpv4PrefixTrie::IsPreferred (const Route &a, const Route &b, uint16_t prefixLength)
+{
+  if (prefixLength == 32)
+    {
+      return a.sequence < b.sequence;
+    }
+  if (a.metric != b.metric)
+    {
+      return a.metric < b.metric;
+    }
+  return a.sequence > b.sequence;
+}
+
+bool
+FtIpv4PrefixTrie::IsPreferredIrregular (const IrregularRoute &a, const IrregularRoute &b)
+{
+  if (a.prefixLength != b.prefixLength)
+    {
+      return a.prefixLength > b.prefixLength;
+    }
+  return IsPreferred (a.route, b.route, a.prefixLength);
+}
+
+bool
+FtIpv4PrefixTrie::IsContiguous (uint32_t mask)
+{
+  uint32_t hostBits = ~mask;
+  return (hostBits & (hostBits + 1)) == 0;
+}
+
+uint32_t
+FtIpv4PrefixTrie::AllocateNode (void)
+{
+  uint32_t index;
+  if (!m_freeNodes.empty ())
+    {
+      index = m_freeNodes.back ();
+      m_freeNodes.pop_back ();
+    }
+  else
+    {
+      index = m_nodes.size ();
+      m_nodes.push_back (Node ());
+    }
+  m_nodes[index].child[0] = 0;
+  m_nodes[index].child[1] = 0;
+  m_nodes[index].routes.clear ();
+  return index;
+}
+
+void
+FtIpv4PrefixTrie::Insert (Ipv4Address network, Ipv4Mask networkMask, const Route &route)
+{
+  FT_HOT_LOG_FUNCTION (this << network << networkMask << route.slot);
+  uint32_t mask = networkMask.Get ();
+  uint16_t prefixLength = networkMask.GetPrefixLength ();
+  m_n++;
+
+  if (!IsContiguous (mask))
+    {
+      IrregularRoute irregular;
+      irregular.network = network.Get ();
+      irregular.mask = mask;
+      irregular.prefixLength = prefixLength;
+      irregular.route = route;
+      m_irregular.insert (std::upper_bound (m_irregular.begin (), m_irregular.end (),
+                                            irregular, &IsPreferredIrregular),
+                          irregular);
+      return;
+    }
+
+  // The scan compares the destination against the stored network under the
+  // mask, so the host bits of the network do not take part in the match.
+  uint32_t addr = network.Get ();
+  uint32_t node = 0;
+  for (uint16_t depth = 0; depth < prefixLength; depth++)
+    {
+      uint32_t bit = (addr >> (31 - depth)) & 1;
+      if (m_nodes[node].child[bit] == 0)
+        {
+          uint32_t child = AllocateNode ();
+          m_nodes[node].child[bit] = child;
+        }
+      node = m_nodes[node].child[bit];
+    }
+
+  std::vector<Route> &routes = m_nodes[node].routes;
+  std::vector<Route>::iterator it = routes.begin ();
+  while (it != routes.end () && !IsPreferred (route, *it, prefixLength))
+    {
+      it++;
+    }
+  routes.insert (it, route);
+}
+
+bool
+FtIpv4PrefixTrie::Remove (Ipv4Address network, Ipv4Mask networkMask, uint32_t slot)
+{
+  FT_HOT_LOG_FUNCTION (this << network << networkMask << slot);
+  uint32_t mask = networkMask.Get ();
+  uint16_t prefixLength = networkMask.GetPrefixLength ();
+
+  if (!IsContiguous (mask))
+    {
+      for (std::vector<IrregularRoute>::iterator i = m_irregular.begin (); i != m_irregular.end (); i++)
+        {
+          if (i->route.slot == slot)
+            {
+              m_irregular.erase (i);
+              m_n--;
+              return true;
+            }
+        }
+      return false;
+    }
+
+  uint32_t path[33];
+  uint32_t addr = network.Get ();
+  path[0] = 0;
+  for (uint16_t depth = 0; depth < prefixLength; depth++)
+    {
+      uint32_t bit = (addr >> (31 - depth)) & 1;
+      path[depth + 1] = m_nodes[path[depth]].child[bit];
+      if (path[depth + 1] == 0)
+        {
+          return false;
+        }
+    }
+
+  std::vector<Route> &routes = m_nodes[path[prefixLength]].routes;
+  std::vector<Route>::iterator it = routes.begin ();
+  while (it != routes.end () && it->slot != slot)
+    {
+      it++;
+    }
+  if (it == routes.end ())
+    {
+      return false;
+    }
+  routes.erase (it);
+  m_n--;
+
+  // Release the nodes that no longer lead to any route
+  for (uint16_t depth = prefixLength; depth > 0; depth--)
+    {
+      Node &n = m_nodes[path[depth]];
+      if (!n.routes.empty () || n.child[0] != 0 || n.child[1] != 0)
+        {
+          break;
+        }
+      uint32_t bit = (addr >> (32 - depth)) & 1;
+      m_nodes[path[depth - 1]].child[bit] = 0;
+      m_freeNodes.push_back (path[depth]);
+    }
+  return true;
+}
+
+void
+FtIpv4PrefixTrie::Clear (void)
+{
+  m_nodes.clear ();
+  m_freeNodes.clear ();
+  m_irregular.clear ();
+  m_n = 0;
+  AllocateNode ();
+}
+
+bool
+FtIpv4PrefixTrie::Lookup (Ipv4Address dest, bool anyInterface, uint32_t interface, uint32_t &slot,
+                          uint32_t &examined) const
+{
+  uint32_t addr = dest.Get ();
+  const Route *best = 0;
+  uint16_t bestLength = 0;
+
+  // Walk down the path of dest; deeper matches replace shallower ones
+  uint32_t node = 0;
+  for (uint16_t depth = 0; ; depth++)
+    {
+      const Node &n = m_nodes[node];
+      examined++;
+      for (std::vector<Route>::const_iterator i = n.routes.begin (); i != n.routes.end (); i++)
+        {
+          examined++;
+          if (anyInterface || i->interface == interface)
+            {
+              best = &(*i);
+              bestLength = depth;
+              break;
+            }
+        }
+      if (depth == 32)
+        {
+          break;
+        }
+      node = n.child[(addr >> (31 - depth)) & 1];
+      if (node == 0)
+        {
+          break;
+        }
+    }
+
+  for (std::vector<IrregularRoute>::const_iterator i = m_irregular.begin (); i != m_irregular.end (); i++)
+    {
+      examined++;
+      if ((addr & i->mask) != (i->network & i->mask)
+          || !(anyInterface || i->route.interface == interface))
+        {
+          continue;
+        }
+      if (best == 0
+          || i->prefixLength > bestLength
+          || (i->prefixLength == bestLength && IsPreferred (i->route, *best, bestLength)))
+        {
+          best = &i->route;
+        }
+      break;
+    }
+
+  if (best == 0)
+    {
+      return false;
+    }
+  slot = best->slot;
+  return true;
+}
+
+uint32_t
+FtIpv4PrefixTrie::GetN (void) const
+{
+  return m_n;
+}
+
+uint64_t
+FtIpv4PrefixTrie::GetMemoryUsage (void) const
+{
+  uint64_t bytes = sizeof (*this);
+  bytes += m_nodes.capacity () * sizeof (Node);
+  for (std::vector<Node>::const_iterator i = m_nodes.begin (); i != m_nodes.end (); i++)
+    {
+      bytes += i->routes.capacity () * sizeof (Route);
+    }
+  bytes += m_freeNodes.capacity () * sizeof (uint32_t);
+  bytes += m_irregular.capacity () * sizeof (IrregularRoute);
+  return bytes;
+}
+
+} // namespace ns3
@@ -0,0 +1,153 @@
+/*
+ * Longest prefix match structure for the routes of FtIpv4StaticRouting
+ * that are not bound to a flow (flowId 0):
+ * - contiguous masks are stored in a binary trie, one level per address bit
+ * - routes with a non-contiguous mask are kept in a small sorted side list
+ * - the selection rules of the linear table scan (metric, insertion order,
+ *   output interface filter) are preserved
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef FT_IPV4_PREFIX_TRIE_H
+#define FT_IPV4_PREFIX_TRIE_H
+
+#include <vector>
+#include <stdint.h>
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup ipv4Routing
+ *
+ * \brief Binary trie for longest prefix match over Ipv4 routes.
+ *
+ * Every trie node corresponds to a prefix and holds the routes to that
+ * prefix, ordered the way the linear scan of Ipv4StaticRouting would prefer
+ * them: among host routes (/32) the first added wins, among shorter prefixes
+ * the lowest metric wins and, for equal metrics, the last added.  A lookup
+ * walks at most 32 levels and keeps the deepest route that passes the output
+ * interface filter.
+ *
+ * Nodes live in a single vector and refer to each other by index, so the
+ * structure does not allocate per node.  The trie only knows the slots of
+ * the routes; the routes themselves are stored in FtIpv4RoutingTable.
+ *
+ * This is not a reference counted object.
+ */
+class FtIpv4PrefixTrie
+{
+public:
+  /**
+   * \brief A route as seen by the trie.
+   */
+  struct Route
+  {
+    uint32_t slot;                  //!< slot of the route in the routing table
+    uint32_t interface;             //!< output interface index
+    uint32_t metric;                //!< metric of the route
+    uint64_t sequence;              //!< insertion order of the route
+  };
+
+  FtIpv4PrefixTrie ();
+
+  /**
+   * \brief Add a route.
+   * \param network destination network
+   * \param networkMask destination network mask
+   * \param route the route
+   */
+  void Insert (Ipv4Address network, Ipv4Mask networkMask, const Route &route);
+
+  /**
+   * \brief Remove a route.
+   * \param network destination network the route was inserted with
+   * \param networkMask destination network mask the route was inserted with
+   * \param slot slot of the route
+   * \return true if the route was found and removed
+   */
+  bool Remove (Ipv4Address network, Ipv4Mask networkMask, uint32_t slot);
+
+  /**
+   * \brief Remove all routes.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Longest prefix match.
+   * \param dest destination address
+   * \param anyInterface if true, routes on every interface are considered
+   * \param interface output interface index the route must use, if
+   * anyInterface is false
+   * \param slot slot of the selected route, set only on success
+   * \param examined incremented by the number of trie nodes and routes visited
+   * \return true if a route was found
+   */
+  bool Lookup (Ipv4Address dest, bool anyInterface, uint32_t interface, uint32_t &slot,
+               uint32_t &examined) const;
+
+  /**
+   * \return number of routes in the trie
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \return bytes allocated by the trie
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /// A prefix of the trie
+  struct Node
+  {
+    uint32_t child[2];              //!< children by next address bit, 0 if none
+    std::vector<Route> routes;      //!< routes to this prefix, by preference
+  };
+
+  /// A route whose mask is not a prefix
+  struct IrregularRoute
+  {
+    uint32_t network;               //!< destination network
+    uint32_t mask;                  //!< destination network mask
+    uint16_t prefixLength;          //!< Ipv4Mask::GetPrefixLength of the mask
+    Route route;                    //!< the route
+  };
+
+  /**
+   * \brief Compare two routes to the same prefix.
+   * \param a first route
+   * \param b second route
+   * \param prefixLength prefix length of both routes
+   * \return true if a is chosen over b
+   */
+  static bool IsPreferred (const Route &a, const Route &b, uint16_t prefixLength);
+
+  /**
+   * \brief Compare two irregular routes, longer prefixes first.
+   * \param a first route
+   * \param b second route
+   * \return true if a is chosen over b
+   */
+  static bool IsPreferredIrregular (const IrregularRoute &a, const IrregularRoute &b);
+
+  /**
+   * \param mask a network mask
+   * \return true if the mask is a run of leading ones
+   */
+  static bool IsContiguous (uint32_t mask);
+
+  /**
+   * \return index of a new, empty node
+   */
+  uint32_t AllocateNode (void);
+
+  std::vector<Node> m_nodes;                //!< trie nodes, m_nodes[0] is the root
+  std::vector<uint32_t> m_freeNodes;        //!< unused entries of m_nodes
+  std::vector<IrregularRoute> m_irregular;  //!< non-contiguous masks, by preference
+  uint32_t m_n;                             //!< number of routes
+};
+
+} // namespace ns3
+
+#endif /* FT_IPV4_PREFIX_TRIE_H */
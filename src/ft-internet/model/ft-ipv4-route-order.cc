@@ -0,0 +1,238 @@
+/*
+ * Insertion order view of the routes of FtIpv4StaticRouting:
+ * - entries are slots; a removed slot leaves a hole, squeezed out only when the
+ *   holes make up half of the view
+ * - an entry can be hidden (parked route) without losing its place
+ * - a Fenwick tree counts the visible entries, so access by index is logarithmic
+ *   and a walk by increasing index is linear
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ft-ipv4-route-order.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtIpv4RouteOrder");
+
+/// Marks a removed slot in m_order, and a slot out of the view in m_position
+static const uint32_t HOLE = 0xffffffff;
+
+FtIpv4RouteOrder::FtIpv4RouteOrder ()
+  : m_holes (0),
+    m_nVisible (0),
+    m_lastIndex (0),
+    m_lastPosition (HOLE)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+FtIpv4RouteOrder::Append (uint32_t slot)
+{
+  NS_ASSERT_MSG (!Contains (slot), "FtIpv4RouteOrder::Append (): slot " << slot << " already in the view");
+  if (slot >= m_position.size ())
+    {
+      m_position.resize (slot + 1, HOLE);
+      m_hidden.resize (slot + 1, 0);
+    }
+  m_position[slot] = m_order.size ();
+  m_hidden[slot] = 0;
+  m_order.push_back (slot);
+  // node i of the tree covers positions (i - lowbit (i), i]: the new node
+  // counts the new slot plus the visible slots of the positions it covers
+  uint32_t i = m_order.size ();
+  uint32_t first = i - (i & (~i + 1));
+  if (m_tree.empty ())
+    {
+      m_tree.push_back (0);
+    }
+  m_tree.push_back (1 + CountBefore (i - 1) - CountBefore (first));
+  m_nVisible++;
+}
+
+void
+FtIpv4RouteOrder::Remove (uint32_t slot)
+{
+  NS_ASSERT_MSG (Contains (slot), "FtIpv4RouteOrder::Remove (): slot " << slot << " not in the view");
+  uint32_t position = m_position[slot];
+  if (!m_hidden[slot])
+    {
+      Update (position, -1);
+      m_nVisible--;
+    }
+  m_order[position] = HOLE;
+  m_position[slot] = HOLE;
+  m_hidden[slot] = 0;
+  m_holes++;
+  m_lastPosition = HOLE;
+  if (m_holes > m_order.size () / 2)
+    {
+      Compact ();
+    }
+}
+
+void
+FtIpv4RouteOrder::Hide (uint32_t slot)
+{
+  NS_ASSERT_MSG (IsVisible (slot), "FtIpv4RouteOrder::Hide (): slot " << slot << " not visible");
+  Update (m_position[slot], -1);
+  m_hidden[slot] = 1;
+  m_nVisible--;
+  m_lastPosition = HOLE;
+}
+
+void
+FtIpv4RouteOrder::Show (uint32_t slot)
+{
+  NS_ASSERT_MSG (Contains (slot) && m_hidden[slot], "FtIpv4RouteOrder::Show (): slot " << slot << " not hidden");
+  Update (m_position[slot], 1);
+  m_hidden[slot] = 0;
+  m_nVisible++;
+  m_lastPosition = HOLE;
+}
+
+bool
+FtIpv4RouteOrder::Contains (uint32_t slot) const
+{
+  return slot < m_position.size () && m_position[slot] != HOLE;
+}
+
+bool
+FtIpv4RouteOrder::IsVisible (uint32_t slot) const
+{
+  return Contains (slot) && !m_hidden[slot];
+}
+
+bool
+FtIpv4RouteOrder::IsVisibleAt (uint32_t position) const
+{
+  uint32_t slot = m_order[position];
+  return slot != HOLE && !m_hidden[slot];
+}
+
+uint32_t
+FtIpv4RouteOrder::GetN (void) const
+{
+  return m_nVisible;
+}
+
+uint32_t
+FtIpv4RouteOrder::GetSlot (uint32_t index) const
+{
+  NS_ASSERT_MSG (index < m_nVisible, "FtIpv4RouteOrder::GetSlot (): index out of range");
+  if (m_lastPosition != HOLE && index == m_lastIndex)
+    {
+      return m_order[m_lastPosition];
+    }
+  uint32_t position;
+  if (m_lastPosition != HOLE && index == m_lastIndex + 1)
+    {
+      // walk by increasing index: step to the next visible slot
+      position = m_lastPosition + 1;
+      while (!IsVisibleAt (position))
+        {
+          position++;
+        }
+    }
+  else
+    {
+      // descend the tree to the last node with fewer than index + 1 visible slots
+      uint32_t node = 0;
+      uint32_t remaining = index + 1;
+      uint32_t step = 1;
+      while (step * 2 < m_tree.size ())
+        {
+          step *= 2;
+        }
+      for (; step > 0; step /= 2)
+        {
+          if (node + step < m_tree.size () && m_tree[node + step] < remaining)
+            {
+              node += step;
+              remaining -= m_tree[node];
+            }
+        }
+      position = node;
+    }
+  NS_ASSERT (position < m_order.size () && IsVisibleAt (position));
+  m_lastIndex = index;
+  m_lastPosition = position;
+  return m_order[position];
+}
+
+void
+FtIpv4RouteOrder::Update (uint32_t position, int32_t delta)
+{
+  for (uint32_t i = position + 1; i < m_tree.size (); i += i & (~i + 1))
+    {
+      m_tree[i] += delta;
+    }
+}
+
+uint32_t
+FtIpv4RouteOrder::CountBefore (uint32_t end) const
+{
+  uint32_t count = 0;
+  for (uint32_t i = end; i > 0; i -= i & (~i + 1))
+    {
+      count += m_tree[i];
+    }
+  return count;
+}
+
+void
+FtIpv4RouteOrder::Compact (void)
+{
+  NS_LOG_FUNCTION (this << m_order.size () << m_holes);
+  m_order.erase (std::remove (m_order.begin (), m_order.end (), HOLE), m_order.end ());
+  m_tree.assign (m_order.size () + 1, 0);
+  for (uint32_t i = 1; i <= m_order.size (); i++)
+    {
+      uint32_t slot = m_order[i - 1];
+      m_position[slot] = i - 1;
+      m_tree[i] += m_hidden[slot] ? 0 : 1;
+      uint32_t parent = i + (i & (~i + 1));
+      if (parent <= m_order.size ())
+        {
+          m_tree[parent] += m_tree[i];
+        }
+    }
+  m_holes = 0;
+  m_lastPosition = HOLE;
+}
+
+void
+FtIpv4RouteOrder::Clear (void)
+{
+  m_order.clear ();
+  m_position.clear ();
+  m_hidden.clear ();
+  m_tree.clear ();
+  m_holes = 0;
+  m_nVisible = 0;
+  m_lastPosition = HOLE;
+}
+
+void
+FtIpv4RouteOrder::Reserve (uint32_t n)
+{
+  m_order.reserve (n);
+  m_position.reserve (n);
+  m_hidden.reserve (n);
+  m_tree.reserve (n + 1);
+}
+
+uint64_t
+FtIpv4RouteOrder::GetMemoryUsage (void) const
+{
+  return m_order.capacity () * sizeof (uint32_t)
+         + m_position.capacity () * sizeof (uint32_t)
+         + m_hidden.capacity () * sizeof (uint8_t)
+         + m_tree.capacity () * sizeof (uint32_t);
+}
+
+} // namespace ns3
@@ -0,0 +1,144 @@
+/*
+ * Insertion order view of the routes of FtIpv4StaticRouting:
+ * - entries are slots; a removed slot leaves a hole, squeezed out only when the
+ *   holes make up half of the view
+ * - an entry can be hidden (parked route) without losing its place
+ * - a Fenwick tree counts the visible entries, so access by index is logarithmic
+ *   and a walk by increasing index is linear
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef FT_IPV4_ROUTE_ORDER_H
+#define FT_IPV4_ROUTE_ORDER_H
+
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup ipv4Routing
+ *
+ * \brief Slots of a route table in insertion order, accessed by index.
+ *
+ * Every slot of the view is either visible or hidden; only visible slots
+ * have an index, which is their rank among the visible slots.  Appending a
+ * slot, removing it and hiding or showing it are O(log n).  Removing leaves
+ * a hole at the position of the slot; the holes are squeezed out in one
+ * pass when they make up half of the view, so removal stays O(log n)
+ * amortized.  Hiding keeps the position, so a slot shown again is back at
+ * its place in insertion order.
+ *
+ * GetSlot (index) selects the index-th visible slot on the Fenwick tree in
+ * O(log n), except right after GetSlot (index - 1), where it steps forward
+ * from the previous position: a walk over all indexes is linear.
+ *
+ * This is not a reference counted object.
+ */
+class FtIpv4RouteOrder
+{
+public:
+  FtIpv4RouteOrder ();
+
+  /**
+   * \brief Append a visible slot at the end of the view.
+   * \param slot a slot not in the view
+   */
+  void Append (uint32_t slot);
+
+  /**
+   * \brief Remove a slot, visible or hidden, from the view.
+   * \param slot a slot in the view
+   */
+  void Remove (uint32_t slot);
+
+  /**
+   * \brief Hide a slot; it keeps its position but has no index.
+   * \param slot a visible slot
+   */
+  void Hide (uint32_t slot);
+
+  /**
+   * \brief Show a hidden slot again at its position.
+   * \param slot a hidden slot
+   */
+  void Show (uint32_t slot);
+
+  /**
+   * \param slot a slot
+   * \return true if the slot is in the view, visible or hidden
+   */
+  bool Contains (uint32_t slot) const;
+
+  /**
+   * \param slot a slot
+   * \return true if the slot is in the view and visible
+   */
+  bool IsVisible (uint32_t slot) const;
+
+  /**
+   * \return number of visible slots
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param index index of a visible slot, below GetN ()
+   * \return the slot
+   */
+  uint32_t GetSlot (uint32_t index) const;
+
+  /**
+   * \brief Remove all slots.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Reserve storage for n slots.
+   * \param n number of slots
+   */
+  void Reserve (uint32_t n);
+
+  /**
+   * \return bytes allocated by the view
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /**
+   * \brief Add delta to the count of the position in the Fenwick tree.
+   * \param position position in m_order
+   * \param delta +1 or -1
+   */
+  void Update (uint32_t position, int32_t delta);
+
+  /**
+   * \param end a position in m_order
+   * \return number of visible slots before the position
+   */
+  uint32_t CountBefore (uint32_t end) const;
+
+  /**
+   * \brief Squeeze the holes out of m_order and rebuild the Fenwick tree.
+   */
+  void Compact (void);
+
+  /**
+   * \param position a position in m_order
+   * \return true if a visible slot is at the position
+   */
+  bool IsVisibleAt (uint32_t position) const;
+
+  std::vector<uint32_t> m_order;    //!< slots in insertion order, with holes
+  std::vector<uint32_t> m_position; //!< position of every slot in m_order, or a hole marker
+  std::vector<uint8_t> m_hidden;    //!< whether every slot is hidden
+  std::vector<uint32_t> m_tree;     //!< Fenwick tree of the visible slots over m_order (1-based)
+  uint32_t m_holes;                 //!< number of holes in m_order
+  uint32_t m_nVisible;              //!< number of visible slots
+  mutable uint32_t m_lastIndex;     //!< index of the last GetSlot
+  mutable uint32_t m_lastPosition;  //!< position of the last GetSlot, or a hole marker
+};
+
+} // namespace ns3
+
+#endif /* FT_IPV4_ROUTE_ORDER_H */
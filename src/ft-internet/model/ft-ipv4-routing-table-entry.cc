@@ -1,6 +1,7 @@
 /*
  * This class is based on ns3::Ipv4RoutingTableEntry with slight modifications:
  * - additional parameter uint32_t flowId in the entry
+ * - range routes also carry the last flow id they cover (CreateFlowRangeRouteTo)
  * - multicast part is not modified (only class name FtIpv4MulticastRoutingTableEntry)
  */
 
@@ -37,12 +38,16 @@ NS_LOG_COMPONENT_DEFINE ("FtIpv4RoutingTableEntry");
  *****************************************************/
 
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry ()
+  : m_flowId (0),
+    m_lastFlowId (0)
 {
   NS_LOG_FUNCTION (this);
 }
 
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (FtIpv4RoutingTableEntry const &route)
-  : m_dest (route.m_dest),
+  : m_flowId (route.m_flowId),
+    m_lastFlowId (route.m_lastFlowId),
+    m_dest (route.m_dest),
     m_destNetworkMask (route.m_destNetworkMask),
     m_gateway (route.m_gateway),
     m_interface (route.m_interface)
@@ -51,7 +56,9 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (FtIpv4RoutingTableEntry const
 }
 
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (FtIpv4RoutingTableEntry const *route)
-  : m_dest (route->m_dest),
+  : m_flowId (route->m_flowId),
+    m_lastFlowId (route->m_lastFlowId),
+    m_dest (route->m_dest),
     m_destNetworkMask (route->m_destNetworkMask),
     m_gateway (route->m_gateway),
     m_interface (route->m_interface)
@@ -62,7 +69,9 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (FtIpv4RoutingTableEntry const
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address dest,
                                               Ipv4Address gateway,
                                               uint32_t interface)
-  : m_dest (dest),
+  : m_flowId (0),
+    m_lastFlowId (0),
+    m_dest (dest),
     m_destNetworkMask (Ipv4Mask::GetOnes ()),
     m_gateway (gateway),
     m_interface (interface)
@@ -70,7 +79,9 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address dest,
 }
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address dest,
                                               uint32_t interface)
-  : m_dest (dest),
+  : m_flowId (0),
+    m_lastFlowId (0),
+    m_dest (dest),
     m_destNetworkMask (Ipv4Mask::GetOnes ()),
     m_gateway (Ipv4Address::GetZero ()),
     m_interface (interface)
@@ -80,7 +91,9 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address network,
                                               Ipv4Mask networkMask,
                                               Ipv4Address gateway,
                                               uint32_t interface)
-  : m_dest (network),
+  : m_flowId (0),
+    m_lastFlowId (0),
+    m_dest (network),
     m_destNetworkMask (networkMask),
     m_gateway (gateway),
     m_interface (interface)
@@ -90,7 +103,9 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address network,
 FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (Ipv4Address network,
                                               Ipv4Mask networkMask,
                                               uint32_t interface)
-  : m_dest (network),
+  : m_flowId (0),
+    m_lastFlowId (0),
+    m_dest (network),
     m_destNetworkMask (networkMask),
     m_gateway (Ipv4Address::GetZero ()),
     m_interface (interface)
@@ -103,6 +118,7 @@ FtIpv4RoutingTableEntry::FtIpv4RoutingTableEntry (uint32_t flowId,
                                               Ipv4Address gateway,
                                               uint32_t interface)
   : m_flowId (flowId),
+    m_lastFlowId (flowId),
     m_dest (network),
     m_destNetworkMask (networkMask),
     m_gateway (gateway),
@@ -193,6 +209,12 @@ FtIpv4RoutingTableEntry::GetFlowId (void) const
   NS_LOG_FUNCTION (this);
   return m_flowId;
 }
+uint32_t
+FtIpv4RoutingTableEntry::GetLastFlowId (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_lastFlowId;
+}
 
 FtIpv4RoutingTableEntry
 FtIpv4RoutingTableEntry::CreateHostRouteTo (Ipv4Address dest,
@@ -240,6 +262,20 @@ FtIpv4RoutingTableEntry::CreateNetworkRouteTo (uint32_t flowId,
                                 nextHop, interface);
 }
 FtIpv4RoutingTableEntry
+FtIpv4RoutingTableEntry::CreateFlowRangeRouteTo (uint32_t firstFlowId,
+                                               uint32_t lastFlowId,
+                                               Ipv4Address network,
+                                               Ipv4Mask networkMask,
+                                               Ipv4Address nextHop,
+                                               uint32_t interface)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ASSERT (lastFlowId >= firstFlowId);
+  FtIpv4RoutingTableEntry route (firstFlowId, network, networkMask, nextHop, interface);
+  route.m_lastFlowId = lastFlowId;
+  return route;
+}
+FtIpv4RoutingTableEntry
 FtIpv4RoutingTableEntry::CreateDefaultRoute (Ipv4Address nextHop,
                                            uint32_t interface)
 {
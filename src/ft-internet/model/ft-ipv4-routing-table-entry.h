@@ -1,6 +1,7 @@
 /*
  * This class is based on ns3::Ipv4RoutingTableEntry with slight modifications:
  * - additional parameter uint32_t flowId in the entry
+ * - range routes also carry the last flow id they cover (CreateFlowRangeRouteTo)
  * - multicast part is not modified (only class name FtIpv4MulticastRoutingTableEntry)
  */
 
@@ -24,7 +25,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #ifndef FT_IPV4_ROUTING_TABLE_ENTRY_H
-#define Ft_IPV4_ROUTING_TABLE_ENTRY_H
+#define FT_IPV4_ROUTING_TABLE_ENTRY_H
 
 #include <list>
 #include <vector>
@@ -95,9 +96,15 @@ public:
    */
   uint32_t GetInterface (void) const;
   /**
-   * \return The flow id
+   * \return The flow id (0 for routes added without a flow id), the first
+   * flow id of a range route
    */
   uint32_t GetFlowId (void) const;
+  /**
+   * \return The last flow id covered by the route: GetFlowId () except for
+   * a range route
+   */
+  uint32_t GetLastFlowId (void) const;
   
 
   /**
@@ -160,6 +167,22 @@ public:
                                                      Ipv4Address nextHop,
                                                      uint32_t interface);
 
+  /**
+   * \return An FtIpv4RoutingTableEntry object corresponding to the input parameters.
+   * \param firstFlowId first flow id of the range
+   * \param lastFlowId last flow id of the range
+   * \param network Ipv4Address of the destination network
+   * \param networkMask Ipv4Mask of the destination network mask
+   * \param nextHop Ipv4Address of the next hop
+   * \param interface Outgoing interface 
+   */
+  static FtIpv4RoutingTableEntry CreateFlowRangeRouteTo (uint32_t firstFlowId,
+                                                       uint32_t lastFlowId,
+                                                       Ipv4Address network,
+                                                       Ipv4Mask networkMask,
+                                                       Ipv4Address nextHop,
+                                                       uint32_t interface);
+
 private:
   /**
    * \brief Constructor.
@@ -213,6 +236,7 @@ private:
                          uint32_t interface);
 
   uint32_t m_flowId;          //!< ft flow id
+  uint32_t m_lastFlowId;      //!< last flow id of a range route, m_flowId otherwise
   Ipv4Address m_dest;         //!< destination address
   Ipv4Mask m_destNetworkMask; //!< destination network mask
   Ipv4Address m_gateway;      //!< gateway
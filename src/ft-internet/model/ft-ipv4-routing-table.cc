@@ -0,0 +1,309 @@
+/*
+ * Storage for the unicast routes of FtIpv4StaticRouting:
+ * - routes are kept in parallel arrays (one array per field) instead of a list
+ *   of heap allocated FtIpv4RoutingTableEntry objects
+ * - every route is identified by a slot that stays valid until the route is removed
+ * - the insertion order view is an FtIpv4RouteOrder: access by index is logarithmic,
+ *   a dump by index is linear and removal does not shift the other routes
+ * - routes are indexed by output interface and can be parked while their
+ *   interface is down
+ * - routes carry a multipath weight (0 for ordinary routes)
+ * - routes can cover a range of flow ids (flow span, 0 for a single flow id)
+ * - parked routes are indexed by flow id, so they can be found and removed
+ * - backup routes are hidden in the order, like parked routes, but stay indexed
+ *   by output interface
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ft-ipv4-routing-table.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtIpv4RoutingTable");
+
+FtIpv4RoutingTable::FtIpv4RoutingTable ()
+  : m_nextSequence (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+FtIpv4RoutingTable::Add (uint32_t flowId, Ipv4Address network, Ipv4Mask networkMask,
+                         Ipv4Address gateway, uint32_t interface, uint32_t metric,
+                         uint8_t flags, uint32_t weight, uint32_t flowSpan)
+{
+  uint32_t slot;
+  if (!m_freeSlots.empty ())
+    {
+      slot = m_freeSlots.back ();
+      m_freeSlots.pop_back ();
+    }
+  else
+    {
+      slot = m_dest.size ();
+      m_dest.push_back (0);
+      m_mask.push_back (0);
+      m_prefixLength.push_back (0);
+      m_gateway.push_back (0);
+      m_interface.push_back (0);
+      m_flowId.push_back (0);
+      m_flowSpan.push_back (0);
+      m_metric.push_back (0);
+      m_weight.push_back (0);
+      m_sequence.push_back (0);
+      m_flags.push_back (0);
+      m_interfacePosition.push_back (0);
+    }
+  m_dest[slot] = network.Get ();
+  m_mask[slot] = networkMask.Get ();
+  m_prefixLength[slot] = networkMask.GetPrefixLength ();
+  m_gateway[slot] = gateway.Get ();
+  m_interface[slot] = interface;
+  m_flowId[slot] = flowId;
+  m_flowSpan[slot] = flowSpan;
+  m_metric[slot] = metric;
+  m_weight[slot] = weight;
+  m_sequence[slot] = m_nextSequence++;
+  m_flags[slot] = flags & ~PARKED;
+  m_order.Append (slot);
+  if (flags & BACKUP)
+    {
+      m_order.Hide (slot);
+    }
+  AttachToInterface (slot, m_interfaceRoutes);
+  return slot;
+}
+
+void
+FtIpv4RoutingTable::AttachToInterface (uint32_t slot, InterfaceSlots &index)
+{
+  uint32_t interface = m_interface[slot];
+  if (interface >= index.size ())
+    {
+      index.resize (interface + 1);
+    }
+  m_interfacePosition[slot] = index[interface].size ();
+  index[interface].push_back (slot);
+}
+
+void
+FtIpv4RoutingTable::DetachFromInterface (uint32_t slot, InterfaceSlots &index)
+{
+  std::vector<uint32_t> &slots = index[m_interface[slot]];
+  uint32_t position = m_interfacePosition[slot];
+  NS_ASSERT (position < slots.size () && slots[position] == slot);
+  slots[position] = slots.back ();
+  m_interfacePosition[slots[position]] = position;
+  slots.pop_back ();
+}
+
+void
+FtIpv4RoutingTable::Remove (uint32_t slot)
+{
+  NS_ASSERT_MSG (m_order.Contains (slot), "FtIpv4RoutingTable::Remove (): no route in slot " << slot);
+  if (IsParked (slot))
+    {
+      DetachFromInterface (slot, m_parkedRoutes);
+      m_parkedFlows.erase (std::make_pair (m_flowId[slot], slot));
+      m_parkedSpans.erase (m_parkedSpans.find (m_flowSpan[slot]));
+      m_flags[slot] &= ~PARKED;
+    }
+  else
+    {
+      DetachFromInterface (slot, m_interfaceRoutes);
+    }
+  m_order.Remove (slot);
+  m_freeSlots.push_back (slot);
+}
+
+void
+FtIpv4RoutingTable::Remove (const std::vector<uint32_t> &slots)
+{
+  for (std::vector<uint32_t>::const_iterator i = slots.begin (); i != slots.end (); i++)
+    {
+      Remove (*i);
+    }
+}
+
+void
+FtIpv4RoutingTable::Park (uint32_t slot)
+{
+  NS_ASSERT_MSG (IsLive (slot), "FtIpv4RoutingTable::Park (): no route in slot " << slot);
+  DetachFromInterface (slot, m_interfaceRoutes);
+  AttachToInterface (slot, m_parkedRoutes);
+  m_flags[slot] |= PARKED;
+  m_parkedFlows.insert (std::make_pair (m_flowId[slot], slot));
+  m_parkedSpans.insert (m_flowSpan[slot]);
+  m_order.Hide (slot);
+}
+
+void
+FtIpv4RoutingTable::UnparkInterface (uint32_t interface, std::vector<uint32_t> &slots)
+{
+  slots.clear ();
+  if (interface >= m_parkedRoutes.size ())
+    {
+      return;
+    }
+  slots.swap (m_parkedRoutes[interface]);
+  for (std::vector<uint32_t>::const_iterator i = slots.begin (); i != slots.end (); i++)
+    {
+      uint32_t slot = *i;
+      m_flags[slot] &= ~PARKED;
+      m_parkedFlows.erase (std::make_pair (m_flowId[slot], slot));
+      m_parkedSpans.erase (m_parkedSpans.find (m_flowSpan[slot]));
+      m_order.Show (slot);
+      AttachToInterface (slot, m_interfaceRoutes);
+    }
+}
+
+void
+FtIpv4RoutingTable::Clear (void)
+{
+  m_dest.clear ();
+  m_mask.clear ();
+  m_prefixLength.clear ();
+  m_gateway.clear ();
+  m_interface.clear ();
+  m_flowId.clear ();
+  m_flowSpan.clear ();
+  m_metric.clear ();
+  m_weight.clear ();
+  m_sequence.clear ();
+  m_flags.clear ();
+  m_freeSlots.clear ();
+  m_order.Clear ();
+  m_interfacePosition.clear ();
+  m_interfaceRoutes.clear ();
+  m_parkedRoutes.clear ();
+  m_parkedFlows.clear ();
+  m_parkedSpans.clear ();
+}
+
+void
+FtIpv4RoutingTable::Reserve (uint32_t n)
+{
+  m_dest.reserve (n);
+  m_mask.reserve (n);
+  m_prefixLength.reserve (n);
+  m_gateway.reserve (n);
+  m_interface.reserve (n);
+  m_flowId.reserve (n);
+  m_flowSpan.reserve (n);
+  m_metric.reserve (n);
+  m_weight.reserve (n);
+  m_sequence.reserve (n);
+  m_flags.reserve (n);
+  m_interfacePosition.reserve (n);
+  m_order.Reserve (n);
+}
+
+uint32_t
+FtIpv4RoutingTable::GetN (void) const
+{
+  return m_order.GetN ();
+}
+
+uint32_t
+FtIpv4RoutingTable::GetSlot (uint32_t index) const
+{
+  NS_ASSERT_MSG (index < m_order.GetN (), "FtIpv4RoutingTable::GetSlot (): index out of range");
+  return m_order.GetSlot (index);
+}
+
+bool
+FtIpv4RoutingTable::IsLive (uint32_t slot) const
+{
+  return m_order.IsVisible (slot);
+}
+
+bool
+FtIpv4RoutingTable::IsParked (uint32_t slot) const
+{
+  return slot < m_flags.size () && (m_flags[slot] & PARKED) != 0;
+}
+
+const std::vector<uint32_t> &
+FtIpv4RoutingTable::GetInterfaceSlots (uint32_t interface) const
+{
+  static const std::vector<uint32_t> none;
+  if (interface >= m_interfaceRoutes.size ())
+    {
+      return none;
+    }
+  return m_interfaceRoutes[interface];
+}
+
+void
+FtIpv4RoutingTable::GetParkedFlowSlots (uint32_t flowId, std::vector<uint32_t> &slots) const
+{
+  slots.clear ();
+  if (m_parkedFlows.empty ())
+    {
+      return;
+    }
+  // a parked route covering flowId starts at most maxSpan flow ids before it
+  uint32_t maxSpan = *m_parkedSpans.rbegin ();
+  std::set<std::pair<uint32_t, uint32_t> >::const_iterator i =
+    m_parkedFlows.upper_bound (std::make_pair (flowId, 0xffffffffU));
+  while (i != m_parkedFlows.begin ())
+    {
+      i--;
+      if (flowId - i->first > maxSpan)
+        {
+          break;
+        }
+      if (flowId - i->first <= m_flowSpan[i->second])
+        {
+          slots.push_back (i->second);
+        }
+    }
+}
+
+uint64_t
+FtIpv4RoutingTable::GetMemoryUsage (void) const
+{
+  uint64_t bytes = sizeof (*this);
+  bytes += m_dest.capacity () * sizeof (uint32_t);
+  bytes += m_mask.capacity () * sizeof (uint32_t);
+  bytes += m_prefixLength.capacity () * sizeof (uint8_t);
+  bytes += m_gateway.capacity () * sizeof (uint32_t);
+  bytes += m_interface.capacity () * sizeof (uint32_t);
+  bytes += m_flowId.capacity () * sizeof (uint32_t);
+  bytes += m_flowSpan.capacity () * sizeof (uint32_t);
+  bytes += m_metric.capacity () * sizeof (uint32_t);
+  bytes += m_weight.capacity () * sizeof (uint32_t);
+  bytes += m_sequence.capacity () * sizeof (uint64_t);
+  bytes += m_flags.capacity () * sizeof (uint8_t);
+  bytes += m_freeSlots.capacity () * sizeof (uint32_t);
+  bytes += m_order.GetMemoryUsage ();
+  bytes += m_parkedFlows.size () * (4 * sizeof (void *) + sizeof (std::pair<uint32_t, uint32_t>));
+  bytes += m_parkedSpans.size () * (4 * sizeof (void *) + sizeof (uint32_t));
+  bytes += m_interfacePosition.capacity () * sizeof (uint32_t);
+  const InterfaceSlots *indexes[] = { &m_interfaceRoutes, &m_parkedRoutes };
+  for (uint32_t k = 0; k < 2; k++)
+    {
+      bytes += indexes[k]->capacity () * sizeof (std::vector<uint32_t>);
+      for (InterfaceSlots::const_iterator i = indexes[k]->begin (); i != indexes[k]->end (); i++)
+        {
+          bytes += i->capacity () * sizeof (uint32_t);
+        }
+    }
+  return bytes;
+}
+
+FtIpv4RoutingTableEntry
+FtIpv4RoutingTable::GetEntry (uint32_t slot) const
+{
+  return FtIpv4RoutingTableEntry::CreateFlowRangeRouteTo (m_flowId[slot],
+                                                          m_flowId[slot] + m_flowSpan[slot],
+                                                          Ipv4Address (m_dest[slot]),
+                                                          Ipv4Mask (m_mask[slot]),
+                                                          Ipv4Address (m_gateway[slot]),
+                                                          m_interface[slot]);
+}
+
+} // namespace ns3
@@ -0,0 +1,306 @@
+/*
+ * Storage for the unicast routes of FtIpv4StaticRouting:
+ * - routes are kept in parallel arrays (one array per field) instead of a list
+ *   of heap allocated FtIpv4RoutingTableEntry objects
+ * - every route is identified by a slot that stays valid until the route is removed
+ * - the insertion order view is an FtIpv4RouteOrder: access by index is logarithmic,
+ *   a dump by index is linear and removal does not shift the other routes
+ * - routes are indexed by output interface and can be parked while their
+ *   interface is down
+ * - routes carry a multipath weight (0 for ordinary routes)
+ * - routes can cover a range of flow ids (flow span, 0 for a single flow id)
+ * - parked routes are indexed by flow id, so they can be found and removed
+ * - backup routes are hidden in the order, like parked routes, but stay indexed
+ *   by output interface
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef FT_IPV4_ROUTING_TABLE_H
+#define FT_IPV4_ROUTING_TABLE_H
+
+#include <vector>
+#include <set>
+#include <utility>
+#include <stdint.h>
+#include "ns3/ipv4-address.h"
+#include "ft-ipv4-routing-table-entry.h"
+#include "ft-ipv4-route-order.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup ipv4Routing
+ *
+ * \brief Unicast route storage of FtIpv4StaticRouting.
+ *
+ * Destination, mask, prefix length, gateway, interface, flow id, flow span,
+ * metric, multipath weight and insertion sequence of the routes are stored in parallel arrays indexed by
+ * slot.  Removed slots are reused by later insertions.  Independently of
+ * the slots, the table keeps the live routes in insertion order; this is
+ * the order exposed by FtIpv4StaticRouting::GetRoute.
+ *
+ * The order is kept by an FtIpv4RouteOrder: GetSlot is O(log n), and O(1)
+ * when the indexes are walked in increasing order, so a dump of the whole
+ * table by index is linear whatever the removals before it.
+ *
+ * The live routes of every output interface are also listed in a per
+ * interface index, so the routes of one interface are found without a scan
+ * of the table.  A route can be parked: it is hidden in the order and
+ * leaves the interface index but keeps its slot and its position, and is
+ * back at its place in the order when its interface is unparked.  Parked
+ * routes are indexed by flow id (GetParkedFlowSlots), so a flow can be
+ * rerouted or removed while its interface is down.
+ *
+ * Backup routes (BACKUP flag) are hidden in the order from the start: they
+ * are not counted by GetN nor reached by GetSlot, so they never show up as
+ * routes of their own, but they are in the index of their interface.
+ *
+ * This is not a reference counted object.
+ */
+class FtIpv4RoutingTable
+{
+public:
+  /// Route flags
+  enum Flags
+  {
+    CONNECTED = 0x01,               //!< route to the network of an interface address
+    BACKUP = 0x02,                  //!< backup next hop of another route, hidden in the order
+    PARKED = 0x80                   //!< route is parked (set by Park only)
+  };
+
+  FtIpv4RoutingTable ();
+
+  /**
+   * \brief Add a route at the end of the table.
+   * \param flowId flow id of the route
+   * \param network destination network
+   * \param networkMask destination network mask
+   * \param gateway next hop, zero for direct routes
+   * \param interface output interface index
+   * \param metric metric of the route
+   * \param flags route flags (see Flags)
+   * \param weight multipath weight, 0 for an ordinary route
+   * \param flowSpan the route covers flow ids flowId to flowId + flowSpan
+   * \return slot of the new route
+   */
+  uint32_t Add (uint32_t flowId, Ipv4Address network, Ipv4Mask networkMask,
+                Ipv4Address gateway, uint32_t interface, uint32_t metric,
+                uint8_t flags = 0, uint32_t weight = 0, uint32_t flowSpan = 0);
+
+  /**
+   * \brief Remove a route, live or parked.
+   * \param slot slot of the route
+   */
+  void Remove (uint32_t slot);
+
+  /**
+   * \brief Remove several routes.
+   * \param slots slots of the routes
+   */
+  void Remove (const std::vector<uint32_t> &slots);
+
+  /**
+   * \brief Take a route out of the table until its interface is unparked.
+   * \param slot slot of the route
+   */
+  void Park (uint32_t slot);
+
+  /**
+   * \brief Put back every parked route of an interface.
+   * \param interface output interface index
+   * \param slots set to the slots of the routes put back
+   */
+  void UnparkInterface (uint32_t interface, std::vector<uint32_t> &slots);
+
+  /**
+   * \brief Remove all routes.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Reserve storage for n routes in total.
+   * \param n number of routes
+   */
+  void Reserve (uint32_t n);
+
+  /**
+   * \return number of routes in the table, parked routes and backups excluded
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param index position of the route in insertion order
+   * \return slot of the route
+   */
+  uint32_t GetSlot (uint32_t index) const;
+
+  /**
+   * \param slot a slot
+   * \return true if the slot holds a route that is neither parked nor a backup
+   */
+  bool IsLive (uint32_t slot) const;
+
+  /**
+   * \param slot a slot
+   * \return true if the slot holds a parked route
+   */
+  bool IsParked (uint32_t slot) const;
+
+  /**
+   * \param interface output interface index
+   * \return slots of the live routes on the interface, in no particular order
+   */
+  const std::vector<uint32_t> &GetInterfaceSlots (uint32_t interface) const;
+
+  /**
+   * \brief Find the parked routes of a flow id.
+   * \param flowId a flow id
+   * \param slots set to the slots of the parked routes covering the flow id
+   */
+  void GetParkedFlowSlots (uint32_t flowId, std::vector<uint32_t> &slots) const;
+
+  /**
+   * \return bytes allocated by the table
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+  /**
+   * \param slot slot of the route
+   * \return the route as a routing table entry, with its last flow id for a
+   * range route
+   */
+  FtIpv4RoutingTableEntry GetEntry (uint32_t slot) const;
+
+  /// \param slot slot of the route \return destination network
+  Ipv4Address GetDest (uint32_t slot) const;
+  /// \param slot slot of the route \return destination network mask
+  Ipv4Mask GetMask (uint32_t slot) const;
+  /// \param slot slot of the route \return prefix length of the mask
+  uint16_t GetPrefixLength (uint32_t slot) const;
+  /// \param slot slot of the route \return gateway, zero for direct routes
+  Ipv4Address GetGateway (uint32_t slot) const;
+  /// \param slot slot of the route \return output interface index
+  uint32_t GetInterface (uint32_t slot) const;
+  /// \param slot slot of the route \return flow id
+  uint32_t GetFlowId (uint32_t slot) const;
+  /// \param slot slot of the route \return number of flow ids covered after the flow id
+  uint32_t GetFlowSpan (uint32_t slot) const;
+  /// \param slot slot of the route \return metric
+  uint32_t GetMetric (uint32_t slot) const;
+  /// \param slot slot of the route \return multipath weight, 0 for an ordinary route
+  uint32_t GetWeight (uint32_t slot) const;
+  /// \param slot slot of the route \return insertion sequence number
+  uint64_t GetSequence (uint32_t slot) const;
+  /// \param slot slot of the route \return route flags (see Flags)
+  uint8_t GetFlags (uint32_t slot) const;
+
+private:
+  /// Slots by interface index
+  typedef std::vector<std::vector<uint32_t> > InterfaceSlots;
+
+  /**
+   * \brief Append a slot to the list of its interface.
+   * \param slot slot of the route
+   * \param index m_interfaceRoutes or m_parkedRoutes
+   */
+  void AttachToInterface (uint32_t slot, InterfaceSlots &index);
+
+  /**
+   * \brief Remove a slot from the list of its interface.
+   * \param slot slot of the route
+   * \param index m_interfaceRoutes or m_parkedRoutes
+   */
+  void DetachFromInterface (uint32_t slot, InterfaceSlots &index);
+
+  std::vector<uint32_t> m_dest;          //!< destination network
+  std::vector<uint32_t> m_mask;          //!< destination network mask
+  std::vector<uint8_t>  m_prefixLength;  //!< prefix length of m_mask
+  std::vector<uint32_t> m_gateway;       //!< next hop
+  std::vector<uint32_t> m_interface;     //!< output interface
+  std::vector<uint32_t> m_flowId;        //!< flow id
+  std::vector<uint32_t> m_flowSpan;      //!< flow ids covered after m_flowId
+  std::vector<uint32_t> m_metric;        //!< metric
+  std::vector<uint32_t> m_weight;        //!< multipath weight
+  std::vector<uint64_t> m_sequence;      //!< insertion sequence number
+  std::vector<uint8_t>  m_flags;         //!< route flags
+  std::vector<uint32_t> m_freeSlots;     //!< slots available for reuse
+
+  FtIpv4RouteOrder m_order;                 //!< live, parked and backup (hidden) slots in insertion order
+  std::vector<uint32_t> m_interfacePosition; //!< position of every slot in its interface list
+  InterfaceSlots m_interfaceRoutes;         //!< live routes by interface
+  InterfaceSlots m_parkedRoutes;            //!< parked routes by interface
+  std::set<std::pair<uint32_t, uint32_t> > m_parkedFlows; //!< (flow id, slot) of the parked routes
+  std::multiset<uint32_t> m_parkedSpans;    //!< flow span of every parked route
+  uint64_t m_nextSequence;                  //!< sequence number of the next route
+};
+
+inline Ipv4Address
+FtIpv4RoutingTable::GetDest (uint32_t slot) const
+{
+  return Ipv4Address (m_dest[slot]);
+}
+
+inline Ipv4Mask
+FtIpv4RoutingTable::GetMask (uint32_t slot) const
+{
+  return Ipv4Mask (m_mask[slot]);
+}
+
+inline uint16_t
+FtIpv4RoutingTable::GetPrefixLength (uint32_t slot) const
+{
+  return m_prefixLength[slot];
+}
+
+inline Ipv4Address
+FtIpv4RoutingTable::GetGateway (uint32_t slot) const
+{
+  return Ipv4Address (m_gateway[slot]);
+}
+
+inline uint32_t
+FtIpv4RoutingTable::GetInterface (uint32_t slot) const
+{
+  return m_interface[slot];
+}
+
+inline uint32_t
+FtIpv4RoutingTable::GetFlowId (uint32_t slot) const
+{
+  return m_flowId[slot];
+}
+
+inline uint32_t
+FtIpv4RoutingTable::GetFlowSpan (uint32_t slot) const
+{
+  return m_flowSpan[slot];
+}
+
+inline uint32_t
+FtIpv4RoutingTable::GetMetric (uint32_t slot) const
+{
+  return m_metric[slot];
+}
+
+inline uint32_t
+FtIpv4RoutingTable::GetWeight (uint32_t slot) const
+{
+  return m_weight[slot];
+}
+
+inline uint64_t
+FtIpv4RoutingTable::GetSequence (uint32_t slot) const
+{
+  return m_sequence[slot];
+}
+
+inline uint8_t
+FtIpv4RoutingTable::GetFlags (uint32_t slot) const
+{
+  return m_flags[slot];
+}
+
+} // namespace ns3
+
+#endif /* FT_IPV4_ROUTING_TABLE_H */
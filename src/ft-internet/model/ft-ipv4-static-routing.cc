@@ -2,7 +2,29 @@
  * This class is based on ns3::Ipv4StaticRouting with slight modifications:
  * - adding routes (in AddNetworkRouteTo) as FtIpv4RoutingTableEntry (with flowId)
  * - LookupStatic method uses flowId to route packet (in RouteInput and RouteOutput)
- * - multicast part is not modified
+ * - routes are indexed by flowId, so a flow lookup only examines the routes of that flow
+ * - routes are stored in FtIpv4RoutingTable (parallel arrays) instead of a list of entries
+ * - flow lookup results are cached per (flowId, destination, output device)
+ * - routes without flowId (flowId 0) are matched with a prefix trie (FtIpv4PrefixTrie)
+ * - Freeze compiles the flow routes into a perfect-hashed FtIpv4FlowFib used by lookups
+ * - unicast routes are accessed by index in logarithmic time, and a dump by index is
+ *   linear (GetRoute, GetMetric, RemoveRoute)
+ * - interface down parks the static routes of the interface, interface up restores them
+ * - lookup statistics (calls, hits, misses, entries examined), Lookup trace source and memory usage
+ * - flowId can be taken from the transport destination port instead of the FtTag (FlowIdSource)
+ * - weighted multipath groups split a flow over several next hops (MultipathMode)
+ * - flowlet mode moves a flow to the least loaded route of its group after an idle gap
+ * - static unicast routes can be written to and read back from a binary stream
+ * - source routed packets (FtSourceRouteTag) are forwarded without a lookup (SourceRouting)
+ * - label switched packets (FtLabelTag) index a per node label table and swap the label
+ * - routes can cover a flowId range; AggregateFlowRoutes merges adjacent flows into ranges;
+ *   GetRoute and PrintRoutingTable give the whole range
+ * - per-packet and per-route logging can be compiled out (ft-hot-path-log.h)
+ * - RemoveFlowRoute and route changes after Freeze update the flow without recompiling the FIB
+ * - backup next hops (AddBackupRouteTo) take over in place when the interface of a route is down
+ * - multicast routes are indexed by group, with their Ipv4MulticastRoute built once
+ * - multicast routes are kept in slots with an FtIpv4RouteOrder, so removal and access
+ *   by index are logarithmic
  */
 
 // -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*-
@@ -31,6 +53,7 @@
                 << " [node " << m_ipv4->GetObject<Node> ()->GetId () << "] "; }
 
 #include <iomanip>
+#include <algorithm>
 #include "ns3/log.h"
 #include "ns3/names.h"
 #include "ns3/packet.h"
@@ -38,9 +61,18 @@
 #include "ns3/simulator.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/pointer.h"
+#include "ns3/boolean.h"
+#include "ns3/channel.h"
+#include "ns3/trace-source-accessor.h"
 #include "ft-ipv4-routing-table-entry.h"
 #include "ft-ipv4-static-routing.h"
+#include "ft-hot-path-log.h"
 #include "ns3/ft-tag.h"
+#include "ns3/ft-source-route-tag.h"
+#include "ns3/ft-label-tag.h"
 
 using std::make_pair;
 
@@ -57,14 +89,888 @@ FtIpv4StaticRouting::GetTypeId (void)
     .SetParent<Ipv4RoutingProtocol> ()
     .SetGroupName ("Internet")
     .AddConstructor<FtIpv4StaticRouting> ()
+    .AddAttribute ("RouteCacheSize",
+                   "Maximum number of flow lookup results kept in the route cache "
+                   "(0 disables the cache). The cache is flushed when it is full.",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&FtIpv4StaticRouting::m_routeCacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FlowIdSource",
+                   "Where forwarded packets get their flowId from: the FtTag byte "
+                   "tag, or the UDP/TCP destination port, which avoids searching "
+                   "the byte tags at every hop; only for flowIds below 65536, "
+                   "which the port is set to. Locally sent packets always use "
+                   "the FtTag, as their transport header is not yet added.",
+                   EnumValue (FLOW_ID_TAG),
+                   MakeEnumAccessor (&FtIpv4StaticRouting::m_flowIdSource),
+                   MakeEnumChecker (FLOW_ID_TAG, "Tag",
+                                    FLOW_ID_DESTINATION_PORT, "DestinationPort"))
+    .AddAttribute ("MultipathMode",
+                   "How packets are spread over the weighted routes of a multipath "
+                   "group: per transport flow (hash of addresses, protocol and ports, "
+                   "keeps packet order) or per packet (smooth weighted round robin, "
+                   "splits even a single socket over all routes) or per flowlet "
+                   "(a flow idle for FlowletTimeout moves to the route with the "
+                   "least queued bytes).",
+                   EnumValue (MULTIPATH_HASH),
+                   MakeEnumAccessor (&FtIpv4StaticRouting::m_multipathMode),
+                   MakeEnumChecker (MULTIPATH_HASH, "Hash",
+                                    MULTIPATH_PER_PACKET, "PerPacket",
+                                    MULTIPATH_FLOWLET, "Flowlet"))
+    .AddAttribute ("FlowletTimeout",
+                   "Gap between two packets of a flow after which the flow may "
+                   "move to another route of its multipath group (Flowlet mode).",
+                   TimeValue (MicroSeconds (500)),
+                   MakeTimeAccessor (&FtIpv4StaticRouting::m_flowletTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("FlowletTableSize",
+                   "Number of entries of the flowlet table, rounded up to a power "
+                   "of two. Flows colliding on an entry share its state.",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&FtIpv4StaticRouting::m_flowletTableSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("SourceRouting",
+                   "Forward packets carrying an FtSourceRouteTag through the output "
+                   "interface the tag gives for this node, without a table lookup. "
+                   "Packets without the tag, or whose route does not cross this "
+                   "node, are looked up as usual.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FtIpv4StaticRouting::m_sourceRouting),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LabelSwitching",
+                   "Forward packets carrying an FtLabelTag by the label table "
+                   "(AddLabelRoute) and swap their label. Packets without the tag, "
+                   "or with a label unknown to this node, are looked up as usual.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FtIpv4StaticRouting::m_labelSwitching),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("Lookup",
+                     "A unicast route lookup, with the number of table "
+                     "entries it examined and whether a route was found.",
+                     MakeTraceSourceAccessor (&FtIpv4StaticRouting::m_lookupTrace),
+                     "ns3::FtIpv4StaticRouting::LookupTracedCallback")
   ;
   return tid;
 }
 
 FtIpv4StaticRouting::FtIpv4StaticRouting ()
-  : m_ipv4 (0)
+  : m_frozen (false),
+    m_fibDirty (false),
+    m_nInterfacesDown (0),
+    m_routeGeneration (0),
+    m_multipathMode (MULTIPATH_HASH),
+    m_flowletTimeout (MicroSeconds (500)),
+    m_flowletTableSize (4096),
+    m_hashSalt (0),
+    m_routeCacheSize (65536),
+    m_flowIdSource (FLOW_ID_TAG),
+    m_sourceRouting (false),
+    m_interfaceRoutesGeneration (0),
+    m_labelSwitching (false),
+    m_ipv4 (0)
 {
   NS_LOG_FUNCTION (this);
+  ResetStatistics ();
+}
+
+void
+FtIpv4StaticRouting::RecordLookup (uint32_t flowId, Ipv4Address dest, uint32_t examined, bool found)
+{
+  if (found)
+    {
+      m_statistics.hits++;
+    }
+  else
+    {
+      m_statistics.misses++;
+    }
+  uint32_t bucket = 0;
+  for (uint32_t e = examined; e != 0; e >>= 1)
+    {
+      bucket++;
+    }
+  m_statistics.examined[bucket]++;
+  m_lookupTrace (flowId, dest, examined, found);
+}
+
+bool
+FtIpv4StaticRouting::IsPreferred (const FlowRouteCandidate &a, const FlowRouteCandidate &b)
+{
+  if (a.prefixLength != b.prefixLength)
+    {
+      return a.prefixLength > b.prefixLength;
+    }
+  if (a.prefixLength == 32)
+    {
+      return a.sequence < b.sequence;
+    }
+  if (a.metric != b.metric)
+    {
+      return a.metric < b.metric;
+    }
+  return a.sequence > b.sequence;
+}
+
+void
+FtIpv4StaticRouting::InvalidateRouteCache (void)
+{
+  // O(1): cached results carry the generation they were built in, and an
+  // entry of an older generation is a miss
+  m_routeGeneration++;
+}
+
+uint32_t
+FtIpv4StaticRouting::InsertRoute (uint32_t flowId, Ipv4Address network, Ipv4Mask networkMask,
+                                  Ipv4Address gateway, uint32_t interface, uint32_t metric,
+                                  uint8_t flags, uint32_t weight, uint32_t flowSpan)
+{
+  uint32_t slot = m_networkRoutes.Add (flowId, network, networkMask, gateway, interface, metric,
+                                       flags, weight, flowSpan);
+  IndexRoute (slot);
+  return slot;
+}
+
+void
+FtIpv4StaticRouting::IndexRoute (uint32_t slot)
+{
+  InvalidateRouteCache ();
+  if (m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP)
+    {
+      return;
+    }
+  if (m_networkRoutes.GetWeight (slot) > 0)
+    {
+      JoinMultipathGroup (slot);
+    }
+  uint32_t flowId = m_networkRoutes.GetFlowId (slot);
+  if (m_networkRoutes.GetFlowSpan (slot) > 0)
+    {
+      FlowRange range;
+      range.first = flowId;
+      range.last = flowId + m_networkRoutes.GetFlowSpan (slot);
+      range.route = GetCandidate (slot);
+      m_flowRanges.insert (std::make_pair (std::make_pair (flowId, slot), range));
+      m_flowRangeSpans.insert (range.last - range.first);
+      return;
+    }
+  if (flowId == 0)
+    {
+      FtIpv4PrefixTrie::Route route;
+      route.slot = slot;
+      route.interface = m_networkRoutes.GetInterface (slot);
+      route.metric = m_networkRoutes.GetMetric (slot);
+      route.sequence = m_networkRoutes.GetSequence (slot);
+      m_prefixRoutes.Insert (m_networkRoutes.GetDest (slot), m_networkRoutes.GetMask (slot), route);
+      return;
+    }
+
+  MarkFlowChanged (flowId);
+  FlowRouteCandidate candidate = GetCandidate (slot);
+
+  FlowRouteCandidates &candidates = m_flowRoutes[flowId];
+  candidates.insert (std::upper_bound (candidates.begin (), candidates.end (), candidate, &IsPreferred),
+                     candidate);
+}
+
+void
+FtIpv4StaticRouting::IndexRoutes (const std::vector<uint32_t> &slots)
+{
+  InvalidateRouteCache ();
+  std::vector<uint32_t> flows;
+  for (std::vector<uint32_t>::const_iterator i = slots.begin (); i != slots.end (); i++)
+    {
+      uint32_t slot = *i;
+      uint32_t flowId = m_networkRoutes.GetFlowId (slot);
+      if (flowId == 0 || m_networkRoutes.GetFlowSpan (slot) > 0
+          || (m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP))
+        {
+          IndexRoute (slot);
+          continue;
+        }
+      if (m_networkRoutes.GetWeight (slot) > 0)
+        {
+          JoinMultipathGroup (slot);
+        }
+      m_flowRoutes[flowId].push_back (GetCandidate (slot));
+      flows.push_back (flowId);
+    }
+  std::sort (flows.begin (), flows.end ());
+  flows.erase (std::unique (flows.begin (), flows.end ()), flows.end ());
+  for (std::vector<uint32_t>::const_iterator flow = flows.begin (); flow != flows.end (); flow++)
+    {
+      FlowRouteCandidates &candidates = m_flowRoutes[*flow];
+      std::sort (candidates.begin (), candidates.end (), &IsPreferred);
+      MarkFlowChanged (*flow);
+    }
+}
+
+void
+FtIpv4StaticRouting::UnindexRoute (uint32_t slot)
+{
+  InvalidateRouteCache ();
+  if (m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP)
+    {
+      return;
+    }
+  if (m_networkRoutes.GetWeight (slot) > 0)
+    {
+      LeaveMultipathGroup (slot);
+    }
+  uint32_t flowId = m_networkRoutes.GetFlowId (slot);
+  if (m_networkRoutes.GetFlowSpan (slot) > 0)
+    {
+      if (m_flowRanges.erase (std::make_pair (flowId, slot)) == 0)
+        {
+          NS_LOG_WARN ("Route in slot " << slot << " is missing from the range index");
+          return;
+        }
+      m_flowRangeSpans.erase (m_flowRangeSpans.find (m_networkRoutes.GetFlowSpan (slot)));
+      return;
+    }
+  if (flowId == 0)
+    {
+      if (!m_prefixRoutes.Remove (m_networkRoutes.GetDest (slot), m_networkRoutes.GetMask (slot), slot))
+        {
+          NS_LOG_WARN ("Route in slot " << slot << " is missing from the prefix index");
+        }
+      return;
+    }
+  MarkFlowChanged (flowId);
+  FlowRouteIndex::iterator flow = m_flowRoutes.find (flowId);
+  NS_ASSERT (flow != m_flowRoutes.end ());
+  FlowRouteCandidates &candidates = flow->second;
+  for (FlowRouteCandidates::iterator c = candidates.begin (); c != candidates.end (); c++)
+    {
+      if (c->slot == slot)
+        {
+          candidates.erase (c);
+          break;
+        }
+    }
+  if (candidates.empty ())
+    {
+      m_flowRoutes.erase (flow);
+    }
+}
+
+FtIpv4StaticRouting::MultipathKey
+FtIpv4StaticRouting::GetMultipathKey (uint32_t slot) const
+{
+  MultipathKey key;
+  key.flowId = m_networkRoutes.GetFlowId (slot);
+  key.network = m_networkRoutes.GetDest (slot).Get ();
+  key.mask = m_networkRoutes.GetMask (slot).Get ();
+  key.metric = m_networkRoutes.GetMetric (slot);
+  return key;
+}
+
+void
+FtIpv4StaticRouting::JoinMultipathGroup (uint32_t slot)
+{
+  std::pair<MultipathGroups::iterator, bool> inserted =
+    m_multipathGroups.insert (std::make_pair (GetMultipathKey (slot), MultipathGroup ()));
+  MultipathGroup &group = inserted.first->second;
+  if (inserted.second)
+    {
+      group.totalWeight = 0;
+      group.generation = m_routeGeneration;
+    }
+  group.slots.push_back (slot);
+  group.current.push_back (0);
+  group.routes.push_back (Ptr<Ipv4Route> ());
+  group.totalWeight += m_networkRoutes.GetWeight (slot);
+}
+
+void
+FtIpv4StaticRouting::LeaveMultipathGroup (uint32_t slot)
+{
+  MultipathGroups::iterator i = m_multipathGroups.find (GetMultipathKey (slot));
+  NS_ASSERT (i != m_multipathGroups.end ());
+  MultipathGroup &group = i->second;
+  for (uint32_t k = 0; k < group.slots.size (); k++)
+    {
+      if (group.slots[k] == slot)
+        {
+          group.slots.erase (group.slots.begin () + k);
+          group.current.erase (group.current.begin () + k);
+          group.routes.erase (group.routes.begin () + k);
+          group.totalWeight -= m_networkRoutes.GetWeight (slot);
+          break;
+        }
+    }
+  if (group.slots.empty ())
+    {
+      m_multipathGroups.erase (i);
+    }
+}
+
+Ptr<Ipv4Route>
+FtIpv4StaticRouting::SelectMultipathRoute (MultipathGroup &group, uint32_t flowHash)
+{
+  uint32_t pick = 0;
+  if (m_multipathMode == MULTIPATH_FLOWLET)
+    {
+      pick = PickFlowlet (group, flowHash);
+    }
+  else if (m_multipathMode == MULTIPATH_PER_PACKET)
+    {
+      // Smooth weighted round robin: every route earns its weight, the
+      // richest is picked and pays the total weight back
+      for (uint32_t k = 0; k < group.slots.size (); k++)
+        {
+          group.current[k] += m_networkRoutes.GetWeight (group.slots[k]);
+          if (group.current[k] > group.current[pick])
+            {
+              pick = k;
+            }
+        }
+      group.current[pick] -= group.totalWeight;
+    }
+  else
+    {
+      pick = PickByHash (group, flowHash);
+    }
+
+  if (group.generation != m_routeGeneration)
+    {
+      std::fill (group.routes.begin (), group.routes.end (), Ptr<Ipv4Route> ());
+      group.generation = m_routeGeneration;
+    }
+  if (group.routes[pick] == 0)
+    {
+      group.routes[pick] = BuildRoute (group.slots[pick]);
+    }
+  return group.routes[pick];
+}
+
+uint32_t
+FtIpv4StaticRouting::PickByHash (const MultipathGroup &group, uint32_t flowHash) const
+{
+  uint32_t pick = 0;
+  uint64_t point = flowHash % group.totalWeight;
+  while (point >= m_networkRoutes.GetWeight (group.slots[pick]))
+    {
+      point -= m_networkRoutes.GetWeight (group.slots[pick]);
+      pick++;
+    }
+  return pick;
+}
+
+uint32_t
+FtIpv4StaticRouting::PickFlowlet (MultipathGroup &group, uint32_t flowHash)
+{
+  if (m_flowlets.empty ())
+    {
+      uint32_t size = 1;
+      while (size < m_flowletTableSize)
+        {
+          size <<= 1;
+        }
+      FlowletEntry unused = { 0, NO_ROUTE, 0 };
+      m_flowlets.assign (size, unused);
+    }
+  FlowletEntry &flowlet = m_flowlets[flowHash & (m_flowlets.size () - 1)];
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  bool known = flowlet.slot != NO_ROUTE && flowlet.key == flowHash;
+  if (known && now - flowlet.lastSeen < m_flowletTimeout.GetTimeStep ())
+    {
+      for (uint32_t k = 0; k < group.slots.size (); k++)
+        {
+          if (group.slots[k] == flowlet.slot)
+            {
+              flowlet.lastSeen = now;
+              return k;
+            }
+        }
+      // the route left the group, e.g. its interface went down
+    }
+
+  // New flowlet: least queued bytes per unit of weight
+  uint32_t pick = PickByHash (group, flowHash);
+  uint64_t pickLoad = GetInterfaceQueueBytes (m_networkRoutes.GetInterface (group.slots[pick]));
+  uint64_t pickWeight = m_networkRoutes.GetWeight (group.slots[pick]);
+  for (uint32_t k = 0; k < group.slots.size () && pickLoad > 0; k++)
+    {
+      uint64_t load = GetInterfaceQueueBytes (m_networkRoutes.GetInterface (group.slots[k]));
+      uint64_t weight = m_networkRoutes.GetWeight (group.slots[k]);
+      if (load * pickWeight < pickLoad * weight)
+        {
+          pick = k;
+          pickLoad = load;
+          pickWeight = weight;
+        }
+    }
+  m_statistics.flowlets++;
+  if (known && flowlet.slot != group.slots[pick])
+    {
+      m_statistics.flowletMoves++;
+    }
+  flowlet.key = flowHash;
+  flowlet.slot = group.slots[pick];
+  flowlet.lastSeen = now;
+  return pick;
+}
+
+uint32_t
+FtIpv4StaticRouting::GetInterfaceQueueBytes (uint32_t interface)
+{
+  if (m_interfaceQueues.size () != m_ipv4->GetNInterfaces ())
+    {
+      m_interfaceQueues.clear ();
+      for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+        {
+          PointerValue queue;
+          if (m_ipv4->GetNetDevice (i)->GetAttributeFailSafe ("TxQueue", queue))
+            {
+              m_interfaceQueues.push_back (queue.Get<QueueBase> ());
+            }
+          else
+            {
+              m_interfaceQueues.push_back (Ptr<QueueBase> ());
+            }
+        }
+    }
+  Ptr<QueueBase> queue = m_interfaceQueues[interface];
+  return queue != 0 ? queue->GetNBytes () : 0;
+}
+
+Ptr<Ipv4Route>
+FtIpv4StaticRouting::GetInterfaceRoute (uint32_t interface)
+{
+  if (m_interfaceRoutesGeneration != m_routeGeneration
+      || m_interfaceRoutes.size () != m_ipv4->GetNInterfaces ())
+    {
+      m_interfaceRoutes.assign (m_ipv4->GetNInterfaces (), Ptr<Ipv4Route> ());
+      m_interfaceRoutesGeneration = m_routeGeneration;
+    }
+  Ptr<Ipv4Route> rtentry = m_interfaceRoutes[interface];
+  if (rtentry != 0)
+    {
+      return rtentry;
+    }
+
+  Ptr<NetDevice> device = m_ipv4->GetNetDevice (interface);
+  Ipv4Address gateway = Ipv4Address::GetZero ();
+  Ptr<Channel> channel = device->GetChannel ();
+  if (channel != 0 && channel->GetNDevices () == 2)
+    {
+      Ptr<NetDevice> peer = channel->GetDevice (channel->GetDevice (0) == device ? 1 : 0);
+      Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+      int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice (peer) : -1;
+      if (peerInterface >= 0 && peerIpv4->GetNAddresses (peerInterface) > 0)
+        {
+          gateway = peerIpv4->GetAddress (peerInterface, 0).GetLocal ();
+        }
+    }
+  rtentry = Create<Ipv4Route> ();
+  rtentry->SetDestination (gateway);
+  rtentry->SetSource (m_ipv4->SourceAddressSelection (interface, gateway));
+  rtentry->SetGateway (gateway);
+  rtentry->SetOutputDevice (device);
+  m_interfaceRoutes[interface] = rtentry;
+  return rtentry;
+}
+
+Ptr<Ipv4Route>
+FtIpv4StaticRouting::LookupSourceRoute (Ptr<const Packet> p, FtSourceRouteTag &tag)
+{
+  uint32_t interface;
+  if (!p->PeekPacketTag (tag)
+      || !tag.GetOutputInterface (m_ipv4->GetObject<Node> ()->GetId (), interface))
+    {
+      return 0;
+    }
+  if (interface >= m_ipv4->GetNInterfaces () || !m_ipv4->IsUp (interface))
+    {
+      FT_HOT_LOG_LOGIC ("Source route interface " << interface << " is not up");
+      return 0;
+    }
+  FT_HOT_LOG_LOGIC ("Source route hop " << tag.GetHopIndex () << " through interface " << interface);
+  tag.Advance ();
+  m_statistics.sourceRouted++;
+  return GetInterfaceRoute (interface);
+}
+
+Ptr<Ipv4Route>
+FtIpv4StaticRouting::LookupLabel (Ptr<const Packet> p, FtLabelTag &tag)
+{
+  if (!p->PeekPacketTag (tag) || tag.GetLabel () >= m_labelRoutes.size ())
+    {
+      return 0;
+    }
+  LabelRoute &entry = m_labelRoutes[tag.GetLabel ()];
+  if (entry.interface == NO_ROUTE || !m_ipv4->IsUp (entry.interface))
+    {
+      FT_HOT_LOG_LOGIC ("No label route for label " << tag.GetLabel ());
+      return 0;
+    }
+  if (entry.route == 0 || entry.generation != m_routeGeneration)
+    {
+      entry.route = Create<Ipv4Route> ();
+      entry.route->SetDestination (entry.gateway);
+      entry.route->SetSource (m_ipv4->SourceAddressSelection (entry.interface, entry.gateway));
+      entry.route->SetGateway (entry.gateway);
+      entry.route->SetOutputDevice (m_ipv4->GetNetDevice (entry.interface));
+      entry.generation = m_routeGeneration;
+    }
+  FT_HOT_LOG_LOGIC ("Label " << tag.GetLabel () << " swapped to " << entry.outLabel);
+  tag.SetLabel (entry.outLabel);
+  m_statistics.labelSwitched++;
+  return entry.route;
+}
+
+/// One step of the flow hash
+static inline uint32_t
+MixFlowHash (uint32_t h, uint32_t value)
+{
+  h ^= value;
+  h *= 0x9e3779b1;
+  return h ^ (h >> 15);
+}
+
+uint32_t
+FtIpv4StaticRouting::GetFlowHash (Ptr<const Packet> p, const Ipv4Header &header, uint32_t flowId,
+                                  bool withPorts) const
+{
+  uint32_t h = MixFlowHash (m_hashSalt, header.GetSource ().Get ());
+  h = MixFlowHash (h, header.GetDestination ().Get ());
+  h = MixFlowHash (h, (static_cast<uint32_t> (header.GetProtocol ()) << 24) ^ flowId);
+  uint8_t ports[4];
+  if (withPorts
+      && (header.GetProtocol () == 17 || header.GetProtocol () == 6)
+      && header.GetFragmentOffset () == 0
+      && p->CopyData (ports, 4) == 4)
+    {
+      h = MixFlowHash (h, (static_cast<uint32_t> (ports[0]) << 24) | (ports[1] << 16) | (ports[2] << 8) | ports[3]);
+    }
+  return h;
+}
+
+Ptr<Ipv4Route>
+FtIpv4StaticRouting::BuildRoute (uint32_t slot) const
+{
+  uint32_t interfaceIdx = m_networkRoutes.GetInterface (slot);
+  Ipv4Address network = m_networkRoutes.GetDest (slot);
+  Ptr<Ipv4Route> rtentry = Create<Ipv4Route> ();
+  rtentry->SetDestination (network);
+  rtentry->SetSource (m_ipv4->SourceAddressSelection (interfaceIdx, network));
+  rtentry->SetGateway (m_networkRoutes.GetGateway (slot));
+  rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
+  return rtentry;
+}
+
+void
+FtIpv4StaticRouting::CompileFib (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> flowIds;
+  uint32_t nEntries = 0;
+  flowIds.reserve (m_flowRoutes.size ());
+  for (FlowRouteIndex::const_iterator i = m_flowRoutes.begin (); i != m_flowRoutes.end (); i++)
+    {
+      flowIds.push_back (i->first);
+      nEntries += i->second.size ();
+    }
+  std::sort (flowIds.begin (), flowIds.end ());
+
+  m_fib.Clear ();
+  m_fib.Reserve (flowIds.size (), nEntries);
+  for (std::vector<uint32_t>::const_iterator f = flowIds.begin (); f != flowIds.end (); f++)
+    {
+      m_fib.AddFlow (*f);
+      const FlowRouteCandidates &candidates = m_flowRoutes[*f];
+      for (FlowRouteCandidates::const_iterator c = candidates.begin (); c != candidates.end (); c++)
+        {
+          FtIpv4FlowFib::Entry entry;
+          entry.network = c->network.Get ();
+          entry.mask = c->mask.Get ();
+          entry.interface = m_networkRoutes.GetInterface (c->slot);
+          entry.slot = c->slot;
+          m_fib.AddEntry (entry);
+        }
+    }
+  m_fib.Build ();
+  m_fibDirty = false;
+  m_fibStaleFlows.clear ();
+  NS_LOG_LOGIC ("Compiled " << m_fib.GetNFlows () << " flows, " << m_fib.GetNEntries ()
+                << " entries out of " << nEntries << " routes");
+}
+
+void
+FtIpv4StaticRouting::MarkFlowChanged (uint32_t flowId)
+{
+  if (!m_frozen || m_fibDirty)
+    {
+      m_fibDirty = true;
+      return;
+    }
+  // A few changed flows are looked up through m_flowRoutes until the next
+  // compilation; past a fraction of the table, recompiling is cheaper
+  m_fibStaleFlows.insert (flowId);
+  if (m_fibStaleFlows.size () > m_fib.GetNFlows () / 8 + 64)
+    {
+      m_fibDirty = true;
+    }
+}
+
+void
+FtIpv4StaticRouting::Freeze (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_frozen = true;
+  CompileFib ();
+}
+
+bool
+FtIpv4StaticRouting::IsFrozen (void) const
+{
+  return m_frozen;
+}
+
+const FtIpv4StaticRouting::Statistics &
+FtIpv4StaticRouting::GetStatistics (void) const
+{
+  return m_statistics;
+}
+
+void
+FtIpv4StaticRouting::ResetStatistics (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_statistics.routeInput = 0;
+  m_statistics.routeOutput = 0;
+  m_statistics.hits = 0;
+  m_statistics.misses = 0;
+  m_statistics.cacheHits = 0;
+  m_statistics.flowlets = 0;
+  m_statistics.flowletMoves = 0;
+  m_statistics.sourceRouted = 0;
+  m_statistics.labelSwitched = 0;
+  m_statistics.fastReroutes = 0;
+  m_statistics.examined.assign (EXAMINED_BUCKETS, 0);
+}
+
+uint64_t
+FtIpv4StaticRouting::GetUnicastMemoryUsage (void) const
+{
+  uint64_t bytes = m_networkRoutes.GetMemoryUsage ();
+  bytes += m_prefixRoutes.GetMemoryUsage ();
+  bytes += m_fib.GetMemoryUsage ();
+  bytes += m_fibStaleFlows.bucket_count () * sizeof (void *);
+  bytes += m_backupRoutes.bucket_count () * sizeof (void *);
+  bytes += m_backupRoutes.size () * (2 * sizeof (void *) + sizeof (BackupRoutes::value_type));
+  bytes += m_protectedRoutes.bucket_count () * sizeof (void *);
+  bytes += m_protectedRoutes.size () * (2 * sizeof (void *) + sizeof (BackupRoutes::value_type));
+  bytes += m_interfaceDown.capacity () * sizeof (uint8_t);
+  bytes += m_fibStaleFlows.size () * (2 * sizeof (void *) + sizeof (uint32_t));
+  // Hash tables: one pointer per bucket, one node (next pointer, cached
+  // hash, value) per element
+  bytes += m_flowRoutes.bucket_count () * sizeof (void *);
+  for (FlowRouteIndex::const_iterator i = m_flowRoutes.begin (); i != m_flowRoutes.end (); i++)
+    {
+      bytes += 2 * sizeof (void *) + sizeof (FlowRouteIndex::value_type);
+      bytes += i->second.capacity () * sizeof (FlowRouteCandidate);
+    }
+  bytes += m_routeCache.bucket_count () * sizeof (void *);
+  bytes += m_routeCache.size () * (2 * sizeof (void *) + sizeof (RouteCache::value_type) + sizeof (Ipv4Route));
+  bytes += m_multipathGroups.bucket_count () * sizeof (void *);
+  for (MultipathGroups::const_iterator i = m_multipathGroups.begin (); i != m_multipathGroups.end (); i++)
+    {
+      bytes += 2 * sizeof (void *) + sizeof (MultipathGroups::value_type);
+      bytes += i->second.slots.capacity () * sizeof (uint32_t);
+      bytes += i->second.current.capacity () * sizeof (int64_t);
+      bytes += i->second.routes.capacity () * (sizeof (Ptr<Ipv4Route>) + sizeof (Ipv4Route));
+    }
+  bytes += m_flowRanges.size () * (4 * sizeof (void *) + sizeof (FlowRanges::value_type));
+  bytes += m_flowRangeSpans.size () * (4 * sizeof (void *) + sizeof (uint32_t));
+  bytes += m_flowlets.capacity () * sizeof (FlowletEntry);
+  bytes += m_interfaceQueues.capacity () * sizeof (Ptr<QueueBase>);
+  bytes += m_interfaceRoutes.capacity () * (sizeof (Ptr<Ipv4Route>) + sizeof (Ipv4Route));
+  bytes += m_labelRoutes.capacity () * (sizeof (LabelRoute) + sizeof (Ipv4Route));
+  bytes += m_freeLabels.capacity () * sizeof (uint32_t);
+  return bytes;
+}
+
+uint64_t
+FtIpv4StaticRouting::GetMulticastMemoryUsage (void) const
+{
+  uint64_t bytes = m_multicastRoutes.capacity () * sizeof (FtIpv4MulticastRoutingTableEntry *);
+  bytes += m_freeMulticastSlots.capacity () * sizeof (uint32_t);
+  bytes += m_multicastOrder.GetMemoryUsage ();
+  for (MulticastRoutesCI i = m_multicastRoutes.begin (); i != m_multicastRoutes.end (); i++)
+    {
+      if (*i == 0)
+        {
+          continue;
+        }
+      bytes += sizeof (FtIpv4MulticastRoutingTableEntry);
+      bytes += (*i)->GetNOutputInterfaces () * sizeof (uint32_t);
+      bytes += sizeof (Ipv4MulticastRoute);
+    }
+  bytes += m_multicastGroups.bucket_count () * sizeof (void *);
+  for (MulticastGroups::const_iterator i = m_multicastGroups.begin (); i != m_multicastGroups.end (); i++)
+    {
+      bytes += sizeof (MulticastGroups::value_type);
+      bytes += i->second.capacity () * sizeof (MulticastGroupRoute);
+    }
+  return bytes;
+}
+
+void
+FtIpv4StaticRouting::PrintStatistics (Ptr<OutputStreamWrapper> stream) const
+{
+  NS_LOG_FUNCTION (this << stream);
+  std::ostream* os = stream->GetStream ();
+
+  *os << "Node: " << m_ipv4->GetObject<Node> ()->GetId ()
+      << ", Time: " << Now ().As (Time::S)
+      << ", FtIpv4StaticRouting statistics" << std::endl;
+  *os << "RouteInput " << m_statistics.routeInput
+      << " RouteOutput " << m_statistics.routeOutput
+      << " Hits " << m_statistics.hits
+      << " Misses " << m_statistics.misses
+      << " CacheHits " << m_statistics.cacheHits
+      << " Flowlets " << m_statistics.flowlets
+      << " FlowletMoves " << m_statistics.flowletMoves
+      << " SourceRouted " << m_statistics.sourceRouted
+      << " LabelSwitched " << m_statistics.labelSwitched
+      << " FastReroutes " << m_statistics.fastReroutes << std::endl;
+  *os << "Routes " << GetNRoutes ()
+      << " RangeRoutes " << GetNFlowRangeRoutes ()
+      << " BackupRoutes " << GetNBackupRoutes ()
+      << " LabelRoutes " << GetNLabelRoutes ()
+      << " MulticastRoutes " << GetNMulticastRoutes ()
+      << " UnicastBytes " << GetUnicastMemoryUsage ()
+      << " MulticastBytes " << GetMulticastMemoryUsage () << std::endl;
+  *os << "Examined";
+  for (uint32_t k = 0; k < EXAMINED_BUCKETS; k++)
+    {
+      if (m_statistics.examined[k] == 0)
+        {
+          continue;
+        }
+      if (k == 0)
+        {
+          *os << " 0:";
+        }
+      else
+        {
+          *os << " " << (1ULL << (k - 1)) << "-" << ((1ULL << k) - 1) << ":";
+        }
+      *os << m_statistics.examined[k];
+    }
+  *os << std::endl << std::endl;
+}
+
+/// Write a column of route fields
+static void
+WriteRouteColumn (std::ostream &os, const std::vector<uint32_t> &column)
+{
+  if (!column.empty ())
+    {
+      os.write (reinterpret_cast<const char *> (&column[0]), column.size () * sizeof (uint32_t));
+    }
+}
+
+/// Read a column of n route fields \return false if the stream is truncated
+static bool
+ReadRouteColumn (std::istream &is, std::vector<uint32_t> &column, uint32_t n)
+{
+  column.resize (n);
+  if (n > 0)
+    {
+      is.read (reinterpret_cast<char *> (&column[0]), n * sizeof (uint32_t));
+    }
+  return !is.fail ();
+}
+
+void
+FtIpv4StaticRouting::SerializeRoutes (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> dest, mask, gateway, interface, flowId, flowSpan, metric, weight;
+  for (uint32_t i = 0; i < m_networkRoutes.GetN (); i++)
+    {
+      uint32_t slot = m_networkRoutes.GetSlot (i);
+      if (m_networkRoutes.GetFlags (slot) & (FtIpv4RoutingTable::CONNECTED | FtIpv4RoutingTable::BACKUP))
+        {
+          continue;
+        }
+      dest.push_back (m_networkRoutes.GetDest (slot).Get ());
+      mask.push_back (m_networkRoutes.GetMask (slot).Get ());
+      gateway.push_back (m_networkRoutes.GetGateway (slot).Get ());
+      interface.push_back (m_networkRoutes.GetInterface (slot));
+      flowId.push_back (m_networkRoutes.GetFlowId (slot));
+      flowSpan.push_back (m_networkRoutes.GetFlowSpan (slot));
+      metric.push_back (m_networkRoutes.GetMetric (slot));
+      weight.push_back (m_networkRoutes.GetWeight (slot));
+    }
+  uint32_t header[2] = { static_cast<uint32_t> (dest.size ()), m_frozen ? 1u : 0u };
+  os.write (reinterpret_cast<const char *> (header), sizeof (header));
+  WriteRouteColumn (os, dest);
+  WriteRouteColumn (os, mask);
+  WriteRouteColumn (os, gateway);
+  WriteRouteColumn (os, interface);
+  WriteRouteColumn (os, flowId);
+  WriteRouteColumn (os, flowSpan);
+  WriteRouteColumn (os, metric);
+  WriteRouteColumn (os, weight);
+}
+
+bool
+FtIpv4StaticRouting::DeserializeRoutes (std::istream &is)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t header[2];
+  is.read (reinterpret_cast<char *> (header), sizeof (header));
+  if (is.fail ())
+    {
+      return false;
+    }
+  uint32_t n = header[0];
+  std::vector<uint32_t> dest, mask, gateway, interface, flowId, flowSpan, metric, weight;
+  if (!ReadRouteColumn (is, dest, n) || !ReadRouteColumn (is, mask, n)
+      || !ReadRouteColumn (is, gateway, n) || !ReadRouteColumn (is, interface, n)
+      || !ReadRouteColumn (is, flowId, n) || !ReadRouteColumn (is, flowSpan, n)
+      || !ReadRouteColumn (is, metric, n) || !ReadRouteColumn (is, weight, n))
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (interface[i] >= m_ipv4->GetNInterfaces ())
+        {
+          NS_LOG_WARN ("Route " << i << " uses missing interface " << interface[i]);
+          return false;
+        }
+    }
+
+  ReserveRoutes (n);
+  std::vector<uint32_t> slots (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      slots[i] = m_networkRoutes.Add (flowId[i], Ipv4Address (dest[i]), Ipv4Mask (mask[i]),
+                                      Ipv4Address (gateway[i]), interface[i], metric[i], 0,
+                                      weight[i], flowSpan[i]);
+    }
+  IndexRoutes (slots);
+  if (header[1] != 0)
+    {
+      Freeze ();
+    }
+  return true;
+}
+
+void
+FtIpv4StaticRouting::EraseRoute (uint32_t slot)
+{
+  ReleaseBackup (slot);
+  if (!m_networkRoutes.IsParked (slot))
+    {
+      // parked routes left the indexes with their interface
+      UnindexRoute (slot);
+    }
+  m_networkRoutes.Remove (slot);
 }
 
 void 
@@ -74,14 +980,8 @@ FtIpv4StaticRouting::AddNetworkRouteTo (Ipv4Address network,
                                       uint32_t interface,
                                       uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << network << " " << networkMask << " " << nextHop << " " << interface << " " << metric);
-  FtIpv4RoutingTableEntry *route = new FtIpv4RoutingTableEntry ();
-  *route = FtIpv4RoutingTableEntry::CreateNetworkRouteTo (network,
-                                                        networkMask,
-                                                        nextHop,
-                                                        interface);
-  //NS_LOG_FUNCTION (route->GetInterface());
-  m_networkRoutes.push_back (make_pair (route,metric));
+  FT_HOT_LOG_FUNCTION (this << network << " " << networkMask << " " << nextHop << " " << interface << " " << metric);
+  InsertRoute (0, network, networkMask, nextHop, interface, metric);
 }
 
 void 
@@ -90,12 +990,8 @@ FtIpv4StaticRouting::AddNetworkRouteTo (Ipv4Address network,
                                       uint32_t interface,
                                       uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << network << " " << networkMask << " " << interface << " " << metric);
-  FtIpv4RoutingTableEntry *route = new FtIpv4RoutingTableEntry ();
-  *route = FtIpv4RoutingTableEntry::CreateNetworkRouteTo (network,
-                                                        networkMask,
-                                                        interface);
-  m_networkRoutes.push_back (make_pair (route,metric));
+  FT_HOT_LOG_FUNCTION (this << network << " " << networkMask << " " << interface << " " << metric);
+  InsertRoute (0, network, networkMask, Ipv4Address::GetZero (), interface, metric);
 }
 
 void 
@@ -106,15 +1002,316 @@ FtIpv4StaticRouting::AddNetworkRouteTo (uint32_t flowId,
                                       uint32_t interface,
                                       uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << flowId << " " << network << " " << networkMask << " " << nextHop << " " << interface << " " << metric);
-  FtIpv4RoutingTableEntry *route = new FtIpv4RoutingTableEntry ();
-  *route = FtIpv4RoutingTableEntry::CreateNetworkRouteTo (flowId,
-                                                        network,
-                                                        networkMask,
-                                                        nextHop,
-                                                        interface);
-  //NS_LOG_FUNCTION (route->GetInterface());
-  m_networkRoutes.push_back (make_pair (route,metric));
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << network << " " << networkMask << " " << nextHop << " " << interface << " " << metric);
+  InsertRoute (flowId, network, networkMask, nextHop, interface, metric);
+}
+
+void
+FtIpv4StaticRouting::AddFlowRangeRouteTo (uint32_t firstFlowId,
+                                          uint32_t lastFlowId,
+                                          Ipv4Address network,
+                                          Ipv4Mask networkMask,
+                                          Ipv4Address nextHop,
+                                          uint32_t interface,
+                                          uint32_t metric)
+{
+  NS_LOG_FUNCTION (this << firstFlowId << " " << lastFlowId << " " << network << " " << networkMask << " " << nextHop << " " << interface << " " << metric);
+  NS_ASSERT_MSG (firstFlowId > 0 && lastFlowId >= firstFlowId,
+                 "FtIpv4StaticRouting::AddFlowRangeRouteTo (): invalid range " << firstFlowId << "-" << lastFlowId);
+  InsertRoute (firstFlowId, network, networkMask, nextHop, interface, metric, 0, 0, lastFlowId - firstFlowId);
+}
+
+uint32_t
+FtIpv4StaticRouting::AggregateFlowRoutes (void)
+{
+  NS_LOG_FUNCTION (this);
+  // (flowId, slot) of the flows with a single unweighted route.  A flow
+  // covered by another range, or with a route parked on a down interface,
+  // has other routes its own route wins over: merged into a range, it
+  // would compete with them and could change its lookups.
+  std::vector<std::pair<uint32_t, uint32_t> > single;
+  std::vector<uint32_t> parked;
+  for (FlowRouteIndex::const_iterator i = m_flowRoutes.begin (); i != m_flowRoutes.end (); i++)
+    {
+      if (i->second.size () != 1 || m_networkRoutes.GetWeight (i->second[0].slot) != 0
+          || m_backupRoutes.count (i->second[0].slot) != 0 || IsInFlowRange (i->first))
+        {
+          continue;
+        }
+      m_networkRoutes.GetParkedFlowSlots (i->first, parked);
+      if (parked.empty ())
+        {
+          single.push_back (std::make_pair (i->first, i->second[0].slot));
+        }
+    }
+  std::sort (single.begin (), single.end ());
+
+  uint32_t removed = 0;
+  uint32_t first = 0;
+  while (first < single.size ())
+    {
+      uint32_t a = single[first].second;
+      uint32_t end = first + 1;
+      while (end < single.size ()
+             && single[end].first == single[end - 1].first + 1
+             && m_networkRoutes.GetDest (single[end].second) == m_networkRoutes.GetDest (a)
+             && m_networkRoutes.GetMask (single[end].second) == m_networkRoutes.GetMask (a)
+             && m_networkRoutes.GetGateway (single[end].second) == m_networkRoutes.GetGateway (a)
+             && m_networkRoutes.GetInterface (single[end].second) == m_networkRoutes.GetInterface (a)
+             && m_networkRoutes.GetMetric (single[end].second) == m_networkRoutes.GetMetric (a))
+        {
+          end++;
+        }
+      if (end - first > 1)
+        {
+          Ipv4Address dest = m_networkRoutes.GetDest (a);
+          Ipv4Mask mask = m_networkRoutes.GetMask (a);
+          Ipv4Address gateway = m_networkRoutes.GetGateway (a);
+          uint32_t interface = m_networkRoutes.GetInterface (a);
+          uint32_t metric = m_networkRoutes.GetMetric (a);
+          for (uint32_t k = first; k < end; k++)
+            {
+              EraseRoute (single[k].second);
+            }
+          InsertRoute (single[first].first, dest, mask, gateway, interface, metric, 0, 0,
+                       single[end - 1].first - single[first].first);
+          removed += end - first - 1;
+        }
+      first = end;
+    }
+  NS_LOG_LOGIC ("Aggregation removed " << removed << " routes");
+  return removed;
+}
+
+bool
+FtIpv4StaticRouting::IsInFlowRange (uint32_t flowId) const
+{
+  if (m_flowRanges.empty ())
+    {
+      return false;
+    }
+  uint32_t maxSpan = *m_flowRangeSpans.rbegin ();
+  FlowRanges::const_iterator r = m_flowRanges.upper_bound (std::make_pair (flowId, 0xffffffffU));
+  while (r != m_flowRanges.begin ())
+    {
+      r--;
+      if (flowId - r->second.first > maxSpan)
+        {
+          break;
+        }
+      if (r->second.last >= flowId)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+uint32_t
+FtIpv4StaticRouting::GetNFlowRangeRoutes (void) const
+{
+  return m_flowRanges.size ();
+}
+
+bool
+FtIpv4StaticRouting::FindFlowRoute (uint32_t flowId, Ipv4Address dest, uint32_t &slot) const
+{
+  bool found = false;
+  FlowRouteIndex::const_iterator flow = m_flowRoutes.find (flowId);
+  if (flow != m_flowRoutes.end ())
+    {
+      for (FlowRouteCandidates::const_iterator i = flow->second.begin (); i != flow->second.end () && !found; i++)
+        {
+          if (i->mask.IsMatch (dest, i->network))
+            {
+              slot = i->slot;
+              found = true;
+            }
+        }
+    }
+  if (!found)
+    {
+      uint32_t examined = 0;
+      found = LookupRange (flowId, dest, 0, slot, examined);
+    }
+
+  // A route parked on a down interface comes back with its sequence and
+  // may then win over the live one: it is the route of the flow as well
+  std::vector<uint32_t> parked;
+  m_networkRoutes.GetParkedFlowSlots (flowId, parked);
+  for (std::vector<uint32_t>::const_iterator i = parked.begin (); i != parked.end (); i++)
+    {
+      FlowRouteCandidate candidate = GetCandidate (*i);
+      if (!candidate.mask.IsMatch (dest, candidate.network))
+        {
+          continue;
+        }
+      bool single = m_networkRoutes.GetFlowSpan (*i) == 0;
+      if (!found
+          || (single && m_networkRoutes.GetFlowSpan (slot) > 0)
+          || (single == (m_networkRoutes.GetFlowSpan (slot) == 0) && IsPreferred (candidate, GetCandidate (slot))))
+        {
+          slot = *i;
+          found = true;
+        }
+    }
+  return found;
+}
+
+FtIpv4StaticRouting::FlowRouteCandidate
+FtIpv4StaticRouting::GetCandidate (uint32_t slot) const
+{
+  FlowRouteCandidate candidate;
+  candidate.slot = slot;
+  candidate.network = m_networkRoutes.GetDest (slot);
+  candidate.mask = m_networkRoutes.GetMask (slot);
+  candidate.prefixLength = m_networkRoutes.GetPrefixLength (slot);
+  candidate.metric = m_networkRoutes.GetMetric (slot);
+  candidate.sequence = m_networkRoutes.GetSequence (slot);
+  return candidate;
+}
+
+uint32_t
+FtIpv4StaticRouting::SplitFlowRange (uint32_t slot, uint32_t flowId, bool keepFlow)
+{
+  uint32_t first = m_networkRoutes.GetFlowId (slot);
+  uint32_t last = first + m_networkRoutes.GetFlowSpan (slot);
+  Ipv4Address network = m_networkRoutes.GetDest (slot);
+  Ipv4Mask mask = m_networkRoutes.GetMask (slot);
+  Ipv4Address gateway = m_networkRoutes.GetGateway (slot);
+  uint32_t interface = m_networkRoutes.GetInterface (slot);
+  uint32_t metric = m_networkRoutes.GetMetric (slot);
+  uint8_t flags = m_networkRoutes.GetFlags (slot);
+  bool parked = m_networkRoutes.IsParked (slot);
+  EraseRoute (slot);
+  std::vector<uint32_t> pieces;
+  if (flowId > first)
+    {
+      pieces.push_back (InsertRoute (first, network, mask, gateway, interface, metric, flags, 0, flowId - 1 - first));
+    }
+  if (flowId < last)
+    {
+      pieces.push_back (InsertRoute (flowId + 1, network, mask, gateway, interface, metric, flags, 0, last - flowId - 1));
+    }
+  uint32_t flowSlot = NO_ROUTE;
+  if (keepFlow)
+    {
+      flowSlot = InsertRoute (flowId, network, mask, gateway, interface, metric, flags);
+      pieces.push_back (flowSlot);
+    }
+  if (parked)
+    {
+      for (std::vector<uint32_t>::const_iterator i = pieces.begin (); i != pieces.end (); i++)
+        {
+          UnindexRoute (*i);
+          m_networkRoutes.Park (*i);
+        }
+    }
+  return flowSlot;
+}
+
+bool
+FtIpv4StaticRouting::RemoveFlowRoute (uint32_t flowId, Ipv4Address dest)
+{
+  NS_LOG_FUNCTION (this << flowId << " " << dest);
+  NS_ASSERT_MSG (flowId != 0, "FtIpv4StaticRouting::RemoveFlowRoute (): flowId 0 has no flow routes");
+  uint32_t slot;
+  if (!FindFlowRoute (flowId, dest, slot))
+    {
+      return false;
+    }
+  if (m_networkRoutes.GetFlowSpan (slot) > 0)
+    {
+      SplitFlowRange (slot, flowId, false);
+    }
+  else
+    {
+      EraseRoute (slot);
+    }
+  return true;
+}
+
+bool
+FtIpv4StaticRouting::AddBackupRouteTo (uint32_t flowId, Ipv4Address dest, Ipv4Address nextHop, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << flowId << " " << dest << " " << nextHop << " " << interface);
+  NS_ASSERT_MSG (flowId != 0, "FtIpv4StaticRouting::AddBackupRouteTo (): flowId 0 has no flow routes");
+  uint32_t slot;
+  if (!FindFlowRoute (flowId, dest, slot))
+    {
+      return false;
+    }
+  if (m_networkRoutes.GetWeight (slot) > 0)
+    {
+      NS_LOG_WARN ("Route of flow " << flowId << " to " << dest << " belongs to a multipath group, not protected");
+      return false;
+    }
+  if (m_networkRoutes.GetFlowSpan (slot) > 0)
+    {
+      slot = SplitFlowRange (slot, flowId, true);
+    }
+  ReleaseBackup (slot);
+  uint32_t backup = m_networkRoutes.Add (flowId, m_networkRoutes.GetDest (slot), m_networkRoutes.GetMask (slot),
+                                         nextHop, interface, m_networkRoutes.GetMetric (slot),
+                                         FtIpv4RoutingTable::BACKUP);
+  m_backupRoutes[slot] = backup;
+  m_protectedRoutes[backup] = slot;
+  InvalidateRouteCache ();
+  return true;
+}
+
+uint32_t
+FtIpv4StaticRouting::GetNBackupRoutes (void) const
+{
+  return m_backupRoutes.size ();
+}
+
+void
+FtIpv4StaticRouting::ReleaseBackup (uint32_t slot)
+{
+  if (m_backupRoutes.empty ())
+    {
+      return;
+    }
+  if (m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP)
+    {
+      BackupRoutes::iterator primary = m_protectedRoutes.find (slot);
+      NS_ASSERT (primary != m_protectedRoutes.end ());
+      m_backupRoutes.erase (primary->second);
+      m_protectedRoutes.erase (primary);
+      return;
+    }
+  BackupRoutes::iterator backup = m_backupRoutes.find (slot);
+  if (backup != m_backupRoutes.end ())
+    {
+      m_networkRoutes.Remove (backup->second);
+      m_protectedRoutes.erase (backup->second);
+      m_backupRoutes.erase (backup);
+    }
+}
+
+bool
+FtIpv4StaticRouting::IsInterfaceDown (uint32_t interface) const
+{
+  return interface < m_interfaceDown.size () && m_interfaceDown[interface];
+}
+
+uint32_t
+FtIpv4StaticRouting::GetLiveRoute (uint32_t slot, Ptr<NetDevice> oif)
+{
+  if (m_nInterfacesDown == 0 || !IsInterfaceDown (m_networkRoutes.GetInterface (slot)))
+    {
+      return slot;
+    }
+  // Only protected routes stay indexed while their interface is down
+  BackupRoutes::const_iterator backup = m_backupRoutes.find (slot);
+  if (oif != 0 || backup == m_backupRoutes.end ()
+      || IsInterfaceDown (m_networkRoutes.GetInterface (backup->second)))
+    {
+      return NO_ROUTE;
+    }
+  m_statistics.fastReroutes++;
+  return backup->second;
 }
 
 void 
@@ -123,7 +1320,7 @@ FtIpv4StaticRouting::AddHostRouteTo (Ipv4Address dest,
                                    uint32_t interface,
                                    uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << dest << " " << nextHop << " " << interface << " " << metric);
+  FT_HOT_LOG_FUNCTION (this << dest << " " << nextHop << " " << interface << " " << metric);
   AddNetworkRouteTo (dest, Ipv4Mask::GetOnes (), nextHop, interface, metric);
 }
 
@@ -132,19 +1329,104 @@ FtIpv4StaticRouting::AddHostRouteTo (Ipv4Address dest,
                                    uint32_t interface,
                                    uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << dest << " " << interface << " " << metric);
-  AddNetworkRouteTo (dest, Ipv4Mask::GetOnes (), interface, metric);
+  FT_HOT_LOG_FUNCTION (this << dest << " " << interface << " " << metric);
+  AddNetworkRouteTo (dest, Ipv4Mask::GetOnes (), interface, metric);
+}
+
+void 
+FtIpv4StaticRouting::AddHostRouteTo (uint32_t flowId,
+                                   Ipv4Address dest, 
+                                   Ipv4Address nextHop,
+                                   uint32_t interface,
+                                   uint32_t metric)
+{
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << dest << " " << nextHop << " " << interface << " " << metric);
+  AddNetworkRouteTo (flowId, dest, Ipv4Mask::GetOnes (), nextHop, interface, metric);
+}
+
+void
+FtIpv4StaticRouting::AddMultipathRouteTo (uint32_t flowId,
+                                          Ipv4Address network,
+                                          Ipv4Mask networkMask,
+                                          Ipv4Address nextHop,
+                                          uint32_t interface,
+                                          uint32_t weight,
+                                          uint32_t metric)
+{
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << network << " " << networkMask << " " << nextHop << " " << interface << " " << weight << " " << metric);
+  NS_ASSERT_MSG (weight > 0, "FtIpv4StaticRouting::AddMultipathRouteTo (): weight must be positive");
+  InsertRoute (flowId, network, networkMask, nextHop, interface, metric, 0, weight);
+}
+
+void
+FtIpv4StaticRouting::AddMultipathHostRouteTo (uint32_t flowId,
+                                              Ipv4Address dest,
+                                              Ipv4Address nextHop,
+                                              uint32_t interface,
+                                              uint32_t weight,
+                                              uint32_t metric)
+{
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << dest << " " << nextHop << " " << interface << " " << weight << " " << metric);
+  AddMultipathRouteTo (flowId, dest, Ipv4Mask::GetOnes (), nextHop, interface, weight, metric);
+}
+
+uint32_t
+FtIpv4StaticRouting::GetNMultipathGroups (void) const
+{
+  return m_multipathGroups.size ();
+}
+
+uint32_t
+FtIpv4StaticRouting::AddLabelRoute (uint32_t outLabel, Ipv4Address gateway, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << outLabel << gateway << interface);
+  NS_ASSERT_MSG (interface != NO_ROUTE, "FtIpv4StaticRouting::AddLabelRoute (): invalid interface");
+  if (m_labelRoutes.empty ())
+    {
+      // label 0 is never allocated
+      LabelRoute unused;
+      unused.interface = NO_ROUTE;
+      m_labelRoutes.push_back (unused);
+    }
+  uint32_t inLabel;
+  if (!m_freeLabels.empty ())
+    {
+      inLabel = m_freeLabels.back ();
+      m_freeLabels.pop_back ();
+    }
+  else
+    {
+      inLabel = m_labelRoutes.size ();
+      m_labelRoutes.push_back (LabelRoute ());
+    }
+  LabelRoute &entry = m_labelRoutes[inLabel];
+  entry.outLabel = outLabel;
+  entry.interface = interface;
+  entry.gateway = gateway;
+  entry.route = 0;
+  entry.generation = 0;
+  return inLabel;
+}
+
+uint32_t
+FtIpv4StaticRouting::RemoveLabelRoute (uint32_t inLabel)
+{
+  NS_LOG_FUNCTION (this << inLabel);
+  if (inLabel == 0 || inLabel >= m_labelRoutes.size () || m_labelRoutes[inLabel].interface == NO_ROUTE)
+    {
+      NS_LOG_WARN ("No label route for label " << inLabel);
+      return 0;
+    }
+  m_labelRoutes[inLabel].interface = NO_ROUTE;
+  m_labelRoutes[inLabel].route = 0;
+  m_freeLabels.push_back (inLabel);
+  return m_labelRoutes[inLabel].outLabel;
 }
 
-void 
-FtIpv4StaticRouting::AddHostRouteTo (uint32_t flowId,
-                                   Ipv4Address dest, 
-                                   Ipv4Address nextHop,
-                                   uint32_t interface,
-                                   uint32_t metric)
+uint32_t
+FtIpv4StaticRouting::GetNLabelRoutes (void) const
 {
-  NS_LOG_FUNCTION (this << flowId << " " << dest << " " << nextHop << " " << interface << " " << metric);
-  AddNetworkRouteTo (flowId, dest, Ipv4Mask::GetOnes (), nextHop, interface, metric);
+  return m_labelRoutes.empty () ? 0 : m_labelRoutes.size () - 1 - m_freeLabels.size ();
 }
 
 void 
@@ -152,7 +1434,7 @@ FtIpv4StaticRouting::SetDefaultRoute (Ipv4Address nextHop,
                                     uint32_t interface,
                                     uint32_t metric)
 {
-  NS_LOG_FUNCTION (this << nextHop << " " << interface << " " << metric);
+  FT_HOT_LOG_FUNCTION (this << nextHop << " " << interface << " " << metric);
   AddNetworkRouteTo (Ipv4Address ("0.0.0.0"), Ipv4Mask::GetZero (), nextHop, interface, metric);
 }
 
@@ -166,7 +1448,69 @@ FtIpv4StaticRouting::AddMulticastRoute (Ipv4Address origin,
   FtIpv4MulticastRoutingTableEntry *route = new FtIpv4MulticastRoutingTableEntry ();
   *route = FtIpv4MulticastRoutingTableEntry::CreateMulticastRoute (origin, group,
                                                                  inputInterface, outputInterfaces);
-  m_multicastRoutes.push_back (route);
+  uint32_t slot;
+  if (!m_freeMulticastSlots.empty ())
+    {
+      slot = m_freeMulticastSlots.back ();
+      m_freeMulticastSlots.pop_back ();
+      m_multicastRoutes[slot] = route;
+    }
+  else
+    {
+      slot = m_multicastRoutes.size ();
+      m_multicastRoutes.push_back (route);
+    }
+  m_multicastOrder.Append (slot);
+  IndexMulticastRoute (slot);
+}
+
+void
+FtIpv4StaticRouting::IndexMulticastRoute (uint32_t slot)
+{
+  FtIpv4MulticastRoutingTableEntry *entry = m_multicastRoutes[slot];
+  MulticastGroupRoute groupRoute;
+  groupRoute.entry = entry;
+  groupRoute.slot = slot;
+  groupRoute.inputInterface = entry->GetInputInterface ();
+  groupRoute.route = Create<Ipv4MulticastRoute> ();
+  groupRoute.route->SetGroup (entry->GetGroup ());
+  groupRoute.route->SetOrigin (entry->GetOrigin ());
+  groupRoute.route->SetParent (entry->GetInputInterface ());
+  for (uint32_t j = 0; j < entry->GetNOutputInterfaces (); j++)
+    {
+      if (entry->GetOutputInterface (j))
+        {
+          groupRoute.route->SetOutputTtl (entry->GetOutputInterface (j), Ipv4MulticastRoute::MAX_TTL - 1);
+        }
+    }
+  m_multicastGroups[entry->GetGroup ().Get ()].push_back (groupRoute);
+}
+
+void
+FtIpv4StaticRouting::EraseMulticastRoute (uint32_t slot)
+{
+  FtIpv4MulticastRoutingTableEntry *entry = m_multicastRoutes[slot];
+  MulticastGroups::iterator group = m_multicastGroups.find (entry->GetGroup ().Get ());
+  NS_ASSERT (group != m_multicastGroups.end ());
+  // only the routes of one group are searched, they are kept in order for
+  // the first match of LookupStatic
+  std::vector<MulticastGroupRoute> &routes = group->second;
+  for (std::vector<MulticastGroupRoute>::iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      if (i->slot == slot)
+        {
+          routes.erase (i);
+          break;
+        }
+    }
+  if (routes.empty ())
+    {
+      m_multicastGroups.erase (group);
+    }
+  m_multicastOrder.Remove (slot);
+  m_multicastRoutes[slot] = 0;
+  m_freeMulticastSlots.push_back (slot);
+  delete entry;
 }
 
 // default multicast routes are stored as a network route
@@ -176,42 +1520,28 @@ void
 FtIpv4StaticRouting::SetDefaultMulticastRoute (uint32_t outputInterface)
 {
   NS_LOG_FUNCTION (this << outputInterface);
-  FtIpv4RoutingTableEntry *route = new FtIpv4RoutingTableEntry ();
   Ipv4Address network = Ipv4Address ("224.0.0.0");
   Ipv4Mask networkMask = Ipv4Mask ("240.0.0.0");
-  *route = FtIpv4RoutingTableEntry::CreateNetworkRouteTo (network,
-                                                        networkMask,
-                                                        outputInterface);
-  m_networkRoutes.push_back (make_pair (route,0));
+  InsertRoute (0, network, networkMask, Ipv4Address::GetZero (), outputInterface, 0);
 }
 
 uint32_t 
 FtIpv4StaticRouting::GetNMulticastRoutes (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_multicastRoutes.size ();
+  return m_multicastOrder.GetN ();
 }
 
 FtIpv4MulticastRoutingTableEntry
 FtIpv4StaticRouting::GetMulticastRoute (uint32_t index) const
 {
   NS_LOG_FUNCTION (this << index);
-  NS_ASSERT_MSG (index < m_multicastRoutes.size (),
+  NS_ASSERT_MSG (index < m_multicastOrder.GetN (),
                  "FtIpv4StaticRouting::GetMulticastRoute ():  Index out of range");
 
-  if (index < m_multicastRoutes.size ())
+  if (index < m_multicastOrder.GetN ())
     {
-      uint32_t tmp = 0;
-      for (MulticastRoutesCI i = m_multicastRoutes.begin (); 
-           i != m_multicastRoutes.end (); 
-           i++) 
-        {
-          if (tmp  == index)
-            {
-              return *i;
-            }
-          tmp++;
-        }
+      return m_multicastRoutes[m_multicastOrder.GetSlot (index)];
     }
   return 0;
 }
@@ -222,17 +1552,17 @@ FtIpv4StaticRouting::RemoveMulticastRoute (Ipv4Address origin,
                                          uint32_t inputInterface)
 {
   NS_LOG_FUNCTION (this << origin << " " << group << " " << inputInterface);
-  for (MulticastRoutesI i = m_multicastRoutes.begin (); 
-       i != m_multicastRoutes.end (); 
-       i++) 
+  MulticastGroups::const_iterator routes = m_multicastGroups.find (group.Get ());
+  if (routes == m_multicastGroups.end ())
+    {
+      return false;
+    }
+  for (std::vector<MulticastGroupRoute>::const_iterator i = routes->second.begin ();
+       i != routes->second.end (); i++)
     {
-      FtIpv4MulticastRoutingTableEntry *route = *i;
-      if (origin == route->GetOrigin () &&
-          group == route->GetGroup () &&
-          inputInterface == route->GetInputInterface ())
+      if (origin == i->entry->GetOrigin () && inputInterface == i->inputInterface)
         {
-          delete *i;
-          m_multicastRoutes.erase (i);
+          EraseMulticastRoute (i->slot);
           return true;
         }
     }
@@ -243,25 +1573,16 @@ void
 FtIpv4StaticRouting::RemoveMulticastRoute (uint32_t index)
 {
   NS_LOG_FUNCTION (this << index);
-  uint32_t tmp = 0;
-  for (MulticastRoutesI i = m_multicastRoutes.begin (); 
-       i != m_multicastRoutes.end (); 
-       i++) 
+  if (index < m_multicastOrder.GetN ())
     {
-      if (tmp  == index)
-        {
-          delete *i;
-          m_multicastRoutes.erase (i);
-          return;
-        }
-      tmp++;
+      EraseMulticastRoute (m_multicastOrder.GetSlot (index));
     }
 }
 
 Ptr<Ipv4Route>
 FtIpv4StaticRouting::LookupStatic (Ipv4Address dest, Ptr<NetDevice> oif)
 {
-  NS_LOG_FUNCTION (this << dest << " " << oif);
+  FT_HOT_LOG_FUNCTION (this << dest << " " << oif);
   Ptr<Ipv4Route> rtentry = 0;
   uint16_t longest_mask = 0;
   uint32_t shortest_metric = 0xffffffff;
@@ -279,30 +1600,29 @@ FtIpv4StaticRouting::LookupStatic (Ipv4Address dest, Ptr<NetDevice> oif)
     }
 
 
-  for (NetworkRoutesI i = m_networkRoutes.begin (); 
-       i != m_networkRoutes.end (); 
-       i++) 
+  for (uint32_t i = 0; i < m_networkRoutes.GetN (); i++)
     {
-      FtIpv4RoutingTableEntry *j=i->first;
-      uint32_t metric =i->second;
-      Ipv4Mask mask = (j)->GetDestNetworkMask ();
-      uint16_t masklen = mask.GetPrefixLength ();
-      Ipv4Address entry = (j)->GetDestNetwork ();
-      NS_LOG_LOGIC ("Searching for route to " << dest << ", checking against route to " << entry << "/" << masklen);
+      uint32_t slot = m_networkRoutes.GetSlot (i);
+      uint32_t metric = m_networkRoutes.GetMetric (slot);
+      Ipv4Mask mask = m_networkRoutes.GetMask (slot);
+      uint16_t masklen = m_networkRoutes.GetPrefixLength (slot);
+      Ipv4Address entry = m_networkRoutes.GetDest (slot);
+      FT_HOT_LOG_LOGIC ("Searching for route to " << dest << ", checking against route to " << entry << "/" << masklen);
       if (mask.IsMatch (dest, entry)) 
         {
-          NS_LOG_LOGIC ("Found global network route " << j << ", mask length " << masklen << ", metric " << metric);
+          FT_HOT_LOG_LOGIC ("Found global network route " << slot << ", mask length " << masklen << ", metric " << metric);
+          uint32_t interfaceIdx = m_networkRoutes.GetInterface (slot);
           if (oif != 0)
             {
-              if (oif != m_ipv4->GetNetDevice (j->GetInterface ()))
+              if (oif != m_ipv4->GetNetDevice (interfaceIdx))
                 {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
+                  FT_HOT_LOG_LOGIC ("Not on requested interface, skipping");
                   continue;
                 }
             }
           if (masklen < longest_mask) // Not interested if got shorter mask
             {
-              NS_LOG_LOGIC ("Previous match longer, skipping");
+              FT_HOT_LOG_LOGIC ("Previous match longer, skipping");
               continue;
             }
           if (masklen > longest_mask) // Reset metric if longer masklen
@@ -312,16 +1632,14 @@ FtIpv4StaticRouting::LookupStatic (Ipv4Address dest, Ptr<NetDevice> oif)
           longest_mask = masklen;
           if (metric > shortest_metric)
             {
-              NS_LOG_LOGIC ("Equal mask length, but previous metric shorter, skipping");
+              FT_HOT_LOG_LOGIC ("Equal mask length, but previous metric shorter, skipping");
               continue;
             }
           shortest_metric = metric;
-          FtIpv4RoutingTableEntry* route = (j);
-          uint32_t interfaceIdx = route->GetInterface ();
           rtentry = Create<Ipv4Route> ();
-          rtentry->SetDestination (route->GetDest ());
-          rtentry->SetSource (m_ipv4->SourceAddressSelection (interfaceIdx, route->GetDest ()));
-          rtentry->SetGateway (route->GetGateway ());
+          rtentry->SetDestination (entry);
+          rtentry->SetSource (m_ipv4->SourceAddressSelection (interfaceIdx, entry));
+          rtentry->SetGateway (m_networkRoutes.GetGateway (slot));
           rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
           if (masklen == 32)
             {
@@ -331,22 +1649,127 @@ FtIpv4StaticRouting::LookupStatic (Ipv4Address dest, Ptr<NetDevice> oif)
     }
   if (rtentry != 0)
     {
-      NS_LOG_LOGIC ("Matching route via " << rtentry->GetGateway () << " at the end");
+      FT_HOT_LOG_LOGIC ("Matching route via " << rtentry->GetGateway () << " at the end");
     }
   else
     {
-      NS_LOG_LOGIC ("No matching route to " << dest << " found");
+      FT_HOT_LOG_LOGIC ("No matching route to " << dest << " found");
     }
   return rtentry;
 }
 
+bool
+FtIpv4StaticRouting::LookupPrefix (Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot,
+                                   uint32_t &examined) const
+{
+  FT_HOT_LOG_FUNCTION (this << dest << " " << oif);
+  if (oif == 0)
+    {
+      return m_prefixRoutes.Lookup (dest, true, 0, slot, examined);
+    }
+  int32_t interface = m_ipv4->GetInterfaceForDevice (oif);
+  if (interface < 0)
+    {
+      FT_HOT_LOG_LOGIC ("Requested device has no interface, no route");
+      return false;
+    }
+  return m_prefixRoutes.Lookup (dest, false, interface, slot, examined);
+}
+
+bool
+FtIpv4StaticRouting::LookupFib (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot,
+                                uint32_t &examined)
+{
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << dest << " " << oif);
+  if (m_fibDirty)
+    {
+      CompileFib ();
+    }
+  const FtIpv4FlowFib::Entry *begin;
+  const FtIpv4FlowFib::Entry *end;
+  if (!m_fib.Find (flowId, begin, end))
+    {
+      return false;
+    }
+  int32_t interface = -1;
+  if (oif != 0)
+    {
+      interface = m_ipv4->GetInterfaceForDevice (oif);
+      if (interface < 0)
+        {
+          return false;
+        }
+    }
+  // Entries are in preference order, the first match is the route
+  uint32_t addr = dest.Get ();
+  for (const FtIpv4FlowFib::Entry *e = begin; e != end; e++)
+    {
+      examined++;
+      if ((addr & e->mask) == (e->network & e->mask)
+          && (interface < 0 || e->interface == static_cast<uint32_t> (interface)))
+        {
+          uint32_t live = GetLiveRoute (e->slot, oif);
+          if (live == NO_ROUTE)
+            {
+              continue;
+            }
+          slot = live;
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+FtIpv4StaticRouting::LookupRange (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot,
+                                  uint32_t &examined) const
+{
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << dest << " " << oif);
+  if (m_flowRanges.empty ())
+    {
+      return false;
+    }
+  // a range covering flowId starts at most maxSpan flow ids before it
+  uint32_t maxSpan = *m_flowRangeSpans.rbegin ();
+  FlowRanges::const_iterator r = m_flowRanges.upper_bound (std::make_pair (flowId, 0xffffffffU));
+  const FlowRouteCandidate *best = 0;
+  while (r != m_flowRanges.begin ())
+    {
+      r--;
+      const FlowRange &range = r->second;
+      if (flowId - range.first > maxSpan)
+        {
+          break;
+        }
+      examined++;
+      if (range.last < flowId || !range.route.mask.IsMatch (dest, range.route.network))
+        {
+          continue;
+        }
+      if (oif != 0 && oif != m_ipv4->GetNetDevice (m_networkRoutes.GetInterface (range.route.slot)))
+        {
+          continue;
+        }
+      if (best == 0 || IsPreferred (range.route, *best))
+        {
+          best = &range.route;
+        }
+    }
+  if (best == 0)
+    {
+      return false;
+    }
+  FT_HOT_LOG_LOGIC ("Found flow range route " << best->slot);
+  slot = best->slot;
+  return true;
+}
+
 Ptr<Ipv4Route>
-FtIpv4StaticRouting::LookupStatic (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif)
+FtIpv4StaticRouting::LookupStatic (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif,
+                                   uint32_t flowHash)
 {
-  NS_LOG_FUNCTION (this << dest << " " << oif);
+  FT_HOT_LOG_FUNCTION (this << flowId << " " << dest << " " << oif << " " << flowHash);
   Ptr<Ipv4Route> rtentry = 0;
-  uint16_t longest_mask = 0;
-  uint32_t shortest_metric = 0xffffffff;
   /* when sending on local multicast, there have to be interface specified */
   if (dest.IsLocalMulticast ())
     {
@@ -360,69 +1783,121 @@ FtIpv4StaticRouting::LookupStatic (uint32_t flowId, Ipv4Address dest, Ptr<NetDev
       return rtentry;
     }
 
-
-  for (NetworkRoutesI i = m_networkRoutes.begin (); 
-       i != m_networkRoutes.end (); 
-       i++) 
+  // A steady-state flow asks for the same route on every packet: hand out
+  // the route built by the first lookup until the table changes.
+  RouteCacheKey key;
+  key.flowId = flowId;
+  key.dest = dest.Get ();
+  key.oif = PeekPointer (oif);
+  if (m_routeCacheSize > 0)
     {
-      FtIpv4RoutingTableEntry *j=i->first;
-      uint32_t metric =i->second;
-      Ipv4Mask mask = (j)->GetDestNetworkMask ();
-      uint16_t masklen = mask.GetPrefixLength ();
-      Ipv4Address entry = (j)->GetDestNetwork ();
-      uint32_t entryFlowId = (j)->GetFlowId();
-      
-      NS_LOG_LOGIC ("Searching for route to " << dest << ", checking against route to " << entry << "/" << masklen);
-      NS_LOG_LOGIC ("Searching for route with flowId = " << flowId);
-      if(flowId != entryFlowId) continue;
-      if (mask.IsMatch (dest, entry)) 
+      RouteCache::const_iterator cached = m_routeCache.find (key);
+      if (cached != m_routeCache.end () && cached->second.generation == m_routeGeneration)
         {
-          NS_LOG_LOGIC ("Found global network route " << j << ", mask length " << masklen << ", metric " << metric);
-          if (oif != 0)
-            {
-              if (oif != m_ipv4->GetNetDevice (j->GetInterface ()))
-                {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
-                  continue;
-                }
-            }
-          if (masklen < longest_mask) // Not interested if got shorter mask
+          FT_HOT_LOG_LOGIC ("Route cache hit for " << dest << " with flowId = " << flowId);
+          m_statistics.cacheHits++;
+          if (cached->second.backup)
             {
-              NS_LOG_LOGIC ("Previous match longer, skipping");
-              continue;
-            }
-          if (masklen > longest_mask) // Reset metric if longer masklen
-            {
-              shortest_metric = 0xffffffff;
+              // every packet of the flow takes the backup, not only the first
+              m_statistics.fastReroutes++;
             }
-          longest_mask = masklen;
-          if (metric > shortest_metric)
+          if (cached->second.group != 0)
             {
-              NS_LOG_LOGIC ("Equal mask length, but previous metric shorter, skipping");
-              continue;
+              RecordLookup (flowId, dest, 0, true);
+              return SelectMultipathRoute (*cached->second.group, flowHash);
             }
-          shortest_metric = metric;
-          FtIpv4RoutingTableEntry* route = (j);
-          uint32_t interfaceIdx = route->GetInterface ();
-          rtentry = Create<Ipv4Route> ();
-          rtentry->SetDestination (route->GetDest ());
-          rtentry->SetSource (m_ipv4->SourceAddressSelection (interfaceIdx, route->GetDest ()));
-          rtentry->SetGateway (route->GetGateway ());
-          rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
-          if (masklen == 32)
+          RecordLookup (flowId, dest, 0, cached->second.route != 0);
+          return cached->second.route;
+        }
+    }
+
+  bool found = false;
+  uint32_t slot = 0;
+  uint32_t examined = 0;
+  if (flowId == 0)
+    {
+      found = LookupPrefix (dest, oif, slot, examined);
+    }
+  else if (m_frozen && (m_fibDirty || m_fibStaleFlows.empty () || m_fibStaleFlows.count (flowId) == 0))
+    {
+      found = LookupFib (flowId, dest, oif, slot, examined);
+    }
+  else
+    {
+      // Candidates are kept in the order the table scan would prefer them,
+      // so the first one that matches is the route the scan would return.
+      FlowRouteIndex::const_iterator flow = m_flowRoutes.find (flowId);
+      if (flow != m_flowRoutes.end ())
+        {
+          const FlowRouteCandidates &candidates = flow->second;
+          for (FlowRouteCandidates::const_iterator i = candidates.begin ();
+               i != candidates.end ();
+               i++)
             {
+              examined++;
+              FT_HOT_LOG_LOGIC ("Searching for route to " << dest << " with flowId = " << flowId
+                                << ", checking against route to " << i->network << "/" << i->prefixLength);
+              if (!i->mask.IsMatch (dest, i->network))
+                {
+                  continue;
+                }
+              if (oif != 0 && oif != m_ipv4->GetNetDevice (m_networkRoutes.GetInterface (i->slot)))
+                {
+                  FT_HOT_LOG_LOGIC ("Not on requested interface, skipping");
+                  continue;
+                }
+              uint32_t live = GetLiveRoute (i->slot, oif);
+              if (live == NO_ROUTE)
+                {
+                  FT_HOT_LOG_LOGIC ("Interface down and no backup, skipping");
+                  continue;
+                }
+              FT_HOT_LOG_LOGIC ("Found global network route " << live << ", mask length " << i->prefixLength << ", metric " << i->metric);
+              slot = live;
+              found = true;
               break;
             }
         }
     }
+  if (!found && flowId != 0 && !m_flowRanges.empty ())
+    {
+      found = LookupRange (flowId, dest, oif, slot, examined);
+    }
+  CachedRoute result;
+  result.group = 0;
+  result.generation = m_routeGeneration;
+  result.backup = found && (m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP) != 0;
+  if (found && m_networkRoutes.GetWeight (slot) > 0 && oif == 0)
+    {
+      // The route stands for its whole multipath group, which picks the
+      // route of every packet; a requested output device pins the route
+      MultipathGroups::iterator group = m_multipathGroups.find (GetMultipathKey (slot));
+      NS_ASSERT (group != m_multipathGroups.end ());
+      result.group = &group->second;
+      rtentry = SelectMultipathRoute (group->second, flowHash);
+    }
+  else if (found)
+    {
+      rtentry = BuildRoute (slot);
+      result.route = rtentry;
+    }
   if (rtentry != 0)
     {
-      NS_LOG_LOGIC ("Matching route via " << rtentry->GetGateway () << " at the end");
+      FT_HOT_LOG_LOGIC ("Matching route via " << rtentry->GetGateway () << " at the end");
     }
   else
     {
-      NS_LOG_LOGIC ("No matching route to " << dest << " found");
+      FT_HOT_LOG_LOGIC ("No matching route to " << dest << " found");
+    }
+  if (m_routeCacheSize > 0)
+    {
+      if (m_routeCache.size () >= m_routeCacheSize && m_routeCache.count (key) == 0)
+        {
+          m_routeCache.clear ();
+        }
+      m_routeCache[key] = result;
     }
+  RecordLookup (flowId, dest, examined, found);
   return rtentry;
 }
 
@@ -432,57 +1907,42 @@ FtIpv4StaticRouting::LookupStatic (
   Ipv4Address group,
   uint32_t    interface)
 {
-  NS_LOG_FUNCTION (this << origin << " " << group << " " << interface);
-  Ptr<Ipv4MulticastRoute> mrtentry = 0;
-
-  for (MulticastRoutesI i = m_multicastRoutes.begin (); 
-       i != m_multicastRoutes.end (); 
-       i++) 
+  FT_HOT_LOG_FUNCTION (this << origin << " " << group << " " << interface);
+  MulticastGroups::const_iterator routes = m_multicastGroups.find (group.Get ());
+  if (routes == m_multicastGroups.end ())
     {
-      FtIpv4MulticastRoutingTableEntry *route = *i;
-//
-// We've been passed an origin address, a multicast group address and an 
-// interface index.  We have to decide if the current route in the list is
-// a match.
+      return 0;
+    }
 //
-// The first case is the restrictive case where the origin, group and index
-// matches.
+// The routes of the group are kept in the order they were added, the first
+// one with a matching input interface wins.  Source specific routes (SSM)
+// are not distinguished, the origin is not compared.
 //
-      if (origin == route->GetOrigin () && group == route->GetGroup ())
-        {
-          // Skipping this case (SSM) for now
-          NS_LOG_LOGIC ("Found multicast source specific route" << *i);
-        }
-      if (group == route->GetGroup ())
+  for (std::vector<MulticastGroupRoute>::const_iterator i = routes->second.begin ();
+       i != routes->second.end (); i++)
+    {
+      if (interface == Ipv4::IF_ANY || interface == i->inputInterface)
         {
-          if (interface == Ipv4::IF_ANY || 
-              interface == route->GetInputInterface ())
-            {
-              NS_LOG_LOGIC ("Found multicast route" << *i);
-              mrtentry = Create<Ipv4MulticastRoute> ();
-              mrtentry->SetGroup (route->GetGroup ());
-              mrtentry->SetOrigin (route->GetOrigin ());
-              mrtentry->SetParent (route->GetInputInterface ());
-              for (uint32_t j = 0; j < route->GetNOutputInterfaces (); j++)
-                {
-                  if (route->GetOutputInterface (j))
-                    {
-                      NS_LOG_LOGIC ("Setting output interface index " << route->GetOutputInterface (j));
-                      mrtentry->SetOutputTtl (route->GetOutputInterface (j), Ipv4MulticastRoute::MAX_TTL - 1);
-                    }
-                }
-              return mrtentry;
-            }
+          FT_HOT_LOG_LOGIC ("Found multicast route" << i->entry);
+          return i->route;
         }
     }
-  return mrtentry;
+  return 0;
+}
+
+void
+FtIpv4StaticRouting::ReserveRoutes (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_networkRoutes.Reserve (m_networkRoutes.GetN () + n);
+  m_flowRoutes.reserve (m_flowRoutes.size () + n);
 }
 
 uint32_t 
 FtIpv4StaticRouting::GetNRoutes (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_networkRoutes.size ();;
+  return m_networkRoutes.GetN ();
 }
 
 FtIpv4RoutingTableEntry
@@ -492,15 +1952,13 @@ FtIpv4StaticRouting::GetDefaultRoute ()
   // Basically a repeat of LookupStatic, retained for backward compatibility
   Ipv4Address dest ("0.0.0.0");
   uint32_t shortest_metric = 0xffffffff;
-  FtIpv4RoutingTableEntry *result = 0;
-  for (NetworkRoutesI i = m_networkRoutes.begin (); 
-       i != m_networkRoutes.end (); 
-       i++) 
+  uint32_t result = 0;
+  bool found = false;
+  for (uint32_t i = 0; i < m_networkRoutes.GetN (); i++)
     {
-      FtIpv4RoutingTableEntry *j = i->first;
-      uint32_t metric = i->second;
-      Ipv4Mask mask = (j)->GetDestNetworkMask ();
-      uint16_t masklen = mask.GetPrefixLength ();
+      uint32_t slot = m_networkRoutes.GetSlot (i);
+      uint32_t metric = m_networkRoutes.GetMetric (slot);
+      uint16_t masklen = m_networkRoutes.GetPrefixLength (slot);
       if (masklen != 0)
         {
           continue;
@@ -510,11 +1968,12 @@ FtIpv4StaticRouting::GetDefaultRoute ()
           continue;
         }
       shortest_metric = metric;
-      result = j;
+      result = slot;
+      found = true;
     }
-  if (result)
+  if (found)
     {
-      return result;
+      return m_networkRoutes.GetEntry (result);
     }
   else
     {
@@ -526,73 +1985,36 @@ FtIpv4RoutingTableEntry
 FtIpv4StaticRouting::GetRoute (uint32_t index) const
 {
   NS_LOG_FUNCTION (this << index);
-  uint32_t tmp = 0;
-  for (NetworkRoutesCI j = m_networkRoutes.begin (); 
-       j != m_networkRoutes.end (); 
-       j++) 
-    {
-      if (tmp  == index)
-        {
-          return j->first;
-        }
-      tmp++;
-    }
-  NS_ASSERT (false);
-  // quiet compiler.
-  return 0;
+  return m_networkRoutes.GetEntry (m_networkRoutes.GetSlot (index));
 }
 
 uint32_t
 FtIpv4StaticRouting::GetMetric (uint32_t index) const
 {
   NS_LOG_FUNCTION (this << index);
-  uint32_t tmp = 0;
-  for (NetworkRoutesCI j = m_networkRoutes.begin ();
-       j != m_networkRoutes.end (); 
-       j++) 
-    {
-      if (tmp == index)
-        {
-          return j->second;
-        }
-      tmp++;
-    }
-  NS_ASSERT (false);
-  // quiet compiler.
-  return 0;
+  return m_networkRoutes.GetMetric (m_networkRoutes.GetSlot (index));
 }
 void 
 FtIpv4StaticRouting::RemoveRoute (uint32_t index)
 {
   NS_LOG_FUNCTION (this << index);
-  uint32_t tmp = 0;
-  for (NetworkRoutesI j = m_networkRoutes.begin (); 
-       j != m_networkRoutes.end (); 
-       j++) 
-    {
-      if (tmp == index)
-        {
-          delete j->first;
-          m_networkRoutes.erase (j);
-          return;
-        }
-      tmp++;
-    }
-  NS_ASSERT (false);
+  EraseRoute (m_networkRoutes.GetSlot (index));
 }
 
 
+
 //changed, printing tag, added lookup with tag
 Ptr<Ipv4Route> 
 FtIpv4StaticRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
 {
-  NS_LOG_FUNCTION (this << p<< header << oif << sockerr);
+  FT_HOT_LOG_FUNCTION (this << p<< header << oif << sockerr);
+  m_statistics.routeOutput++;
 
   FtTag tag;
   uint32_t packetFlowId = 0;
   if(p->FindFirstMatchingByteTag(tag))
   {
-    NS_LOG_INFO ("------- routeOutput with packet tag = " << (uint32_t)tag.GetSimpleValue());  
+    FT_HOT_LOG_INFO ("------- routeOutput with packet tag = " << (uint32_t)tag.GetSimpleValue());  
     packetFlowId = tag.GetSimpleValue();
   }
 
@@ -600,6 +2022,29 @@ FtIpv4StaticRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<N
   Ipv4Address destination = header.GetDestination ();
   Ptr<Ipv4Route> rtentry = 0;
 
+  if (m_sourceRouting && p != 0 && oif == 0 && !destination.IsMulticast ())
+    {
+      FtSourceRouteTag sourceRoute;
+      rtentry = LookupSourceRoute (p, sourceRoute);
+      if (rtentry)
+        {
+          p->ReplacePacketTag (sourceRoute);
+          sockerr = Socket::ERROR_NOTERROR;
+          return rtentry;
+        }
+    }
+  if (m_labelSwitching && p != 0 && oif == 0 && !destination.IsMulticast ())
+    {
+      FtLabelTag labelTag;
+      rtentry = LookupLabel (p, labelTag);
+      if (rtentry)
+        {
+          p->ReplacePacketTag (labelTag);
+          sockerr = Socket::ERROR_NOTERROR;
+          return rtentry;
+        }
+    }
+
   // Multicast goes here
   if (destination.IsMulticast ())
     {
@@ -609,10 +2054,17 @@ FtIpv4StaticRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<N
       // This is a well-known property of sockets implementation on 
       // many Unix variants.
       // So, we just log it and fall through to LookupStatic ()
-      NS_LOG_LOGIC ("RouteOutput()::Multicast destination");
+      FT_HOT_LOG_LOGIC ("RouteOutput()::Multicast destination");
+    }
+  // The transport header is not on the packet yet: the multipath hash of a
+  // locally sent packet only covers its addresses, protocol and flowId
+  uint32_t flowHash = 0;
+  if (m_multipathMode != MULTIPATH_PER_PACKET && !m_multipathGroups.empty ())
+    {
+      flowHash = GetFlowHash (p, header, packetFlowId, false);
     }
   //rtentry = LookupStatic (destination, oif);
-  rtentry = LookupStatic (packetFlowId, destination, oif);
+  rtentry = LookupStatic (packetFlowId, destination, oif, flowHash);
   if (rtentry)
     { 
       sockerr = Socket::ERROR_NOTERROR;
@@ -625,21 +2077,40 @@ FtIpv4StaticRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<N
 }
 
 
-//changed, added tags printing
+uint32_t
+FtIpv4StaticRouting::GetInputFlowId (Ptr<const Packet> p, const Ipv4Header &ipHeader) const
+{
+  if (m_flowIdSource == FLOW_ID_DESTINATION_PORT)
+    {
+      // UDP and TCP headers both start with the source and destination ports
+      uint8_t ports[4];
+      if ((ipHeader.GetProtocol () != 17 && ipHeader.GetProtocol () != 6)
+          || ipHeader.GetFragmentOffset () != 0
+          || p->CopyData (ports, 4) != 4)
+        {
+          return 0;
+        }
+      FT_HOT_LOG_INFO ("------- routeInput with destination port = " << ((ports[2] << 8) | ports[3]));
+      return (ports[2] << 8) | ports[3];
+    }
+
+  FtTag tag;
+  if (p->FindFirstMatchingByteTag (tag))
+    {
+      FT_HOT_LOG_INFO ("------- routeInput with packet tag = " << (uint32_t)tag.GetSimpleValue ());
+      return tag.GetSimpleValue ();
+    }
+  return 0;
+}
+
+//changed, forwarded packets are looked up with their flowId
 bool 
 FtIpv4StaticRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &ipHeader, Ptr<const NetDevice> idev,
                                 UnicastForwardCallback ucb, MulticastForwardCallback mcb,
                                 LocalDeliverCallback lcb, ErrorCallback ecb)
 {
-  NS_LOG_FUNCTION (this << p << ipHeader << ipHeader.GetSource () << ipHeader.GetDestination () << idev << &ucb << &mcb << &lcb << &ecb);
-
-  FtTag tag;
-  uint32_t packetFlowId = 0;
-  if(p->FindFirstMatchingByteTag(tag))
-  {
-    NS_LOG_INFO ("------- routeInput with packet tag = " << (uint32_t)tag.GetSimpleValue());  
-    packetFlowId = tag.GetSimpleValue();
-  }
+  FT_HOT_LOG_FUNCTION (this << p << ipHeader << ipHeader.GetSource () << ipHeader.GetDestination () << idev << &ucb << &mcb << &lcb << &ecb);
+  m_statistics.routeInput++;
 
   NS_ASSERT (m_ipv4 != 0);
   // Check if input device supports IP 
@@ -650,19 +2121,19 @@ FtIpv4StaticRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &ipHeade
 
   if (ipHeader.GetDestination ().IsMulticast ())
     {
-      NS_LOG_LOGIC ("Multicast destination");
+      FT_HOT_LOG_LOGIC ("Multicast destination");
       Ptr<Ipv4MulticastRoute> mrtentry =  LookupStatic (ipHeader.GetSource (),
                                                         ipHeader.GetDestination (), m_ipv4->GetInterfaceForDevice (idev));
 
       if (mrtentry)
         {
-          NS_LOG_LOGIC ("Multicast route found");
+          FT_HOT_LOG_LOGIC ("Multicast route found");
           mcb (mrtentry, p, ipHeader); // multicast forwarding callback
           return true;
         }
       else
         {
-          NS_LOG_LOGIC ("Multicast route not found");
+          FT_HOT_LOG_LOGIC ("Multicast route not found");
           return false; // Let other routing protocols try to handle this
         }
     }
@@ -671,7 +2142,7 @@ FtIpv4StaticRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &ipHeade
     {
       if (!lcb.IsNull ())
         {
-          NS_LOG_LOGIC ("Local delivery to " << ipHeader.GetDestination ());
+          FT_HOT_LOG_LOGIC ("Local delivery to " << ipHeader.GetDestination ());
           lcb (p, ipHeader, iif);
           return true;
         }
@@ -689,22 +2160,55 @@ FtIpv4StaticRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &ipHeade
   // Check if input device supports IP forwarding
   if (m_ipv4->IsForwarding (iif) == false)
     {
-      NS_LOG_LOGIC ("Forwarding disabled for this interface");
+      FT_HOT_LOG_LOGIC ("Forwarding disabled for this interface");
       ecb (p, ipHeader, Socket::ERROR_NOROUTETOHOST);
       return true;
     }
+  if (m_sourceRouting)
+    {
+      FtSourceRouteTag sourceRoute;
+      Ptr<Ipv4Route> rtentry = LookupSourceRoute (p, sourceRoute);
+      if (rtentry != 0)
+        {
+          // the next hop reads the advanced hop index
+          Ptr<Packet> forwarded = p->Copy ();
+          forwarded->ReplacePacketTag (sourceRoute);
+          ucb (rtentry, forwarded, ipHeader);
+          return true;
+        }
+    }
+  if (m_labelSwitching)
+    {
+      FtLabelTag labelTag;
+      Ptr<Ipv4Route> rtentry = LookupLabel (p, labelTag);
+      if (rtentry != 0)
+        {
+          // the next hop reads the swapped label
+          Ptr<Packet> forwarded = p->Copy ();
+          forwarded->ReplacePacketTag (labelTag);
+          ucb (rtentry, forwarded, ipHeader);
+          return true;
+        }
+    }
   // Next, try to find a route
   //Ptr<Ipv4Route> rtentry = LookupStatic (ipHeader.GetDestination ());
-  Ptr<Ipv4Route> rtentry = LookupStatic (packetFlowId, ipHeader.GetDestination ());
+  uint32_t packetFlowId = GetInputFlowId (p, ipHeader);
+  uint32_t flowHash = 0;
+  if (m_multipathMode != MULTIPATH_PER_PACKET && !m_multipathGroups.empty ())
+    {
+      // flowlets are tracked per flowId, not per transport flow
+      flowHash = GetFlowHash (p, ipHeader, packetFlowId, m_multipathMode == MULTIPATH_HASH);
+    }
+  Ptr<Ipv4Route> rtentry = LookupStatic (packetFlowId, ipHeader.GetDestination (), 0, flowHash);
   if (rtentry != 0)
     {
-      NS_LOG_LOGIC ("Found unicast destination- calling unicast callback");
+      FT_HOT_LOG_LOGIC ("Found unicast destination- calling unicast callback");
       ucb (rtentry, p, ipHeader);  // unicast forwarding callback
       return true;
     }
   else
     {
-      NS_LOG_LOGIC ("Did not find unicast destination- returning false");
+      FT_HOT_LOG_LOGIC ("Did not find unicast destination- returning false");
       return false; // Let other routing protocols try to handle this
     }
 }
@@ -718,18 +2222,35 @@ void
 FtIpv4StaticRouting::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
-  for (NetworkRoutesI j = m_networkRoutes.begin (); 
-       j != m_networkRoutes.end (); 
-       j = m_networkRoutes.erase (j)) 
-    {
-      delete (j->first);
-    }
+  m_networkRoutes.Clear ();
+  m_flowRoutes.clear ();
+  m_flowRanges.clear ();
+  m_flowRangeSpans.clear ();
+  m_prefixRoutes.Clear ();
+  m_fib.Clear ();
+  m_fibStaleFlows.clear ();
+  m_backupRoutes.clear ();
+  m_protectedRoutes.clear ();
+  m_interfaceDown.clear ();
+  m_nInterfacesDown = 0;
+  InvalidateRouteCache ();
+  m_routeCache.clear ();
+  m_interfaceRoutes.clear ();
+  m_labelRoutes.clear ();
+  m_freeLabels.clear ();
+  m_multipathGroups.clear ();
+  m_flowlets.clear ();
+  m_interfaceQueues.clear ();
   for (MulticastRoutesI i = m_multicastRoutes.begin (); 
        i != m_multicastRoutes.end (); 
-       i = m_multicastRoutes.erase (i)) 
+       i++) 
     {
       delete (*i);
     }
+  m_multicastRoutes.clear ();
+  m_freeMulticastSlots.clear ();
+  m_multicastOrder.Clear ();
+  m_multicastGroups.clear ();
   m_ipv4 = 0;
   Ipv4RoutingProtocol::DoDispose ();
 }
@@ -738,6 +2259,16 @@ void
 FtIpv4StaticRouting::NotifyInterfaceUp (uint32_t i)
 {
   NS_LOG_FUNCTION (this << i);
+  InvalidateRouteCache ();
+  if (IsInterfaceDown (i))
+    {
+      m_interfaceDown[i] = 0;
+      m_nInterfacesDown--;
+    }
+  // Restore the static routes parked when the interface went down
+  std::vector<uint32_t> restored;
+  m_networkRoutes.UnparkInterface (i, restored);
+  IndexRoutes (restored);
   // If interface address and network mask have been set, add a route
   // to the network of the interface (like e.g. ifconfig does on a
   // Linux box)
@@ -747,8 +2278,9 @@ FtIpv4StaticRouting::NotifyInterfaceUp (uint32_t i)
           m_ipv4->GetAddress (i,j).GetMask () != Ipv4Mask () &&
           m_ipv4->GetAddress (i,j).GetMask () != Ipv4Mask::GetOnes ())
         {
-          AddNetworkRouteTo (m_ipv4->GetAddress (i,j).GetLocal ().CombineMask (m_ipv4->GetAddress (i,j).GetMask ()),
-                             m_ipv4->GetAddress (i,j).GetMask (), i);
+          InsertRoute (0, m_ipv4->GetAddress (i,j).GetLocal ().CombineMask (m_ipv4->GetAddress (i,j).GetMask ()),
+                       m_ipv4->GetAddress (i,j).GetMask (), Ipv4Address::GetZero (), i, 0,
+                       FtIpv4RoutingTable::CONNECTED);
         }
     }
 }
@@ -757,17 +2289,37 @@ void
 FtIpv4StaticRouting::NotifyInterfaceDown (uint32_t i)
 {
   NS_LOG_FUNCTION (this << i);
-  // Remove all static routes that are going through this interface
-  for (NetworkRoutesI it = m_networkRoutes.begin (); it != m_networkRoutes.end (); )
+  InvalidateRouteCache ();
+  if (!IsInterfaceDown (i))
+    {
+      if (i >= m_interfaceDown.size ())
+        {
+          m_interfaceDown.resize (i + 1, 0);
+        }
+      m_interfaceDown[i] = 1;
+      m_nInterfacesDown++;
+    }
+  // Withdraw all routes that are going through this interface.  Connected
+  // routes are removed, the interface adds them again when it comes up;
+  // the other routes are parked until then.  Protected routes and backups
+  // stay in place: lookups switch to the backup (see GetLiveRoute), so a
+  // failure does not change the indexes of the flows that have one.
+  std::vector<uint32_t> slots = m_networkRoutes.GetInterfaceSlots (i);
+  for (std::vector<uint32_t>::const_iterator slot = slots.begin (); slot != slots.end (); slot++)
     {
-      if (it->first->GetInterface () == i)
+      if ((m_networkRoutes.GetFlags (*slot) & FtIpv4RoutingTable::BACKUP)
+          || (!m_backupRoutes.empty () && m_backupRoutes.count (*slot) > 0))
+        {
+          continue;
+        }
+      UnindexRoute (*slot);
+      if (m_networkRoutes.GetFlags (*slot) & FtIpv4RoutingTable::CONNECTED)
         {
-          delete it->first;
-          it = m_networkRoutes.erase (it);
+          m_networkRoutes.Remove (*slot);
         }
       else
         {
-          it++;
+          m_networkRoutes.Park (*slot);
         }
     }
 }
@@ -776,6 +2328,8 @@ void
 FtIpv4StaticRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << " " << address.GetLocal ());
+  // the source address of cached routes may change
+  InvalidateRouteCache ();
   if (!m_ipv4->IsUp (interface))
     {
       return;
@@ -786,14 +2340,15 @@ FtIpv4StaticRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress
   if (address.GetLocal () != Ipv4Address () &&
       address.GetMask () != Ipv4Mask ())
     {
-      AddNetworkRouteTo (networkAddress,
-                         networkMask, interface);
+      InsertRoute (0, networkAddress, networkMask, Ipv4Address::GetZero (), interface, 0,
+                   FtIpv4RoutingTable::CONNECTED);
     }
 }
 void 
 FtIpv4StaticRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << " " << address.GetLocal ());
+  InvalidateRouteCache ();
   if (!m_ipv4->IsUp (interface))
     {
       return;
@@ -802,21 +2357,26 @@ FtIpv4StaticRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddre
   Ipv4Mask networkMask = address.GetMask ();
   // Remove all static routes that are going through this interface
   // which reference this network
-  for (NetworkRoutesI it = m_networkRoutes.begin (); it != m_networkRoutes.end (); )
+  std::vector<uint32_t> removed;
+  const std::vector<uint32_t> &slots = m_networkRoutes.GetInterfaceSlots (interface);
+  for (std::vector<uint32_t>::const_iterator j = slots.begin (); j != slots.end (); j++)
     {
-      if (it->first->GetInterface () == interface
-          && it->first->IsNetwork ()
-          && it->first->GetDestNetwork () == networkAddress
-          && it->first->GetDestNetworkMask () == networkMask)
+      uint32_t slot = *j;
+      if (m_networkRoutes.GetPrefixLength (slot) != 32
+          && m_networkRoutes.GetDest (slot) == networkAddress
+          && m_networkRoutes.GetMask (slot) == networkMask
+          && !(m_networkRoutes.GetFlags (slot) & FtIpv4RoutingTable::BACKUP))
         {
-          delete it->first;
-          it = m_networkRoutes.erase (it);
-        }
-      else
-        {
-          it++;
+          UnindexRoute (slot);
+          removed.push_back (slot);
         }
     }
+  // Backups go with their route; none of them is in removed
+  for (std::vector<uint32_t>::const_iterator j = removed.begin (); j != removed.end (); j++)
+    {
+      ReleaseBackup (*j);
+    }
+  m_networkRoutes.Remove (removed);
 }
 
 void 
@@ -825,6 +2385,9 @@ FtIpv4StaticRouting::SetIpv4 (Ptr<Ipv4> ipv4)
   NS_LOG_FUNCTION (this << ipv4);
   NS_ASSERT (m_ipv4 == 0 && ipv4 != 0);
   m_ipv4 = ipv4;
+  InvalidateRouteCache ();
+  Ptr<Node> node = m_ipv4->GetObject<Node> ();
+  m_hashSalt = node != 0 ? (node->GetId () + 1) * 0x9e3779b1 : 0;
   for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
     {
       if (m_ipv4->IsUp (i))
@@ -851,10 +2414,10 @@ FtIpv4StaticRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::U
 
   if (GetNRoutes () > 0)
     {
-      *os << "Destination     Gateway         Genmask         Flags Metric Ref    Use Iface" << std::endl;
+      *os << "Destination     Gateway         Genmask         Flags Metric Ref    Use Iface Flows" << std::endl;
       for (uint32_t j = 0; j < GetNRoutes (); j++)
         {
-          std::ostringstream dest, gw, mask, flags;
+          std::ostringstream dest, gw, mask, flags, iface;
           FtIpv4RoutingTableEntry route = GetRoute (j);
           dest << route.GetDest ();
           *os << std::setiosflags (std::ios::left) << std::setw (16) << dest.str ();
@@ -879,11 +2442,25 @@ FtIpv4StaticRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::U
           *os << "-" << "   ";
           if (Names::FindName (m_ipv4->GetNetDevice (route.GetInterface ())) != "")
             {
-              *os << Names::FindName (m_ipv4->GetNetDevice (route.GetInterface ()));
+              iface << Names::FindName (m_ipv4->GetNetDevice (route.GetInterface ()));
+            }
+          else
+            {
+              iface << route.GetInterface ();
+            }
+          *os << std::setiosflags (std::ios::left) << std::setw (6) << iface.str ();
+          // flow id, first-last for a range route, - for routes without flowId
+          if (route.GetFlowId () == 0)
+            {
+              *os << "-";
+            }
+          else if (route.GetLastFlowId () != route.GetFlowId ())
+            {
+              *os << route.GetFlowId () << "-" << route.GetLastFlowId ();
             }
           else
             {
-              *os << route.GetInterface ();
+              *os << route.GetFlowId ();
             }
           *os << std::endl;
         }
@@ -2,7 +2,29 @@
  * This class is based on ns3::Ipv4StaticRouting with slight modifications:
  * - adding routes (in AddNetworkRouteTo) as FtIpv4RoutingTableEntry (with flowId)
  * - LookupStatic method uses flowId to route packet (in RouteInput and RouteOutput)
- * - multicast part is not modified
+ * - routes are indexed by flowId, so a flow lookup only examines the routes of that flow
+ * - routes are stored in FtIpv4RoutingTable (parallel arrays) instead of a list of entries
+ * - flow lookup results are cached per (flowId, destination, output device)
+ * - routes without flowId (flowId 0) are matched with a prefix trie (FtIpv4PrefixTrie)
+ * - Freeze compiles the flow routes into a perfect-hashed FtIpv4FlowFib used by lookups
+ * - unicast routes are accessed by index in logarithmic time, and a dump by index is
+ *   linear (GetRoute, GetMetric, RemoveRoute)
+ * - interface down parks the static routes of the interface, interface up restores them
+ * - lookup statistics (calls, hits, misses, entries examined), Lookup trace source and memory usage
+ * - flowId can be taken from the transport destination port instead of the FtTag (FlowIdSource)
+ * - weighted multipath groups split a flow over several next hops (MultipathMode)
+ * - flowlet mode moves a flow to the least loaded route of its group after an idle gap
+ * - static unicast routes can be written to and read back from a binary stream
+ * - source routed packets (FtSourceRouteTag) are forwarded without a lookup (SourceRouting)
+ * - label switched packets (FtLabelTag) index a per node label table and swap the label
+ * - routes can cover a flowId range; AggregateFlowRoutes merges adjacent flows into ranges;
+ *   GetRoute and PrintRoutingTable give the whole range
+ * - per-packet and per-route logging can be compiled out (ft-hot-path-log.h)
+ * - RemoveFlowRoute and route changes after Freeze update the flow without recompiling the FIB
+ * - backup next hops (AddBackupRouteTo) take over in place when the interface of a route is down
+ * - multicast routes are indexed by group, with their Ipv4MulticastRoute built once
+ * - multicast routes are kept in slots with an FtIpv4RouteOrder, so removal and access
+ *   by index are logarithmic
  */
 
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
@@ -30,6 +52,12 @@
 #define FT_IPV4_STATIC_ROUTING_H
 
 #include <list>
+#include <map>
+#include <set>
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <stdint.h>
 #include "ns3/ipv4-address.h"
@@ -38,6 +66,13 @@
 #include "ns3/ptr.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
+#include "ns3/traced-callback.h"
+#include "ns3/nstime.h"
+#include "ns3/queue.h"
+#include "ns3/ft-ipv4-routing-table.h"
+#include "ns3/ft-ipv4-route-order.h"
+#include "ns3/ft-ipv4-prefix-trie.h"
+#include "ns3/ft-ipv4-flow-fib.h"
 
 namespace ns3 {
 
@@ -49,6 +84,8 @@ class Ipv4Header;
 class FtIpv4RoutingTableEntry;
 class FtIpv4MulticastRoutingTableEntry;
 class Node;
+class FtSourceRouteTag;
+class FtLabelTag;
 
 /**
  * \ingroup ipv4Routing
@@ -78,6 +115,62 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /**
+   * \brief Number of buckets of the entries examined histogram.
+   *
+   * Bucket 0 counts lookups that examined no entry (route cache hits);
+   * bucket k > 0 counts lookups that examined [2^(k-1), 2^k) entries.
+   */
+  static const uint32_t EXAMINED_BUCKETS = 33;
+
+  /**
+   * \brief Where the flowId of a packet is read from.
+   */
+  enum FlowIdSource
+  {
+    FLOW_ID_TAG,             //!< FtTag byte tag of the packet
+    FLOW_ID_DESTINATION_PORT //!< UDP or TCP destination port (FtTag when sending)
+  };
+
+  /**
+   * \brief How packets are spread over the routes of a multipath group.
+   */
+  enum MultipathMode
+  {
+    MULTIPATH_HASH,          //!< per transport flow: hash of addresses, protocol and ports
+    MULTIPATH_PER_PACKET,    //!< per packet: smooth weighted round robin
+    MULTIPATH_FLOWLET        //!< per flowlet: least loaded route after an idle gap
+  };
+
+  /**
+   * \brief Counters of the unicast lookups of a node.
+   */
+  struct Statistics
+  {
+    uint64_t routeInput;            //!< RouteInput calls
+    uint64_t routeOutput;           //!< RouteOutput calls
+    uint64_t hits;                  //!< unicast lookups that found a route
+    uint64_t misses;                //!< unicast lookups that found no route
+    uint64_t cacheHits;             //!< lookups answered by the route cache
+    uint64_t flowlets;              //!< flowlets started (MULTIPATH_FLOWLET)
+    uint64_t flowletMoves;          //!< flowlets that moved their flow to another route
+    uint64_t sourceRouted;          //!< packets forwarded by their FtSourceRouteTag
+    uint64_t labelSwitched;         //!< packets forwarded by their FtLabelTag
+    uint64_t fastReroutes;          //!< lookups answered with a backup route, cached or not
+    std::vector<uint64_t> examined; //!< log2 histogram of the entries examined per lookup
+  };
+
+  /**
+   * TracedCallback signature for unicast lookups.
+   *
+   * \param [in] flowId flow id of the packet
+   * \param [in] dest destination address
+   * \param [in] examined number of table entries examined
+   * \param [in] found true if a route was found
+   */
+  typedef void (* LookupTracedCallback)
+    (uint32_t flowId, Ipv4Address dest, uint32_t examined, bool found);
+
   FtIpv4StaticRouting ();
   virtual ~FtIpv4StaticRouting ();
 
@@ -195,6 +288,176 @@ public:
                        uint32_t interface,
                        uint32_t metric = 0);
 
+/**
+ * \brief Add a network route for a range of flow ids.
+ *
+ * A range route is only consulted for a flow that has no route of its own
+ * to the destination.  Among the range routes covering the flow and the
+ * destination, the preference is the same as among the routes of a flow
+ * (longest prefix, then metric).  The range 1 to 0xffffffff makes a
+ * wildcard route for every flow.
+ *
+ * \param firstFlowId first flow id of the range, not 0
+ * \param lastFlowId last flow id of the range
+ * \param network The Ipv4Address network for this route.
+ * \param networkMask The Ipv4Mask to extract the network.
+ * \param nextHop The next hop in the route to the destination network.
+ * \param interface The network interface index used to send packets to the
+ * destination.
+ * \param metric Metric of route in case of multiple routes to same destination
+ */
+  void AddFlowRangeRouteTo (uint32_t firstFlowId,
+                            uint32_t lastFlowId,
+                            Ipv4Address network,
+                            Ipv4Mask networkMask,
+                            Ipv4Address nextHop,
+                            uint32_t interface,
+                            uint32_t metric = 0);
+
+/**
+ * \brief Merge the routes of consecutive flow ids into range routes.
+ *
+ * Flows with exactly one route, not weighted, are merged when their flow
+ * ids are consecutive and their routes have the same destination, mask,
+ * gateway, interface and metric.  Flows covered by a range route already,
+ * or with a route parked on a down interface, are left alone.  Lookups
+ * give the same routes as before;
+ * the merged routes are replaced by one range route each, placed at the
+ * end of the table.  Meant to be called once the routes are installed.
+ *
+ * \return number of routes removed from the table
+ */
+  uint32_t AggregateFlowRoutes (void);
+
+/**
+ * \return number of routes covering a range of flow ids
+ */
+  uint32_t GetNFlowRangeRoutes (void) const;
+
+/**
+ * \brief Remove the route a flow uses to reach a destination.
+ *
+ * The route removed is the one a lookup of the flow would select, without
+ * a requested output device, once all interfaces are up: routes parked on
+ * a down interface are candidates too.  A route of the flow itself is
+ * removed; a range route is split so that it no longer covers the flow.
+ * Either way only the routes of this table are touched, the forwarding
+ * table is not rebuilt.
+ *
+ * \param flowId flow id, not 0
+ * \param dest destination address
+ * \return true if a route was removed
+ */
+  bool RemoveFlowRoute (uint32_t flowId, Ipv4Address dest);
+
+/**
+ * \brief Preinstall a backup next hop for the route a flow uses to reach
+ * a destination.
+ *
+ * The protected route is the one RemoveFlowRoute would remove; a range
+ * route is split first, so that the backup only applies to this flow.
+ * Protected routes are not parked when their interface goes down: lookups
+ * that select one return its backup instead, as long as the interface of
+ * the backup is up, so a failure costs no index or FIB update.  A second
+ * call replaces the backup; removing the route removes its backup.
+ * Backups are not routes of the table: GetNRoutes, GetRoute and
+ * PrintRoutingTable leave them out, and SerializeRoutes does not write them.
+ *
+ * \param flowId flow id, not 0
+ * \param dest destination address
+ * \param nextHop next hop of the backup
+ * \param interface output interface index of the backup
+ * \return true if the flow has a route to dest, not weighted, to protect
+ */
+  bool AddBackupRouteTo (uint32_t flowId, Ipv4Address dest, Ipv4Address nextHop, uint32_t interface);
+
+/**
+ * \return number of routes protected by a backup next hop
+ */
+  uint32_t GetNBackupRoutes (void) const;
+
+/**
+ * \brief Add a weighted network route of a multipath group.
+ *
+ * The weighted routes of a flow with the same network, mask and metric form
+ * a multipath group.  A lookup that selects one of them forwards the packet
+ * over one route of the group, picked in proportion to the weights as set
+ * by the MultipathMode attribute.  Routes of the group whose interface is
+ * down are left out until it comes up again.
+ *
+ * \param flowId flow id
+ * \param network The Ipv4Address network for this route.
+ * \param networkMask The Ipv4Mask to extract the network.
+ * \param nextHop The next hop in the route to the destination network.
+ * \param interface The network interface index used to send packets to the
+ * destination.
+ * \param weight share of the traffic of the group sent over this route,
+ * must be positive
+ * \param metric Metric of route in case of multiple routes to same destination
+ */
+  void AddMultipathRouteTo (uint32_t flowId,
+                            Ipv4Address network,
+                            Ipv4Mask networkMask,
+                            Ipv4Address nextHop,
+                            uint32_t interface,
+                            uint32_t weight,
+                            uint32_t metric = 0);
+
+/**
+ * \brief Add a weighted host route of a multipath group.
+ *
+ * \param flowId flow id
+ * \param dest The Ipv4Address destination for this route.
+ * \param nextHop The Ipv4Address of the next hop in the route.
+ * \param interface The network interface index used to send packets to the
+ * destination.
+ * \param weight share of the traffic of the group sent over this route,
+ * must be positive
+ * \param metric Metric of route in case of multiple routes to same destination
+ *
+ * \see AddMultipathRouteTo
+ */
+  void AddMultipathHostRouteTo (uint32_t flowId,
+                                Ipv4Address dest,
+                                Ipv4Address nextHop,
+                                uint32_t interface,
+                                uint32_t weight,
+                                uint32_t metric = 0);
+
+/**
+ * \return number of multipath groups with at least one live route
+ */
+  uint32_t GetNMultipathGroups (void) const;
+
+/**
+ * \brief Add a label route to the label table.
+ *
+ * Packets arriving with the returned label in their FtLabelTag are sent
+ * through the interface to the gateway, with their label swapped to
+ * outLabel.  Labels are local to the node and allocated densely from 1, so
+ * a label lookup is a single array index.  Requires the LabelSwitching
+ * attribute.
+ *
+ * \param outLabel label of the next hop, 0 if the next hop is the last one
+ * \param gateway the next hop
+ * \param interface the output interface
+ * \return the incoming label of the route
+ */
+  uint32_t AddLabelRoute (uint32_t outLabel, Ipv4Address gateway, uint32_t interface);
+
+/**
+ * \brief Remove a label route; its label may be allocated again.
+ * \param inLabel the label returned by AddLabelRoute
+ * \return the outLabel of the route, so that a path can be removed hop by
+ * hop; 0 if there was no route for the label
+ */
+  uint32_t RemoveLabelRoute (uint32_t inLabel);
+
+/**
+ * \return number of label routes
+ */
+  uint32_t GetNLabelRoutes (void) const;
+
 /**
  * \brief Add a default route to the static routing table.
  *
@@ -218,6 +481,16 @@ public:
                         uint32_t interface,
                         uint32_t metric = 0);
 
+/**
+ * \brief Reserve storage for n more unicast routes.
+ *
+ * Used before installing many routes at once, e.g. by
+ * FtIpv4StaticRoutingHelper::AddFlowRoutes.
+ *
+ * \param n number of routes that will be added
+ */
+  void ReserveRoutes (uint32_t n);
+
 /**
  * \brief Get the number of individual unicast routes that have been added
  * to the routing table.
@@ -244,6 +517,9 @@ public:
  * Externally, the unicast static routing table appears simply as a table with
  * n entries.
  *
+ * A range route is one entry: its flow ids are GetFlowId () to
+ * GetLastFlowId () of the entry.
+ *
  * \param i The index (into the routing table) of the route to retrieve.
  * \return If route is set, a pointer to that Ipv4RoutingTableEntry is returned, otherwise
  * a zero pointer is returned.
@@ -268,6 +544,9 @@ public:
  * Externally, the unicast static routing table appears simply as a table with
  * n entries.
  *
+ * Removing a range route removes it for every flow it covers; use
+ * RemoveFlowRoute to take a single flow out of a range.
+ *
  * \param i The index (into the routing table) of the route to remove.
  *
  * \see Ipv4RoutingTableEntry
@@ -419,30 +698,616 @@ public:
  */
   void RemoveMulticastRoute (uint32_t index);
 
+/**
+ * \brief Compile the flow routes into a read-optimized forwarding table.
+ *
+ * Once frozen, flow lookups only use the compiled table (see FtIpv4FlowFib).
+ * Routes may still be added or removed afterwards; the flows they belong
+ * to are looked up through the per-flow index until enough flows changed
+ * for the next lookup to recompile the table.  Routes with flowId 0 are not affected,
+ * they are always matched with the prefix trie.
+ *
+ * Call it after all routes are installed, before Simulator::Run.
+ */
+  void Freeze (void);
+
+/**
+ * \return true if Freeze has been called
+ */
+  bool IsFrozen (void) const;
+
+/**
+ * \return the lookup counters since creation or the last ResetStatistics
+ */
+  const Statistics &GetStatistics (void) const;
+
+/**
+ * \brief Zero the lookup counters.
+ */
+  void ResetStatistics (void);
+
+/**
+ * \brief Bytes allocated by the unicast routes and their indexes.
+ *
+ * Container capacities are counted; hash tables are estimated from their
+ * size and bucket count.
+ *
+ * \return number of bytes
+ */
+  uint64_t GetUnicastMemoryUsage (void) const;
+
+/**
+ * \brief Bytes allocated by the multicast routes.
+ * \return number of bytes
+ */
+  uint64_t GetMulticastMemoryUsage (void) const;
+
+/**
+ * \brief Print the lookup counters and the memory usage.
+ * \param stream the ostream the statistics are printed to
+ */
+  void PrintStatistics (Ptr<OutputStreamWrapper> stream) const;
+
+/**
+ * \brief Write the static unicast routes to a binary stream.
+ *
+ * Connected routes are left out, the interfaces add them again.  The route
+ * count and the frozen state are followed by one column per route field
+ * (destination, mask, gateway, interface, flowId, flow span, metric,
+ * weight), each a
+ * packed array of host byte order 32 bit words.
+ *
+ * \param os the stream, opened in binary mode
+ */
+  void SerializeRoutes (std::ostream &os) const;
+
+/**
+ * \brief Add the routes written by SerializeRoutes.
+ *
+ * The columns are read in one block each and added in one pass to a table
+ * grown once to its final size, then indexed in bulk (each flow is sorted
+ * once); the table is frozen again if it was frozen when written.
+ *
+ * \param is the stream, opened in binary mode
+ * \return false if the stream is truncated or a route uses an interface
+ * the node does not have; no route is added then
+ */
+  bool DeserializeRoutes (std::istream &is);
+
 protected:
   virtual void DoDispose (void);
 
 private:
-  /// Container for the network routes
-  typedef std::list<std::pair <FtIpv4RoutingTableEntry *, uint32_t> > NetworkRoutes;
+  /// Container for the multicast routes, by slot (0 for a free slot)
+  typedef std::vector<FtIpv4MulticastRoutingTableEntry *> MulticastRoutes;
+
+  /// Const Iterator for container for the multicast routes
+  typedef std::vector<FtIpv4MulticastRoutingTableEntry *>::const_iterator MulticastRoutesCI;
+
+  /// Iterator for container for the multicast routes
+  typedef std::vector<FtIpv4MulticastRoutingTableEntry *>::iterator MulticastRoutesI;
 
-  /// Const Iterator for container for the network routes
-  typedef std::list<std::pair <FtIpv4RoutingTableEntry *, uint32_t> >::const_iterator NetworkRoutesCI;
+  /**
+   * \brief A multicast route as seen by the group index.
+   */
+  struct MulticastGroupRoute
+  {
+    FtIpv4MulticastRoutingTableEntry *entry;  //!< the route in m_multicastRoutes
+    uint32_t slot;                            //!< slot of the route in m_multicastRoutes
+    uint32_t inputInterface;                  //!< input interface of the route
+    Ptr<Ipv4MulticastRoute> route;            //!< route handed to the forwarding callback
+  };
 
-  /// Iterator for container for the network routes
-  typedef std::list<std::pair <FtIpv4RoutingTableEntry *, uint32_t> >::iterator NetworkRoutesI;
+  /// Multicast routes of every group address, in m_multicastOrder order
+  typedef std::unordered_map<uint32_t, std::vector<MulticastGroupRoute> > MulticastGroups;
 
-  /// Container for the multicast routes
-  typedef std::list<FtIpv4MulticastRoutingTableEntry *> MulticastRoutes;
+  /**
+   * \brief A route as seen by the per-flow index.
+   *
+   * The destination and mask are duplicated here so that a lookup does not
+   * need to dereference the routing table entry of every candidate.
+   */
+  struct FlowRouteCandidate
+  {
+    uint32_t slot;                  //!< slot of the route in m_networkRoutes
+    Ipv4Address network;            //!< destination network of the route
+    Ipv4Mask mask;                  //!< destination network mask of the route
+    uint16_t prefixLength;          //!< prefix length of the mask
+    uint32_t metric;                //!< metric of the route
+    uint64_t sequence;              //!< insertion order of the route
+  };
 
-  /// Const Iterator for container for the multicast routes
-  typedef std::list<FtIpv4MulticastRoutingTableEntry *>::const_iterator MulticastRoutesCI;
+  /// Candidates of a single flow id, ordered by lookup preference
+  typedef std::vector<FlowRouteCandidate> FlowRouteCandidates;
 
-  /// Iterator for container for the multicast routes
-  typedef std::list<FtIpv4MulticastRoutingTableEntry *>::iterator MulticastRoutesI;
+  /// Index from flow id to its candidate routes
+  typedef std::unordered_map<uint32_t, FlowRouteCandidates> FlowRouteIndex;
+
+  /**
+   * \brief A route covering a range of flow ids, as seen by the range index.
+   */
+  struct FlowRange
+  {
+    uint32_t first;                 //!< first flow id of the range
+    uint32_t last;                  //!< last flow id of the range
+    FlowRouteCandidate route;       //!< the route
+  };
+
+  /// Range routes by first flow id, then slot
+  typedef std::map<std::pair<uint32_t, uint32_t>, FlowRange> FlowRanges;
+
+  /**
+   * \brief Key of the route cache: the arguments of the flow lookup.
+   */
+  struct RouteCacheKey
+  {
+    uint32_t flowId;                //!< flow id of the packet
+    uint32_t dest;                  //!< destination address of the packet
+    const NetDevice *oif;           //!< requested output device, 0 if none
+
+    /**
+     * \param other key to compare with
+     * \return true if both keys are equal
+     */
+    bool operator== (const RouteCacheKey &other) const
+    {
+      return flowId == other.flowId && dest == other.dest && oif == other.oif;
+    }
+  };
+
+  /**
+   * \brief Hash of RouteCacheKey.
+   */
+  struct RouteCacheKeyHash
+  {
+    /**
+     * \param key the key to hash
+     * \return hash of the key
+     */
+    std::size_t operator() (const RouteCacheKey &key) const
+    {
+      uint64_t h = (static_cast<uint64_t> (key.flowId) << 32) ^ key.dest;
+      h ^= reinterpret_cast<std::size_t> (key.oif);
+      h *= 0x9e3779b97f4a7c15ULL;
+      return static_cast<std::size_t> (h ^ (h >> 32));
+    }
+  };
+
+  /**
+   * \brief Key of a multipath group.
+   */
+  struct MultipathKey
+  {
+    uint32_t flowId;                //!< flow id of the routes
+    uint32_t network;               //!< destination network of the routes
+    uint32_t mask;                  //!< destination network mask of the routes
+    uint32_t metric;                //!< metric of the routes
+
+    /**
+     * \param other key to compare with
+     * \return true if both keys are equal
+     */
+    bool operator== (const MultipathKey &other) const
+    {
+      return flowId == other.flowId && network == other.network
+             && mask == other.mask && metric == other.metric;
+    }
+  };
+
+  /**
+   * \brief Hash of MultipathKey.
+   */
+  struct MultipathKeyHash
+  {
+    /**
+     * \param key the key to hash
+     * \return hash of the key
+     */
+    std::size_t operator() (const MultipathKey &key) const
+    {
+      uint64_t h = (static_cast<uint64_t> (key.flowId) << 32) ^ key.network;
+      h ^= (static_cast<uint64_t> (key.mask) << 32) ^ key.metric;
+      h *= 0x9e3779b97f4a7c15ULL;
+      return static_cast<std::size_t> (h ^ (h >> 32));
+    }
+  };
+
+  /**
+   * \brief The live weighted routes sharing a MultipathKey.
+   */
+  struct MultipathGroup
+  {
+    std::vector<uint32_t> slots;          //!< slots of the routes in m_networkRoutes
+    std::vector<int64_t> current;         //!< smooth weighted round robin state of the routes
+    std::vector<Ptr<Ipv4Route> > routes;  //!< routes built for the slots, valid for generation
+    uint64_t totalWeight;                 //!< sum of the weights of the routes
+    uint64_t generation;                  //!< m_routeGeneration when routes were built
+  };
+
+  /// Multipath groups by key
+  typedef std::unordered_map<MultipathKey, MultipathGroup, MultipathKeyHash> MultipathGroups;
+
+  /**
+   * \brief Result of a flow lookup: a route, or the multipath group of the
+   * selected route.
+   */
+  struct CachedRoute
+  {
+    Ptr<Ipv4Route> route;           //!< the route, null if none or if group is set
+    MultipathGroup *group;          //!< multipath group of the selected route, if any
+    uint64_t generation;            //!< m_routeGeneration when the result was cached
+    bool backup;                    //!< the route is a backup taken by GetLiveRoute
+  };
+
+  /**
+   * \brief An entry of the label table.
+   */
+  struct LabelRoute
+  {
+    uint32_t outLabel;              //!< label swapped in
+    uint32_t interface;             //!< output interface, NO_ROUTE if the label is free
+    Ipv4Address gateway;            //!< next hop
+    Ptr<Ipv4Route> route;           //!< route built for the entry, valid for generation
+    uint64_t generation;            //!< m_routeGeneration when route was built
+  };
+
+  /**
+   * \brief A slot of the flowlet table.
+   */
+  struct FlowletEntry
+  {
+    uint32_t key;                   //!< flow hash of the flow owning the slot
+    uint32_t slot;                  //!< route of the flow, NO_ROUTE if the entry is free
+    int64_t lastSeen;               //!< time step of the last packet of the flow
+  };
+
+  /// Marks a free flowlet entry
+  static const uint32_t NO_ROUTE = 0xffffffff;
+
+  /// Result of previous flow lookups, including failed ones (null route)
+  typedef std::unordered_map<RouteCacheKey, CachedRoute, RouteCacheKeyHash> RouteCache;
+
+  /**
+   * \brief Add a multicast route to m_multicastGroups.
+   * \param slot slot of the route, already stored in m_multicastRoutes
+   */
+  void IndexMulticastRoute (uint32_t slot);
+
+  /**
+   * \brief Remove a multicast route from m_multicastGroups, m_multicastOrder
+   * and m_multicastRoutes, and delete it.
+   * \param slot slot of the route
+   */
+  void EraseMulticastRoute (uint32_t slot);
+
+  /**
+   * \brief Route of a packet carrying an FtSourceRouteTag.
+   * \param p the packet
+   * \param tag set to the tag of the packet, advanced past this hop when a
+   * route is returned; the caller puts it on the packet it forwards
+   * \return the route through the output interface of the next hop of the
+   * tag, or null if the packet has no tag, its next hop is not at this node
+   * or the interface is down
+   */
+  Ptr<Ipv4Route> LookupSourceRoute (Ptr<const Packet> p, FtSourceRouteTag &tag);
+
+  /**
+   * \brief Route of a packet carrying an FtLabelTag.
+   * \param p the packet
+   * \param tag set to the tag of the packet, with its label swapped to the
+   * label of the next hop when a route is returned; the caller puts it on
+   * the packet it forwards
+   * \return the route of the label, or null if the packet has no label,
+   * the label is not in the table or its interface is down
+   */
+  Ptr<Ipv4Route> LookupLabel (Ptr<const Packet> p, FtLabelTag &tag);
+
+  /**
+   * \brief Get the route to the link peer of an interface.
+   *
+   * The gateway is the address of the other end of a point to point
+   * channel, or 0.0.0.0 (on link) for other channels.
+   *
+   * \param interface the output interface
+   * \return the route, built on first use
+   */
+  Ptr<Ipv4Route> GetInterfaceRoute (uint32_t interface);
+
+  /**
+   * \brief Make all cached lookup results stale.
+   *
+   * Called whenever the routes, the interfaces or their addresses change,
+   * once per route for bulk changes: it only bumps m_routeGeneration, the
+   * stale entries are skipped on lookup and overwritten in place.
+   */
+  void InvalidateRouteCache (void);
+
+  /**
+   * \brief Compare two candidates the way the linear table scan would.
+   *
+   * Longer prefixes win.  Among host routes (/32) the first added wins, since
+   * the scan stops at the first host match; among shorter prefixes the lowest
+   * metric wins and, for equal metrics, the last added.
+   *
+   * \param a first candidate
+   * \param b second candidate
+   * \return true if a is chosen over b
+   */
+  static bool IsPreferred (const FlowRouteCandidate &a, const FlowRouteCandidate &b);
+
+  /**
+   * \param slot slot of a route
+   * \return the route as seen by the per-flow and range indexes
+   */
+  FlowRouteCandidate GetCandidate (uint32_t slot) const;
+
+  /**
+   * \brief Append a route to the table and to the per-flow index.
+   * \param flowId flow id of the route
+   * \param network destination network
+   * \param networkMask destination network mask
+   * \param gateway next hop, zero for direct routes
+   * \param interface output interface index
+   * \param metric metric of the route
+   * \param flags route flags (see FtIpv4RoutingTable::Flags)
+   * \param weight multipath weight, 0 for an ordinary route
+   * \param flowSpan the route covers flow ids flowId to flowId + flowSpan
+   * \return slot of the route
+   */
+  uint32_t InsertRoute (uint32_t flowId, Ipv4Address network, Ipv4Mask networkMask,
+                        Ipv4Address gateway, uint32_t interface, uint32_t metric,
+                        uint8_t flags = 0, uint32_t weight = 0, uint32_t flowSpan = 0);
+
+  /**
+   * \brief Add a route of m_networkRoutes to the per-flow or prefix index.
+   * \param slot slot of the route
+   */
+  void IndexRoute (uint32_t slot);
+
+  /**
+   * \brief Add many routes of m_networkRoutes to the indexes.
+   *
+   * Same result as IndexRoute on every slot, but the flow routes are
+   * appended to the candidates of their flow, and each flow touched is
+   * sorted once at the end.
+   *
+   * \param slots slots of the routes
+   */
+  void IndexRoutes (const std::vector<uint32_t> &slots);
+
+  /**
+   * \param slot slot of a weighted route
+   * \return key of the multipath group of the route
+   */
+  MultipathKey GetMultipathKey (uint32_t slot) const;
+
+  /**
+   * \brief Add a weighted route to its multipath group.
+   * \param slot slot of the route
+   */
+  void JoinMultipathGroup (uint32_t slot);
+
+  /**
+   * \brief Remove a weighted route from its multipath group.
+   * \param slot slot of the route
+   */
+  void LeaveMultipathGroup (uint32_t slot);
+
+  /**
+   * \brief Pick the route of a multipath group for a packet.
+   * \param group the multipath group
+   * \param flowHash hash of the packet's transport flow (MULTIPATH_HASH only)
+   * \return the route
+   */
+  Ptr<Ipv4Route> SelectMultipathRoute (MultipathGroup &group, uint32_t flowHash);
+
+  /**
+   * \brief Pick a route of a multipath group in proportion to the weights.
+   * \param group the multipath group
+   * \param flowHash hash of the packet's flow
+   * \return index of the route in the group
+   */
+  uint32_t PickByHash (const MultipathGroup &group, uint32_t flowHash) const;
+
+  /**
+   * \brief Pick a route of a multipath group with the flowlet table.
+   *
+   * A flow seen less than FlowletTimeout ago keeps its route.  Otherwise a
+   * new flowlet starts on the route with the least queued bytes per unit of
+   * weight; routes with equal load are chosen as by PickByHash.
+   *
+   * \param group the multipath group
+   * \param flowHash hash of the packet's flow
+   * \return index of the route in the group
+   */
+  uint32_t PickFlowlet (MultipathGroup &group, uint32_t flowHash);
+
+  /**
+   * \param interface interface index
+   * \return bytes in the transmit queue (TxQueue attribute) of the device
+   * of the interface, 0 if it has none
+   */
+  uint32_t GetInterfaceQueueBytes (uint32_t interface);
+
+  /**
+   * \brief Hash of the transport flow of a packet, for MULTIPATH_HASH.
+   *
+   * Covers the addresses, the protocol, the flowId and, for an unfragmented
+   * UDP or TCP packet that has its transport header, the ports.
+   *
+   * \param p the packet, without its IPv4 header
+   * \param header the IPv4 header of the packet
+   * \param flowId flow id of the packet
+   * \param withPorts true if p starts with the transport header
+   * \return the hash
+   */
+  uint32_t GetFlowHash (Ptr<const Packet> p, const Ipv4Header &header, uint32_t flowId,
+                        bool withPorts) const;
+
+  /**
+   * \param slot slot of a route
+   * \return a new Ipv4Route for the route
+   */
+  Ptr<Ipv4Route> BuildRoute (uint32_t slot) const;
+
+  /**
+   * \brief Longest prefix match over the routes with flowId 0.
+   * \param dest destination address
+   * \param oif output interface if any (put 0 otherwise)
+   * \param slot slot of the selected route, set only on success
+   * \param examined incremented by the number of trie nodes and routes examined
+   * \return true if a route was found
+   */
+  bool LookupPrefix (Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot, uint32_t &examined) const;
+
+  /**
+   * \brief Flow id of a packet received for forwarding.
+   *
+   * With FLOW_ID_DESTINATION_PORT the flowId is the destination port of an
+   * unfragmented UDP or TCP packet, read from the first bytes of the payload
+   * without searching the byte tags.
+   *
+   * \param p the packet, without its IPv4 header
+   * \param ipHeader the IPv4 header of the packet
+   * \return the flow id, 0 if the packet has none
+   */
+  uint32_t GetInputFlowId (Ptr<const Packet> p, const Ipv4Header &ipHeader) const;
+
+  /**
+   * \brief Rebuild m_fib from m_flowRoutes.
+   */
+  void CompileFib (void);
+
+  /**
+   * \brief Find the route a flow uses to reach a destination, its own or a
+   * range route, whatever the state of the interfaces: a route parked on a
+   * down interface is found if a lookup would select it once the interface
+   * is up.
+   * \param flowId flow id
+   * \param dest destination address
+   * \param slot slot of the route, set only on success
+   * \return true if a route was found
+   */
+  bool FindFlowRoute (uint32_t flowId, Ipv4Address dest, uint32_t &slot) const;
+
+  /**
+   * \brief Check whether a live range route covers a flow.
+   * \param flowId flow id
+   * \return true if a range route of m_flowRanges covers flowId
+   */
+  bool IsInFlowRange (uint32_t flowId) const;
+
+  /**
+   * \brief Take a flow out of a range route.
+   *
+   * The range route is replaced by the ranges before and after the flow,
+   * parked if the range route was.
+   *
+   * \param slot slot of the range route
+   * \param flowId flow id covered by the range
+   * \param keepFlow true to add a route of the flow alone in its place
+   * \return slot of the route of the flow, NO_ROUTE if keepFlow is false
+   */
+  uint32_t SplitFlowRange (uint32_t slot, uint32_t flowId, bool keepFlow);
+
+  /**
+   * \brief Drop the backup link of a route about to be removed.
+   *
+   * For a protected route, its backup is removed from the table; for a
+   * backup, the route it protects is left unprotected.
+   *
+   * \param slot slot of the route
+   */
+  void ReleaseBackup (uint32_t slot);
+
+  /**
+   * \param interface interface index
+   * \return true if the interface was reported down by NotifyInterfaceDown
+   */
+  bool IsInterfaceDown (uint32_t interface) const;
+
+  /**
+   * \brief Route to use in place of a route selected by a lookup.
+   * \param slot slot of the selected route
+   * \param oif output device requested by the lookup, if any; a backup is
+   * never used when it is set
+   * \return slot, the slot of its backup if the interface of the route is
+   * down, or NO_ROUTE if neither can be used
+   */
+  uint32_t GetLiveRoute (uint32_t slot, Ptr<NetDevice> oif);
+
+  /**
+   * \brief Note a change of the routes of a flow.
+   *
+   * Before Freeze, or once too many flows changed, m_fib is marked for a
+   * full recompilation; otherwise only the flow is marked stale.
+   *
+   * \param flowId flow id
+   */
+  void MarkFlowChanged (uint32_t flowId);
+
+  /**
+   * \brief Flow lookup through the compiled table, recompiling it first if
+   * the routes changed.
+   * \param flowId flow id
+   * \param dest destination address
+   * \param oif output interface if any (put 0 otherwise)
+   * \param slot slot of the selected route, set only on success
+   * \param examined incremented by the number of entries examined
+   * \return true if a route was found
+   */
+  bool LookupFib (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot,
+                  uint32_t &examined);
+
+  /**
+   * \brief Lookup through the range routes.
+   *
+   * The ranges are ordered by first flow id; the ranges covering a flow id
+   * are found by a binary search followed by a backwards scan that stops
+   * at the first range starting more than the largest span before the
+   * flow id.
+   *
+   * \param flowId flow id
+   * \param dest destination address
+   * \param oif output interface if any (put 0 otherwise)
+   * \param slot slot of the selected route, set only on success
+   * \param examined incremented by the number of ranges examined
+   * \return true if a route was found
+   */
+  bool LookupRange (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif, uint32_t &slot,
+                    uint32_t &examined) const;
+
+  /**
+   * \brief Account a unicast lookup in m_statistics and fire m_lookupTrace.
+   * \param flowId flow id of the lookup
+   * \param dest destination address
+   * \param examined number of entries examined
+   * \param found true if a route was found
+   */
+  void RecordLookup (uint32_t flowId, Ipv4Address dest, uint32_t examined, bool found);
+
+  /**
+   * \brief Remove a route from the per-flow index.
+   *
+   * The route itself stays in m_networkRoutes; callers remove it from there.
+   *
+   * \param slot slot of the route
+   */
+  void UnindexRoute (uint32_t slot);
+
+  /**
+   * \brief Remove a route, live or parked, from the table and from the
+   * per-flow index.
+   * \param slot slot of the route
+   */
+  void EraseRoute (uint32_t slot);
 
   /**
    * \brief Lookup in the forwarding table for destination.
+   *
+   * This is the linear scan of Ipv4StaticRouting over all routes, flow
+   * routes included; it is not used for forwarding.
+   *
    * \param dest destination address
    * \param oif output interface if any (put 0 otherwise)
    * \return Ipv4Route to route the packet to reach dest address
@@ -454,9 +1319,12 @@ private:
    * \param flow id
    * \param dest destination address
    * \param oif output interface if any (put 0 otherwise)
+   * \param flowHash hash of the packet's transport flow, used to pick the
+   * route of a multipath group in MULTIPATH_HASH mode
    * \return Ipv4Route to route the packet to reach dest address
    */
-  Ptr<Ipv4Route> LookupStatic (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif = 0);
+  Ptr<Ipv4Route> LookupStatic (uint32_t flowId, Ipv4Address dest, Ptr<NetDevice> oif = 0,
+                               uint32_t flowHash = 0);
 
   /**
    * \brief Lookup in the multicast forwarding table for destination.
@@ -471,13 +1339,197 @@ private:
   /**
    * \brief the forwarding table for network.
    */
-  NetworkRoutes m_networkRoutes;
+  FtIpv4RoutingTable m_networkRoutes;
+
+  /**
+   * \brief flow id index over the routes of m_networkRoutes with a
+   * non-zero flow id.
+   */
+  FlowRouteIndex m_flowRoutes;
+
+  /**
+   * \brief prefix index over the routes of m_networkRoutes with flow id 0.
+   */
+  FtIpv4PrefixTrie m_prefixRoutes;
+
+  /**
+   * \brief compiled form of m_flowRoutes, used by lookups once frozen.
+   */
+  FtIpv4FlowFib m_fib;
 
   /**
-   * \brief the forwarding table for multicast.
+   * \brief true once Freeze has been called.
+   */
+  bool m_frozen;
+
+  /**
+   * \brief true if m_flowRoutes changed since m_fib was compiled.
+   */
+  bool m_fibDirty;
+
+  /**
+   * \brief flows whose routes changed since m_fib was compiled while frozen;
+   * their lookups go through m_flowRoutes until the next compilation.
+   */
+  std::unordered_set<uint32_t> m_fibStaleFlows;
+
+  /**
+   * \brief routes covering a range of flow ids; a range is added and
+   * removed in O(log R), without re-sorting the others.
+   */
+  FlowRanges m_flowRanges;
+
+  /**
+   * \brief flow span of every range of m_flowRanges, bounding the scan of
+   * LookupRange.
+   */
+  std::multiset<uint32_t> m_flowRangeSpans;
+
+  /**
+   * \brief slot of the backup of every protected route, by route slot.
+   */
+  typedef std::unordered_map<uint32_t, uint32_t> BackupRoutes;
+
+  /**
+   * \brief backups added by AddBackupRouteTo.
+   */
+  BackupRoutes m_backupRoutes;
+
+  /**
+   * \brief slot of the protected route of every backup, by backup slot;
+   * the reverse of m_backupRoutes.
+   */
+  BackupRoutes m_protectedRoutes;
+
+  /**
+   * \brief non-zero for the interfaces reported down, by interface index.
+   */
+  std::vector<uint8_t> m_interfaceDown;
+
+  /**
+   * \brief number of interfaces reported down.
+   */
+  uint32_t m_nInterfacesDown;
+
+  /**
+   * \brief cached results of the flow lookup.
+   */
+  RouteCache m_routeCache;
+
+  /**
+   * \brief incremented whenever the cached routes become stale.
+   */
+  uint64_t m_routeGeneration;
+
+  /**
+   * \brief multipath groups of the weighted routes.
+   */
+  MultipathGroups m_multipathGroups;
+
+  /**
+   * \brief how packets are spread over a multipath group.
+   */
+  MultipathMode m_multipathMode;
+
+  /**
+   * \brief idle gap after which a flow may move to another route.
+   */
+  Time m_flowletTimeout;
+
+  /**
+   * \brief requested number of entries of m_flowlets.
+   */
+  uint32_t m_flowletTableSize;
+
+  /**
+   * \brief flowlet table, indexed by flow hash; allocated on first use
+   * with a power of two size.
+   */
+  std::vector<FlowletEntry> m_flowlets;
+
+  /**
+   * \brief transmit queue of the device of every interface, resolved on
+   * first use.
+   */
+  std::vector<Ptr<QueueBase> > m_interfaceQueues;
+
+  /**
+   * \brief per node salt of GetFlowHash, so that consecutive nodes do not
+   * make the same choices.
+   */
+  uint32_t m_hashSalt;
+
+  /**
+   * \brief maximum number of cached lookup results, 0 disables the cache.
+   */
+  uint32_t m_routeCacheSize;
+
+  /**
+   * \brief where RouteInput reads the flowId of the packets from.
+   */
+  FlowIdSource m_flowIdSource;
+
+  /**
+   * \brief true if packets with an FtSourceRouteTag follow their tag.
+   */
+  bool m_sourceRouting;
+
+  /**
+   * \brief routes of GetInterfaceRoute by interface, valid for
+   * m_interfaceRoutesGeneration.
+   */
+  std::vector<Ptr<Ipv4Route> > m_interfaceRoutes;
+
+  /**
+   * \brief m_routeGeneration when m_interfaceRoutes were built.
+   */
+  uint64_t m_interfaceRoutesGeneration;
+
+  /**
+   * \brief true if packets with an FtLabelTag are label switched.
+   */
+  bool m_labelSwitching;
+
+  /**
+   * \brief label table, indexed by incoming label; label 0 is never used.
+   */
+  std::vector<LabelRoute> m_labelRoutes;
+
+  /**
+   * \brief removed labels, allocated again before the table grows.
+   */
+  std::vector<uint32_t> m_freeLabels;
+
+  /**
+   * \brief lookup counters.
+   */
+  Statistics m_statistics;
+
+  /**
+   * \brief trace of every unicast lookup.
+   */
+  TracedCallback<uint32_t, Ipv4Address, uint32_t, bool> m_lookupTrace;
+
+  /**
+   * \brief the forwarding table for multicast, by slot.
    */
   MulticastRoutes m_multicastRoutes;
 
+  /**
+   * \brief free slots of m_multicastRoutes.
+   */
+  std::vector<uint32_t> m_freeMulticastSlots;
+
+  /**
+   * \brief slots of m_multicastRoutes in insertion order, for access by index.
+   */
+  FtIpv4RouteOrder m_multicastOrder;
+
+  /**
+   * \brief m_multicastRoutes indexed by group address.
+   */
+  MulticastGroups m_multicastGroups;
+
   /**
    * \brief Ipv4 reference.
    */
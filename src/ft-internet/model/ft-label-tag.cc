@@ -0,0 +1,76 @@
+/*
+ * This class is based on main-packet-tag.cc example with slight modifications:
+ * - a uint32_t packet tag holding the label of a label switched flow
+ * - added by FtOnOffApplication (Label attribute)
+ * - swapped at every hop by FtIpv4StaticRouting (LabelSwitching)
+ */
+
+#include "ns3/log.h"
+#include "ns3/tag.h"
+#include "ns3/uinteger.h"
+#include "ft-label-tag.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtLabelTag");
+
+NS_OBJECT_ENSURE_REGISTERED (FtLabelTag);
+
+TypeId 
+FtLabelTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FtLabelTag")
+    .SetParent<Tag> ()
+    .AddConstructor<FtLabelTag> ()
+    .AddAttribute ("Label",
+                   "The label of the next hop",
+                   EmptyAttributeValue (),
+                   MakeUintegerAccessor (&FtLabelTag::GetLabel),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+TypeId 
+FtLabelTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t 
+FtLabelTag::GetSerializedSize (void) const
+{
+  return 4;
+}
+
+void 
+FtLabelTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_label);
+}
+
+void 
+FtLabelTag::Deserialize (TagBuffer i)
+{
+  m_label = i.ReadU32 ();
+}
+
+void 
+FtLabelTag::Print (std::ostream &os) const
+{
+  os << "label=" << m_label;
+}
+
+void 
+FtLabelTag::SetLabel (uint32_t label)
+{
+  m_label = label;
+}
+
+uint32_t 
+FtLabelTag::GetLabel (void) const
+{
+  return m_label;
+}
+
+} // namespace ns3
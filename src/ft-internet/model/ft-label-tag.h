@@ -0,0 +1,35 @@
+/*
+ * This class is based on main-packet-tag.cc example with slight modifications:
+ * - a uint32_t packet tag holding the label of a label switched flow
+ * - added by FtOnOffApplication (Label attribute)
+ * - swapped at every hop by FtIpv4StaticRouting (LabelSwitching)
+ */
+
+#ifndef FT_LABEL_TAG
+#define FT_LABEL_TAG
+
+#include "ns3/tag.h"
+#include <iostream>
+
+namespace ns3 {
+
+class FtLabelTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  // label 0 is never assigned, it marks a packet past its last labelled hop
+  void SetLabel (uint32_t label);
+  uint32_t GetLabel (void) const;
+private:
+  uint32_t m_label;
+};
+
+} // namespace ns3
+
+#endif /* FT_LABEL_TAG */
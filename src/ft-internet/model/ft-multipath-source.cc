@@ -0,0 +1,442 @@
+/*
+ * Traffic source of a whole demand, an alternative to one FtOnOffApplication per path:
+ * - one socket and one event stream (CBR or Poisson) at the sum of the path rates
+ * - every packet is given to one path, chosen by weighted sampling or deficit round-robin
+ * - a path is a destination, a flow id and, as in FtOnOffApplication, a source route or label
+ * - bytes sent are counted per path
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/address.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/ft-tag.h"
+#include "ns3/ft-label-tag.h"
+#include "ft-multipath-source.h"
+#include "ft-hot-path-log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtMultiPathSource");
+
+NS_OBJECT_ENSURE_REGISTERED (FtMultiPathSource);
+
+TypeId
+FtMultiPathSource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FtMultiPathSource")
+    .SetParent<Application> ()
+    .SetGroupName("Applications")
+    .AddConstructor<FtMultiPathSource> ()
+    .AddAttribute ("PacketSize", "The size of packets sent",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&FtMultiPathSource::m_pktSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Protocol", "The type of protocol to use. This should be "
+                   "a subclass of ns3::SocketFactory",
+                   TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&FtMultiPathSource::m_tid),
+                   // This should check for SocketFactory as a parent
+                   MakeTypeIdChecker ())
+    .AddAttribute ("UsePoissonProcess", "Whether to use exponential random variable to schedule "
+                   "next packet send event, if false - schedule uniformly",
+                   BooleanValue (0),
+                   MakeBooleanAccessor (&FtMultiPathSource::m_usePoissonProcess),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PathSelection", "How the path of every packet is chosen, in proportion "
+                   "to the path rates",
+                   EnumValue (DEFICIT_ROUND_ROBIN),
+                   MakeEnumAccessor (&FtMultiPathSource::m_pathSelection),
+                   MakeEnumChecker (WEIGHTED_SAMPLING, "WeightedSampling",
+                                    DEFICIT_ROUND_ROBIN, "DeficitRoundRobin"))
+    .AddTraceSource ("Tx", "A new packet is created and is sent",
+                     MakeTraceSourceAccessor (&FtMultiPathSource::m_txTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+
+FtMultiPathSource::FtMultiPathSource ()
+  : m_socket (0),
+    m_residualBits (0),
+    m_lastStartTime (Seconds (0)),
+    m_sending (false),
+    m_expRandomVariableNextSend (CreateObject<ExponentialRandomVariable> ()),
+    m_pathRandomVariable (CreateObject<UniformRandomVariable> ()),
+    m_nextRateChange (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+FtMultiPathSource::~FtMultiPathSource ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+FtMultiPathSource::AddPath (const Address & remote, uint32_t flowId, DataRate rate)
+{
+  NS_LOG_FUNCTION (this << remote << flowId << rate);
+  Path path;
+  path.remote = remote;
+  path.flowId = flowId;
+  path.label = 0;
+  path.rate = rate;
+  path.credit = 0;
+  path.totBytes = 0;
+  BeginRateChange ();
+  m_paths.push_back (path);
+  EndRateChange ();
+  return m_paths.size () - 1;
+}
+
+uint32_t
+FtMultiPathSource::GetNPaths (void) const
+{
+  return m_paths.size ();
+}
+
+void
+FtMultiPathSource::SetPathSourceRoute (uint32_t path, const FtSourceRouteTag & route)
+{
+  NS_LOG_FUNCTION (this << path << route.GetNHops ());
+  NS_ASSERT_MSG (path < m_paths.size (), "FtMultiPathSource: no path " << path);
+  m_paths[path].sourceRoute = route;
+  m_paths[path].packetTemplate = 0;
+}
+
+void
+FtMultiPathSource::SetPathLabel (uint32_t path, uint32_t label)
+{
+  NS_LOG_FUNCTION (this << path << label);
+  NS_ASSERT_MSG (path < m_paths.size (), "FtMultiPathSource: no path " << path);
+  m_paths[path].label = label;
+  m_paths[path].packetTemplate = 0;
+}
+
+void
+FtMultiPathSource::SetPathRate (uint32_t path, DataRate rate)
+{
+  NS_LOG_FUNCTION (this << path << rate);
+  NS_ASSERT_MSG (path < m_paths.size (), "FtMultiPathSource: no path " << path);
+  BeginRateChange ();
+  m_paths[path].rate = rate;
+  EndRateChange ();
+}
+
+DataRate
+FtMultiPathSource::GetPathRate (uint32_t path) const
+{
+  NS_ASSERT_MSG (path < m_paths.size (), "FtMultiPathSource: no path " << path);
+  return m_paths[path].rate;
+}
+
+DataRate
+FtMultiPathSource::GetRate (void) const
+{
+  return m_rate;
+}
+
+/**
+ * \return true if change a is due before change b
+ */
+static bool
+IsRateChangeBefore (const FtMultiPathSource::RateChange &a, const FtMultiPathSource::RateChange &b)
+{
+  return a.time < b.time;
+}
+
+void
+FtMultiPathSource::SetRateSchedule (const std::vector<RateChange> & schedule)
+{
+  NS_LOG_FUNCTION (this << schedule.size ());
+  Simulator::Cancel (m_rateScheduleEvent);
+  m_rateSchedule = schedule;
+  std::stable_sort (m_rateSchedule.begin (), m_rateSchedule.end (), &IsRateChangeBefore);
+  m_nextRateChange = 0;
+  if (!m_rateSchedule.empty ())
+    {
+      Time delay = Max (m_rateSchedule[0].time - Simulator::Now (), Time (0));
+      m_rateScheduleEvent = Simulator::Schedule (delay, &FtMultiPathSource::ApplyRateSchedule, this);
+    }
+}
+
+void
+FtMultiPathSource::ApplyRateSchedule ()
+{
+  NS_LOG_FUNCTION (this);
+  // the changes due now are applied together, the packet is rescheduled once
+  Time now = Simulator::Now ();
+  BeginRateChange ();
+  while (m_nextRateChange < m_rateSchedule.size () && m_rateSchedule[m_nextRateChange].time <= now)
+    {
+      const RateChange &change = m_rateSchedule[m_nextRateChange++];
+      NS_ASSERT_MSG (change.path < m_paths.size (), "FtMultiPathSource: no path " << change.path);
+      m_paths[change.path].rate = change.rate;
+    }
+  EndRateChange ();
+  if (m_nextRateChange < m_rateSchedule.size ())
+    {
+      m_rateScheduleEvent = Simulator::Schedule (m_rateSchedule[m_nextRateChange].time - now,
+                                                 &FtMultiPathSource::ApplyRateSchedule, this);
+    }
+}
+
+uint64_t
+FtMultiPathSource::GetPathTotalSent (uint32_t path) const
+{
+  NS_ASSERT_MSG (path < m_paths.size (), "FtMultiPathSource: no path " << path);
+  return m_paths[path].totBytes;
+}
+
+uint64_t
+FtMultiPathSource::GetTotalSent (void) const
+{
+  uint64_t totBytes = 0;
+  for (uint32_t i = 0; i < m_paths.size (); i++)
+    {
+      totBytes += m_paths[i].totBytes;
+    }
+  return totBytes;
+}
+
+Ptr<Socket>
+FtMultiPathSource::GetSocket (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_socket;
+}
+
+int64_t
+FtMultiPathSource::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_expRandomVariableNextSend->SetStream (stream);
+  m_pathRandomVariable->SetStream (stream + 1);
+  return 2;
+}
+
+void
+FtMultiPathSource::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_sendEvent);
+  Simulator::Cancel (m_rateScheduleEvent);
+
+  m_socket = 0;
+  m_paths.clear ();
+  // chain up
+  Application::DoDispose ();
+}
+
+// Application Methods
+void FtMultiPathSource::StartApplication () // Called at time specified by Start
+{
+  NS_LOG_FUNCTION (this);
+
+  // Create the socket if not already
+  if (!m_socket)
+    {
+      m_socket = Socket::CreateSocket (GetNode (), m_tid);
+      // not connected, the packets of every path are sent to its own address
+      if (!m_paths.empty () && Inet6SocketAddress::IsMatchingType (m_paths[0].remote))
+        {
+          if (m_socket->Bind6 () == -1)
+            {
+              NS_FATAL_ERROR ("Failed to bind socket");
+            }
+        }
+      else if (m_socket->Bind () == -1)
+        {
+          NS_FATAL_ERROR ("Failed to bind socket");
+        }
+      m_socket->ShutdownRecv ();
+    }
+
+  Simulator::Cancel (m_sendEvent);
+  m_sending = true;
+  m_lastStartTime = Simulator::Now ();
+  ScheduleNextTx ();
+}
+
+void FtMultiPathSource::StopApplication () // Called at time specified by Stop
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_sendEvent.IsRunning ())
+    {
+      AccumulateResidualBits ();
+    }
+  m_sending = false;
+  Simulator::Cancel (m_sendEvent);
+  if (m_socket != 0)
+    {
+      m_socket->Close ();
+    }
+  else
+    {
+      NS_LOG_WARN ("FtMultiPathSource found null socket to close in StopApplication");
+    }
+}
+
+void FtMultiPathSource::BeginRateChange ()
+{
+  if (!m_sending)
+    {
+      return;
+    }
+  if (m_sendEvent.IsRunning ())
+    {
+      // bits generated at the old rate count towards the next packet
+      AccumulateResidualBits ();
+      Simulator::Cancel (m_sendEvent);
+    }
+  else
+    {
+      // paused at rate 0, no bits generated since
+      m_lastStartTime = Max (m_lastStartTime, Simulator::Now ());
+    }
+}
+
+void FtMultiPathSource::EndRateChange ()
+{
+  uint64_t rate = 0;
+  m_cumulativeRates.resize (m_paths.size ());
+  for (uint32_t i = 0; i < m_paths.size (); i++)
+    {
+      rate += m_paths[i].rate.GetBitRate ();
+      m_cumulativeRates[i] = rate;
+      // credits earned at the old shares would bias the first packets
+      m_paths[i].credit = 0;
+    }
+  m_rate = DataRate (rate);
+  if (m_sending)
+    {
+      ScheduleNextTx ();
+    }
+}
+
+void FtMultiPathSource::AccumulateResidualBits ()
+{
+  Time delta (Simulator::Now () - m_lastStartTime);
+  if (delta.IsStrictlyPositive ())
+    {
+      int64x64_t bits = delta.To (Time::S) * m_rate.GetBitRate ();
+      m_residualBits = std::min<uint64_t> (m_residualBits + bits.GetHigh (), m_pktSize * 8);
+      m_lastStartTime = Simulator::Now ();
+    }
+}
+
+void FtMultiPathSource::ScheduleNextTx ()
+{
+  FT_HOT_LOG_FUNCTION (this);
+
+  if (m_rate.GetBitRate () == 0)
+    {
+      // paused until a path gets a rate again
+      FT_HOT_LOG_LOGIC ("rate 0, no packet scheduled");
+      return;
+    }
+  uint32_t bits = m_pktSize * 8 - m_residualBits;
+  double mean = bits / static_cast<double>(m_rate.GetBitRate ());
+  if (m_usePoissonProcess)
+    {
+      mean = m_expRandomVariableNextSend->GetValue (mean, 0);
+    }
+  Time nextTime (Seconds (mean));
+  FT_HOT_LOG_LOGIC ("nextTime = " << nextTime);
+  m_sendEvent = Simulator::Schedule (nextTime, &FtMultiPathSource::SendPacket, this);
+}
+
+uint32_t FtMultiPathSource::SelectPath ()
+{
+  // called only with a non-zero aggregate rate, so some path has a rate
+  if (m_pathSelection == WEIGHTED_SAMPLING)
+    {
+      uint64_t point = m_pathRandomVariable->GetValue (0, m_rate.GetBitRate ());
+      // first path whose cumulative rate is above the point, paths with rate 0 have none
+      uint32_t i = std::upper_bound (m_cumulativeRates.begin (), m_cumulativeRates.end (), point)
+        - m_cumulativeRates.begin ();
+      return std::min<uint32_t> (i, m_paths.size () - 1);
+    }
+  uint32_t best = m_paths.size ();
+  for (uint32_t i = 0; i < m_paths.size (); i++)
+    {
+      uint64_t rate = m_paths[i].rate.GetBitRate ();
+      if (rate == 0)
+        {
+          continue;
+        }
+      m_paths[i].credit += rate;
+      if (best == m_paths.size () || m_paths[i].credit > m_paths[best].credit)
+        {
+          best = i;
+        }
+    }
+  m_paths[best].credit -= m_rate.GetBitRate ();
+  return best;
+}
+
+void FtMultiPathSource::BuildPacketTemplate (Path & path)
+{
+  NS_LOG_FUNCTION (this << path.flowId);
+  FtTag tag;
+  tag.SetSimpleValue (path.flowId);
+  path.packetTemplate = Create<Packet> (m_pktSize);
+  path.packetTemplate->AddByteTag (tag);
+  if (path.sourceRoute.GetNHops () > 0)
+    {
+      path.packetTemplate->AddPacketTag (path.sourceRoute);
+    }
+  if (path.label != 0)
+    {
+      FtLabelTag labelTag;
+      labelTag.SetLabel (path.label);
+      path.packetTemplate->AddPacketTag (labelTag);
+    }
+}
+
+void FtMultiPathSource::SendPacket ()
+{
+  FT_HOT_LOG_FUNCTION (this);
+
+  Path &path = m_paths[SelectPath ()];
+  // PacketSize is an attribute, it may be changed at any time
+  if (path.packetTemplate == 0 || path.packetTemplate->GetSize () != m_pktSize)
+    {
+      BuildPacketTemplate (path);
+    }
+  Ptr<Packet> packet = path.packetTemplate->Copy ();
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (packet);
+    }
+  m_socket->SendTo (packet, 0, path.remote);
+  path.totBytes += m_pktSize;
+  FT_HOT_LOG_INFO ("At time " << Simulator::Now ().GetSeconds ()
+                   << "s multi-path source sent " << packet->GetSize ()
+                   << " bytes of flow " << path.flowId
+                   << " total Tx " << path.totBytes << " bytes");
+  m_lastStartTime = Simulator::Now ();
+  m_residualBits = 0;
+  ScheduleNextTx ();
+}
+
+} // Namespace ns3
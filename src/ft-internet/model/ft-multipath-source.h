@@ -0,0 +1,256 @@
+/*
+ * Traffic source of a whole demand, an alternative to one FtOnOffApplication per path:
+ * - one socket and one event stream (CBR or Poisson) at the sum of the path rates
+ * - every packet is given to one path, chosen by weighted sampling or deficit round-robin
+ * - a path is a destination, a flow id and, as in FtOnOffApplication, a source route or label
+ * - bytes sent are counted per path
+ */
+
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef FT_MULTIPATH_SOURCE_H
+#define FT_MULTIPATH_SOURCE_H
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/data-rate.h"
+#include "ns3/traced-callback.h"
+#include "ns3/nstime.h"
+#include <vector>
+#include "ns3/ft-source-route-tag.h"
+
+namespace ns3 {
+
+class UniformRandomVariable;
+class ExponentialRandomVariable;
+class Socket;
+class Packet;
+
+/**
+ * \ingroup applications
+ *
+ * \brief Generate the traffic of one demand over several paths.
+ *
+ * Between Application::StartApplication and StopApplication the packets
+ * leave at the aggregate rate of the paths, one every PacketSize * 8 /
+ * rate seconds (CBR) or after an exponential time of that mean (Poisson).
+ * Each packet is then handed to one path, in proportion to the path rates:
+ *
+ * - WEIGHTED_SAMPLING draws the path at random.  The packets of a path
+ *   are then a thinning of the aggregate stream: Poisson with a Poisson
+ *   stream, as from one FtOnOffApplication per path.
+ * - DEFICIT_ROUND_ROBIN credits every path with its rate at each packet
+ *   and sends on the path with the largest credit, which pays the
+ *   aggregate rate (the smooth weighted round-robin form of DRR for equal
+ *   packets).  Over any window the packets of a path differ by at most
+ *   one from its share.
+ *
+ * The socket is not connected, every packet is sent to the address of
+ * its path (SendTo), tagged like those of FtOnOffApplication with the flow
+ * id of the path.  A path with rate 0 gets no packet; the source pauses
+ * while all paths have rate 0.
+ */
+class FtMultiPathSource : public Application
+{
+public:
+  /**
+   * \brief Path selection of the packets.
+   */
+  enum PathSelection
+  {
+    WEIGHTED_SAMPLING,   //!< path drawn with probability rate / aggregate rate
+    DEFICIT_ROUND_ROBIN  //!< path with the largest credit
+  };
+
+  /**
+   * \brief A rate change of one path, for SetRateSchedule.
+   */
+  struct RateChange
+  {
+    Time time;      //!< absolute simulation time of the change
+    uint32_t path;  //!< index of the path (AddPath)
+    DataRate rate;  //!< new rate of the path
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  FtMultiPathSource ();
+
+  virtual ~FtMultiPathSource ();
+
+  /**
+   * \brief Add a path; can be called while the source runs.
+   * \param remote the address the packets of the path are sent to
+   * \param flowId the flow id the packets of the path are tagged with
+   * \param rate the rate of the path
+   * \return the index of the path
+   */
+  uint32_t AddPath (const Address & remote, uint32_t flowId, DataRate rate);
+
+  /**
+   * \return the number of paths
+   */
+  uint32_t GetNPaths (void) const;
+
+  /**
+   * \brief Attach the given route to every packet of the path from now on
+   * (see FtOnOffApplication::SetSourceRoute); a route without hops stops it.
+   * \param path the index of the path
+   * \param route the route
+   */
+  void SetPathSourceRoute (uint32_t path, const FtSourceRouteTag & route);
+
+  /**
+   * \brief Set the label of the first hop of the path (see the Label
+   * attribute of FtOnOffApplication), 0 if its packets carry no label.
+   * \param path the index of the path
+   * \param label the label
+   */
+  void SetPathLabel (uint32_t path, uint32_t label);
+
+  /**
+   * \brief Change the rate of a path in place.  As with
+   * FtOnOffApplication::SetRate, the bits generated at the old aggregate
+   * rate since the last packet count towards the next one.
+   * \param path the index of the path
+   * \param rate the new rate of the path
+   */
+  void SetPathRate (uint32_t path, DataRate rate);
+
+  /**
+   * \param path the index of the path
+   * \return the rate of the path
+   */
+  DataRate GetPathRate (uint32_t path) const;
+
+  /**
+   * \return the sum of the path rates
+   */
+  DataRate GetRate (void) const;
+
+  /**
+   * \brief Change path rates at the given simulation times; only the next
+   * change is scheduled, as in FtOnOffApplication::SetRateSchedule.  The
+   * changes due at the same time are applied together.  Replaces any
+   * schedule set before.
+   * \param schedule the changes, in any order
+   */
+  void SetRateSchedule (const std::vector<RateChange> & schedule);
+
+  /**
+   * \param path the index of the path
+   * \return the bytes sent on the path so far
+   */
+  uint64_t GetPathTotalSent (uint32_t path) const;
+
+  /**
+   * \return the bytes sent on all paths so far
+   */
+  uint64_t GetTotalSent (void) const;
+
+  /**
+   * \brief Return a pointer to associated socket.
+   * \return pointer to associated socket
+   */
+  Ptr<Socket> GetSocket (void) const;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random variables
+   * used by this model.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+private:
+  // inherited from Application base class.
+  virtual void StartApplication (void);    // Called at time specified by Start
+  virtual void StopApplication (void);     // Called at time specified by Stop
+
+  /**
+   * \brief A path of the demand.
+   */
+  struct Path
+  {
+    Address remote;               //!< destination of the packets
+    uint32_t flowId;              //!< flow id tag of the packets
+    uint32_t label;               //!< label of the first hop, 0 if none
+    FtSourceRouteTag sourceRoute; //!< route of the packets, if it has hops
+    DataRate rate;                //!< share of the aggregate rate
+    int64_t credit;               //!< deficit round-robin credit, in bit/s
+    uint64_t totBytes;            //!< bytes sent so far
+    Ptr<Packet> packetTemplate;   //!< tagged packet copied for every packet sent
+  };
+
+  /**
+   * \brief Stop the pending packet before the path rates change, keeping
+   * the bits generated since the last packet
+   */
+  void BeginRateChange ();
+  /**
+   * \brief Update the aggregate rate and the selection state after the path
+   * rates changed, and schedule the next packet at the new rate
+   */
+  void EndRateChange ();
+  /**
+   * \brief Apply the changes of m_rateSchedule that are due and schedule the
+   * next one
+   */
+  void ApplyRateSchedule ();
+  /**
+   * \brief Add the bits generated at m_rate since m_lastStartTime to
+   * m_residualBits and move m_lastStartTime to now
+   */
+  void AccumulateResidualBits ();
+  /**
+   * \brief Schedule the next packet at the aggregate rate
+   */
+  void ScheduleNextTx ();
+  /**
+   * \brief Send a packet on the next selected path
+   */
+  void SendPacket ();
+  /**
+   * \return the index of the path of the next packet
+   */
+  uint32_t SelectPath ();
+  /**
+   * \brief Build the packet template of a path
+   * \param path the path
+   */
+  void BuildPacketTemplate (Path & path);
+
+  Ptr<Socket>     m_socket;       //!< Associated socket
+  TypeId          m_tid;          //!< Type of the socket used
+  uint32_t        m_pktSize;      //!< Size of packets
+  bool            m_usePoissonProcess; //!< Whether to use exp distr for next packet send time
+  PathSelection   m_pathSelection; //!< How the path of a packet is chosen
+  std::vector<Path> m_paths;      //!< Paths of the demand
+  std::vector<uint64_t> m_cumulativeRates; //!< Sum of the rates of paths 0..i, for WEIGHTED_SAMPLING
+  DataRate        m_rate;         //!< Sum of the path rates
+  uint32_t        m_residualBits; //!< Number of generated, but not sent, bits
+  Time            m_lastStartTime; //!< Time last packet sent
+  bool            m_sending;      //!< True between start and stop
+  EventId         m_sendEvent;    //!< Event id of pending "send packet" event
+  Ptr<ExponentialRandomVariable> m_expRandomVariableNextSend; //!< Random variable to generate next packet send
+  Ptr<UniformRandomVariable> m_pathRandomVariable; //!< Random variable of WEIGHTED_SAMPLING
+  std::vector<RateChange> m_rateSchedule; //!< Rate changes, sorted by time
+  uint32_t        m_nextRateChange; //!< Index of the next change in m_rateSchedule
+  EventId         m_rateScheduleEvent; //!< Event of the next rate change
+
+  /// Traced Callback: transmitted packets.
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* FT_MULTIPATH_SOURCE_H */
@@ -2,6 +2,14 @@
  * This class is based on ns3::OnOffApplication with slight modifications:
  * - storing additional parameter flowId as attribute
  * - all generated by this class packets have tag=flowId (in SendPacket)
+ * - packets can also carry the whole path of the flow (SetSourceRoute)
+ * - or the label of a label switched path (Label attribute)
+ * - per-packet logging can be compiled out (ft-hot-path-log.h)
+ * - departures can be drawn in trains of BurstSize packets, sent by one event per BurstWindow
+ * - packets are copies of a pre-tagged template, sharing its uid; trace addresses are
+ *   resolved at start
+ * - SetRate changes the data rate in place, keeping the generated bits; rate 0 pauses
+ * - SetRateSchedule applies a time series of rates, with one pending event at a time
  */
 
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
@@ -28,6 +36,7 @@
 // George F. Riley, Georgia Tech, Spring 2007
 // Adapted from ApplicationOnOff in GTNetS.
 
+#include <algorithm>
 #include "ns3/log.h"
 #include "ns3/address.h"
 #include "ns3/inet-socket-address.h"
@@ -45,10 +54,12 @@
 #include "ns3/trace-source-accessor.h"
 //#include "onoff-application.h"
 #include "ft-onoff-application.h"
+#include "ft-hot-path-log.h"
 #include "ns3/udp-socket-factory.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
 #include "ns3/ft-tag.h"
+#include "ns3/ft-label-tag.h"
 #include "ns3/boolean.h"
 
 namespace ns3 {
@@ -66,7 +77,8 @@ FtOnOffApplication::GetTypeId (void)
     .AddConstructor<FtOnOffApplication> ()
     .AddAttribute ("DataRate", "The data rate in on state.",
                    DataRateValue (DataRate ("500kb/s")),
-                   MakeDataRateAccessor (&FtOnOffApplication::m_cbrRate),
+                   MakeDataRateAccessor (&FtOnOffApplication::SetRate,
+                                         &FtOnOffApplication::GetRate),
                    MakeDataRateChecker ())
     .AddAttribute ("PacketSize", "The size of packets sent in on state",
                    UintegerValue (512),
@@ -97,21 +109,41 @@ FtOnOffApplication::GetTypeId (void)
                    MakeTypeIdAccessor (&FtOnOffApplication::m_tid),
                    // This should check for SocketFactory as a parent
                    MakeTypeIdChecker ())
-    .AddTraceSource ("Tx", "A new packet is created and is sent",
+    .AddTraceSource ("Tx", "A new packet is created and is sent; the packets of an "
+                     "application are copies of one template and share its uid",
                      MakeTraceSourceAccessor (&FtOnOffApplication::m_txTrace),
                      "ns3::Packet::TracedCallback")
-    .AddTraceSource ("TxWithAddresses", "A new packet is created and is sent",
+    .AddTraceSource ("TxWithAddresses", "A new packet is created and is sent; the packets of an "
+                     "application are copies of one template and share its uid",
                      MakeTraceSourceAccessor (&FtOnOffApplication::m_txTraceWithAddresses),
                      "ns3::Packet::TwoAddressTracedCallback")
     .AddAttribute ("FlowId", "Ft flow id",
                    UintegerValue (0),
                    MakeUintegerAccessor (&FtOnOffApplication::m_flowId),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Label", "Ft label of the first hop of a label switched path "
+                   "(FtIpv4StaticRoutingHelper::AddLabelPath), 0 if packets carry no label",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FtOnOffApplication::m_label),
+                   MakeUintegerChecker<uint32_t> ())
     .AddAttribute ("UsePoissonProcess", "Whether to use exponential random variable to schedule "
                    "next packet send event, if false - schedule uniformly (like in OnOffApplication)",
                    BooleanValue (0),
                    MakeBooleanAccessor (&FtOnOffApplication::m_usePoissonProcess),
                    MakeBooleanChecker ())
+    .AddAttribute ("BurstSize", "Number of departure times drawn at once; "
+                   "1 schedules one event per packet. The number of events drops by "
+                   "about BurstWindow / packet time, at most by BurstSize",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&FtOnOffApplication::m_burstSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BurstWindow", "With a BurstSize above 1, packets whose departure "
+                   "time is less than this window away are sent by the same event, so "
+                   "they leave up to this window early; 0 uses the transmission time of "
+                   "one packet at the current rate, which keeps one event per CBR packet",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&FtOnOffApplication::m_burstWindow),
+                   MakeTimeChecker ())
   ;
   return tid;
 }
@@ -123,7 +155,13 @@ FtOnOffApplication::FtOnOffApplication ()
     m_residualBits (0),
     m_lastStartTime (Seconds (0)),
     m_totBytes (0),
-    m_expRandomVariableNextSend (CreateObject<ExponentialRandomVariable> ())
+    m_expRandomVariableNextSend (CreateObject<ExponentialRandomVariable> ()),
+    m_nextDeparture (0),
+    m_templateFlowId (0),
+    m_templateLabel (0),
+    m_tracePeerValid (false),
+    m_sending (false),
+    m_nextRateChange (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -179,12 +217,99 @@ FtOnOffApplication::ScheduleStopAppOnTime(Time time)
   m_startStopEvent = Simulator::Schedule (time, &FtOnOffApplication::StopSending, this);
 }
 
+void
+FtOnOffApplication::SetSourceRoute(const FtSourceRouteTag & route)
+{
+  NS_LOG_FUNCTION (this << route.GetNHops ());
+  m_sourceRoute = route;
+  m_packetTemplate = 0;
+}
+
+void
+FtOnOffApplication::SetRate (DataRate rate)
+{
+  NS_LOG_FUNCTION (this << rate);
+  if (!m_sending)
+    {
+      m_cbrRate = rate;
+      return;
+    }
+  if (m_sendEvent.IsRunning ())
+    {
+      // bits generated at the old rate count towards the next packet
+      AccumulateResidualBits ();
+      Simulator::Cancel (m_sendEvent);
+    }
+  else
+    {
+      // paused at rate 0, no bits generated since
+      m_lastStartTime = Max (m_lastStartTime, Simulator::Now ());
+    }
+  // the rest of the train was drawn at the old rate
+  m_departures.clear ();
+  m_nextDeparture = 0;
+  m_cbrRate = rate;
+  ScheduleNextTx ();
+}
+
+DataRate
+FtOnOffApplication::GetRate (void) const
+{
+  return m_cbrRate;
+}
+
+/**
+ * \return true if change a is due before change b
+ */
+static bool
+IsRateChangeBefore (const std::pair<Time, DataRate> &a, const std::pair<Time, DataRate> &b)
+{
+  return a.first < b.first;
+}
+
+void
+FtOnOffApplication::SetRateSchedule(const std::vector<std::pair<Time, DataRate> > & schedule)
+{
+  NS_LOG_FUNCTION (this << schedule.size ());
+  Simulator::Cancel (m_rateScheduleEvent);
+  m_rateSchedule = schedule;
+  std::stable_sort (m_rateSchedule.begin (), m_rateSchedule.end (), &IsRateChangeBefore);
+  m_nextRateChange = 0;
+  if (!m_rateSchedule.empty ())
+    {
+      Time delay = Max (m_rateSchedule[0].first - Simulator::Now (), Time (0));
+      m_rateScheduleEvent = Simulator::Schedule (delay, &FtOnOffApplication::ApplyRateSchedule, this);
+    }
+}
+
+void
+FtOnOffApplication::ApplyRateSchedule ()
+{
+  NS_LOG_FUNCTION (this);
+  // changes at the same time are applied together, the last one wins
+  Time now = Simulator::Now ();
+  uint32_t last = m_nextRateChange;
+  while (m_nextRateChange < m_rateSchedule.size () && m_rateSchedule[m_nextRateChange].first <= now)
+    {
+      last = m_nextRateChange++;
+    }
+  SetRate (m_rateSchedule[last].second);
+  if (m_nextRateChange < m_rateSchedule.size ())
+    {
+      m_rateScheduleEvent = Simulator::Schedule (m_rateSchedule[m_nextRateChange].first - now,
+                                                 &FtOnOffApplication::ApplyRateSchedule, this);
+    }
+}
+
 void
 FtOnOffApplication::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
 
+  Simulator::Cancel (m_rateScheduleEvent);
+
   m_socket = 0;
+  m_packetTemplate = 0;
   // chain up
   Application::DoDispose ();
 }
@@ -221,7 +346,21 @@ void FtOnOffApplication::StartApplication () // Called at time specified by Star
         MakeCallback (&FtOnOffApplication::ConnectionSucceeded, this),
         MakeCallback (&FtOnOffApplication::ConnectionFailed, this));
     }
-  m_cbrRateFailSafe = m_cbrRate;
+  // addresses passed to TxWithAddresses, resolved once instead of per packet
+  m_socket->GetSockName (m_traceLocal);
+  m_tracePeerValid = true;
+  if (InetSocketAddress::IsMatchingType (m_peer))
+    {
+      m_tracePeer = InetSocketAddress::ConvertFrom (m_peer);
+    }
+  else if (Inet6SocketAddress::IsMatchingType (m_peer))
+    {
+      m_tracePeer = Inet6SocketAddress::ConvertFrom (m_peer);
+    }
+  else
+    {
+      m_tracePeerValid = false;
+    }
 
   // Insure no pending event
   CancelEvents ();
@@ -250,14 +389,15 @@ void FtOnOffApplication::CancelEvents ()
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_sendEvent.IsRunning () && m_cbrRateFailSafe == m_cbrRate )
+  if (m_sendEvent.IsRunning ())
     { // Cancel the pending send packet event
       // Calculate residual bits since last packet sent
-      Time delta (Simulator::Now () - m_lastStartTime);
-      int64x64_t bits = delta.To (Time::S) * m_cbrRate.GetBitRate ();
-      m_residualBits += bits.GetHigh ();
+      AccumulateResidualBits ();
     }
-  m_cbrRateFailSafe = m_cbrRate;
+  m_sending = false;
+  // the rest of the train is drawn again, from the residual bits, at the next start
+  m_departures.clear ();
+  m_nextDeparture = 0;
   Simulator::Cancel (m_sendEvent);
   Simulator::Cancel (m_startStopEvent);
 }
@@ -266,6 +406,7 @@ void FtOnOffApplication::CancelEvents ()
 void FtOnOffApplication::StartSending ()
 {
   NS_LOG_FUNCTION (this);
+  m_sending = true;
   m_lastStartTime = Simulator::Now ();
   ScheduleNextTx ();  // Schedule the send packet event
   ScheduleStopEvent ();
@@ -284,22 +425,39 @@ void FtOnOffApplication::StopSending ()
 // checking if nextTime is not zero (may be commented)
 void FtOnOffApplication::ScheduleNextTx ()
 {
-  NS_LOG_FUNCTION (this);
+  FT_HOT_LOG_FUNCTION (this);
 
   if (m_maxBytes == 0 || m_totBytes < m_maxBytes)
     {
+      if (m_cbrRate.GetBitRate () == 0)
+        {
+          // paused until SetRate gives a rate again
+          FT_HOT_LOG_LOGIC ("rate 0, no packet scheduled");
+          return;
+        }
+      if (m_burstSize > 1)
+        {
+          if (m_nextDeparture >= m_departures.size ())
+            {
+              FillDepartures ();
+            }
+          Time nextTime = Max (m_departures[m_nextDeparture] - Simulator::Now (), Time (0));
+          FT_HOT_LOG_LOGIC ("nextTime = " << nextTime);
+          m_sendEvent = Simulator::Schedule (nextTime, &FtOnOffApplication::SendBurst, this);
+          return;
+        }
       uint32_t bits = m_pktSize * 8 - m_residualBits;
-      NS_LOG_LOGIC ("bits = " << bits);
+      FT_HOT_LOG_LOGIC ("bits = " << bits);
       double mean = bits / static_cast<double>(m_cbrRate.GetBitRate ());
-      NS_LOG_LOGIC ("mean = " << mean);
-      NS_LOG_LOGIC ("residual = " << m_residualBits);
+      FT_HOT_LOG_LOGIC ("mean = " << mean);
+      FT_HOT_LOG_LOGIC ("residual = " << m_residualBits);
       if(m_usePoissonProcess)
         {
           mean = m_expRandomVariableNextSend->GetValue(mean, 0);
         }
       Time nextTime (Seconds (mean)); // Time till next packet
-      NS_LOG_LOGIC ("currentDatarate = " << m_cbrRate.GetBitRate ());
-      NS_LOG_LOGIC ("nextTime = " << nextTime);
+      FT_HOT_LOG_LOGIC ("currentDatarate = " << m_cbrRate.GetBitRate ());
+      FT_HOT_LOG_LOGIC ("nextTime = " << nextTime);
       //if(!nextTime.IsZero()){
         m_sendEvent = Simulator::Schedule (nextTime,
                                          &FtOnOffApplication::SendPacket, this);
@@ -311,6 +469,39 @@ void FtOnOffApplication::ScheduleNextTx ()
     }
 }
 
+void FtOnOffApplication::AccumulateResidualBits ()
+{
+  Time delta (Simulator::Now () - m_lastStartTime);
+  // packets of a train may have been sent ahead of now
+  if (delta.IsStrictlyPositive ())
+    {
+      int64x64_t bits = delta.To (Time::S) * m_cbrRate.GetBitRate ();
+      m_residualBits = std::min<uint64_t> (m_residualBits + bits.GetHigh (), m_pktSize * 8);
+      m_lastStartTime = Simulator::Now ();
+    }
+}
+
+void FtOnOffApplication::FillDepartures ()
+{
+  FT_HOT_LOG_FUNCTION (this);
+  m_departures.clear ();
+  m_nextDeparture = 0;
+  Time departure = m_lastStartTime;
+  double rate = static_cast<double> (m_cbrRate.GetBitRate ());
+  for (uint32_t i = 0; i < m_burstSize; i++)
+    {
+      // only the first packet after a start is shortened by the residual bits
+      uint32_t bits = m_pktSize * 8 - (i == 0 ? m_residualBits : 0);
+      double mean = bits / rate;
+      if (m_usePoissonProcess)
+        {
+          mean = m_expRandomVariableNextSend->GetValue (mean, 0);
+        }
+      departure += Seconds (mean);
+      m_departures.push_back (departure);
+    }
+}
+
 void FtOnOffApplication::ScheduleStartEvent ()
 {  // Schedules the event to start sending data (switch to the "On" state)
   NS_LOG_FUNCTION (this);
@@ -329,44 +520,104 @@ void FtOnOffApplication::ScheduleStopEvent ()
   m_startStopEvent = Simulator::Schedule (onInterval, &FtOnOffApplication::StopSending, this);
 }
 
-//change, adding tag
 void FtOnOffApplication::SendPacket ()
 {
-  NS_LOG_FUNCTION (this);
+  FT_HOT_LOG_FUNCTION (this);
 
   //NS_ASSERT (m_sendEvent.IsExpired ());
+  TransmitPacket ();
+  m_lastStartTime = Simulator::Now ();
+  m_residualBits = 0;
+  ScheduleNextTx ();
+}
+
+void FtOnOffApplication::SendBurst ()
+{
+  FT_HOT_LOG_FUNCTION (this);
+
+  Time window = m_burstWindow;
+  if (window.IsZero () && m_cbrRate.GetBitRate () > 0)
+    {
+      // one packet time: a packet never leaves before the previous one is on the wire
+      window = Seconds (m_pktSize * 8 / static_cast<double> (m_cbrRate.GetBitRate ()));
+    }
+  // exclusive: with a window of one packet time, the next CBR departure
+  // lies exactly on the horizon and keeps its own event
+  Time horizon = Simulator::Now () + window;
+  while (m_nextDeparture < m_departures.size () && m_departures[m_nextDeparture] < horizon
+         && (m_maxBytes == 0 || m_totBytes < m_maxBytes))
+    {
+      TransmitPacket ();
+      // the next departures follow the departure time of this packet, not now
+      m_lastStartTime = m_departures[m_nextDeparture++];
+      m_residualBits = 0;
+    }
+  ScheduleNextTx ();
+}
+
+//change, adding tag
+void FtOnOffApplication::BuildPacketTemplate ()
+{
+  NS_LOG_FUNCTION (this);
   FtTag tag;
   tag.SetSimpleValue(m_flowId);
-  Ptr<Packet> packet = Create<Packet> (m_pktSize);
-  packet->AddByteTag(tag);
-  m_txTrace (packet);
+  m_packetTemplate = Create<Packet> (m_pktSize);
+  m_packetTemplate->AddByteTag(tag);
+  if (m_sourceRoute.GetNHops () > 0)
+    {
+      m_packetTemplate->AddPacketTag (m_sourceRoute);
+    }
+  if (m_label != 0)
+    {
+      FtLabelTag labelTag;
+      labelTag.SetLabel (m_label);
+      m_packetTemplate->AddPacketTag (labelTag);
+    }
+  m_templateFlowId = m_flowId;
+  m_templateLabel = m_label;
+}
+
+void FtOnOffApplication::TransmitPacket ()
+{
+  // FlowId, Label and PacketSize are attributes, they may be changed at any time
+  if (m_packetTemplate == 0 || m_templateFlowId != m_flowId || m_templateLabel != m_label
+      || m_packetTemplate->GetSize () != m_pktSize)
+    {
+      BuildPacketTemplate ();
+    }
+  // The copy shares the buffer and the tags of the template until the
+  // stack writes to it (it also keeps the uid of the template)
+  Ptr<Packet> packet = m_packetTemplate->Copy ();
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (packet);
+    }
   m_socket->Send (packet);
   m_totBytes += m_pktSize;
-  Address localAddress;
-  m_socket->GetSockName (localAddress);
+#ifndef FT_INTERNET_NO_HOT_PATH_LOG
   if (InetSocketAddress::IsMatchingType (m_peer))
     {
-      NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds ()
-                   << "s on-off application sent "
-                   <<  packet->GetSize () << " bytes to "
-                   << InetSocketAddress::ConvertFrom(m_peer).GetIpv4 ()
-                   << " port " << InetSocketAddress::ConvertFrom (m_peer).GetPort ()
-                   << " total Tx " << m_totBytes << " bytes");
-      m_txTraceWithAddresses (packet, localAddress, InetSocketAddress::ConvertFrom (m_peer));
+      FT_HOT_LOG_INFO ("At time " << Simulator::Now ().GetSeconds ()
+                       << "s on-off application sent "
+                       <<  packet->GetSize () << " bytes to "
+                       << InetSocketAddress::ConvertFrom(m_peer).GetIpv4 ()
+                       << " port " << InetSocketAddress::ConvertFrom (m_peer).GetPort ()
+                       << " total Tx " << m_totBytes << " bytes");
     }
   else if (Inet6SocketAddress::IsMatchingType (m_peer))
     {
-      NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds ()
-                   << "s on-off application sent "
-                   <<  packet->GetSize () << " bytes to "
-                   << Inet6SocketAddress::ConvertFrom(m_peer).GetIpv6 ()
-                   << " port " << Inet6SocketAddress::ConvertFrom (m_peer).GetPort ()
-                   << " total Tx " << m_totBytes << " bytes");
-      m_txTraceWithAddresses (packet, localAddress, Inet6SocketAddress::ConvertFrom(m_peer));
+      FT_HOT_LOG_INFO ("At time " << Simulator::Now ().GetSeconds ()
+                       << "s on-off application sent "
+                       <<  packet->GetSize () << " bytes to "
+                       << Inet6SocketAddress::ConvertFrom(m_peer).GetIpv6 ()
+                       << " port " << Inet6SocketAddress::ConvertFrom (m_peer).GetPort ()
+                       << " total Tx " << m_totBytes << " bytes");
+    }
+#endif /* FT_INTERNET_NO_HOT_PATH_LOG */
+  if (m_tracePeerValid && !m_txTraceWithAddresses.IsEmpty ())
+    {
+      m_txTraceWithAddresses (packet, m_traceLocal, m_tracePeer);
     }
-  m_lastStartTime = Simulator::Now ();
-  m_residualBits = 0;
-  ScheduleNextTx ();
 }
 
 
@@ -2,6 +2,14 @@
  * This class is based on ns3::OnOffApplication with slight modifications:
  * - storing additional parameter flowId as attribute
  * - all generated by this class packets have tag=flowId (in SendPacket)
+ * - packets can also carry the whole path of the flow (SetSourceRoute)
+ * - or the label of a label switched path (Label attribute)
+ * - per-packet logging can be compiled out (ft-hot-path-log.h)
+ * - departures can be drawn in trains of BurstSize packets, sent by one event per BurstWindow
+ * - packets are copies of a pre-tagged template, sharing its uid; trace addresses are
+ *   resolved at start
+ * - SetRate changes the data rate in place, keeping the generated bits; rate 0 pauses
+ * - SetRateSchedule applies a time series of rates, with one pending event at a time
  */
 
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
@@ -37,12 +45,17 @@
 #include "ns3/ptr.h"
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
+#include "ns3/nstime.h"
+#include <vector>
+#include <utility>
+#include "ns3/ft-source-route-tag.h"
 
 namespace ns3 {
 
 class Address;
 class RandomVariableStream;
 class Socket;
+class Packet;
 
 /**
  * \ingroup applications 
@@ -88,6 +101,28 @@ class Socket;
 *
 * If the underlying socket type supports broadcast, this application
 * will automatically enable the SetAllowBroadcast(true) socket option.
+*
+* With a BurstSize above 1, the departure times of the next BurstSize
+* packets (CBR or Poisson) are drawn at once, each following the previous
+* one as in the packet by packet mode.  One event then sends every packet
+* whose departure time is less than BurstWindow after it, so a packet may
+* leave up to BurstWindow early and the packets of an event leave back to
+* back: the average rate is kept, the spacing of the packets is not.  ns-3
+* sockets have no timed send, so this is the price of the fewer events.
+*
+* The number of events is divided by about BurstWindow / packet time, and
+* by BurstSize at most: BurstSize alone saves nothing.  The default
+* window, one packet time at the current rate, keeps one event per CBR
+* packet, sent at its own departure time, and only groups Poisson packets
+* closer than a packet time; a window of several packet times trades more
+* of the spacing for fewer events.
+*
+* The packets sent are copies of a template packet built with the FlowId
+* tag (and the source route or label), so a send allocates no new buffer.
+* A copy keeps the uid of its original: every packet of an application
+* has the same Packet::GetUid () until the template is built again (when
+* FlowId, Label or PacketSize change).  Trace sinks of the Tx traces, or
+* any other code, cannot tell the packets of one application apart by uid.
 */
 class FtOnOffApplication : public Application
 {
@@ -144,6 +179,38 @@ public:
   */
   void ScheduleStopAppOnTime(Time time);
 
+  /**
+   * ft method, attach the given route to every packet sent from now on,
+   * so that routers with SourceRouting forward it without a lookup;
+   * a route without hops stops it
+   */
+  void SetSourceRoute(const FtSourceRouteTag & route);
+
+  /**
+   * ft method, change the data rate in place (also used by the DataRate attribute);
+   * in an On period the pending packet is rescheduled: the bits generated at the
+   * old rate since the last packet count towards the next one, which leaves once
+   * the rest is generated at the new rate.  A rate of 0 pauses the sending until
+   * a non-zero rate is set, keeping the generated bits.
+   * \param rate the new data rate
+   */
+  void SetRate(DataRate rate);
+
+  /**
+   * ft method, get the current data rate
+   * \return the data rate in on state
+   */
+  DataRate GetRate(void) const;
+
+  /**
+   * ft method, change the data rate at the given simulation times (SetRate);
+   * only the next change is scheduled, the following one is scheduled when it
+   * is applied.  The changes are sorted by time (stable), a change in the past
+   * is applied at once.  Replaces any schedule set before.
+   * \param schedule (absolute time, rate) pairs
+   */
+  void SetRateSchedule(const std::vector<std::pair<Time, DataRate> > & schedule);
+
 protected:
   virtual void DoDispose (void);
 private:
@@ -170,6 +237,35 @@ private:
    * \brief Send a packet
    */
   void SendPacket ();
+  /**
+   * \brief Send the packets of the train whose departure time is within
+   * m_burstWindow
+   */
+  void SendBurst ();
+  /**
+   * \brief Create a packet and hand it to the socket
+   */
+  void TransmitPacket ();
+  /**
+   * \brief Build m_packetTemplate from the current flow id, source route,
+   * label and packet size
+   */
+  void BuildPacketTemplate ();
+  /**
+   * \brief Apply the rate changes of m_rateSchedule that are due and
+   * schedule the next one
+   */
+  void ApplyRateSchedule ();
+  /**
+   * \brief Add the bits generated at m_cbrRate since m_lastStartTime to
+   * m_residualBits and move m_lastStartTime to now
+   */
+  void AccumulateResidualBits ();
+  /**
+   * \brief Draw the departure times of the next train of m_burstSize
+   * packets, following m_lastStartTime
+   */
+  void FillDepartures ();
 
   Ptr<Socket>     m_socket;       //!< Associated socket
   Address         m_peer;         //!< Peer address
@@ -177,7 +273,6 @@ private:
   Ptr<RandomVariableStream>  m_onTime;       //!< rng for On Time
   Ptr<RandomVariableStream>  m_offTime;      //!< rng for Off Time
   DataRate        m_cbrRate;      //!< Rate that data is generated
-  DataRate        m_cbrRateFailSafe;      //!< Rate that data is generated (check copy)
   uint32_t        m_pktSize;      //!< Size of packets
   uint32_t        m_residualBits; //!< Number of generated, but not sent, bits
   Time            m_lastStartTime; //!< Time last packet sent
@@ -188,10 +283,26 @@ private:
   TypeId          m_tid;          //!< Type of the socket used
 
   uint32_t        m_flowId;       //!< FT flow id
+  FtSourceRouteTag m_sourceRoute; //!< FT path of the packets, if it has hops
+  uint32_t        m_label;        //!< FT label of the first hop, 0 if none
   bool            m_usePoissonProcess; //!< Whether to use exp distr for next packet send time
   Ptr<ExponentialRandomVariable> m_expRandomVariableNextSend; //!< Random variable to generate next packet send
+  uint32_t        m_burstSize;    //!< FT number of departures drawn at once, 1 for one event per packet
+  Time            m_burstWindow;  //!< FT packets of a train sent by the same event, 0 for one packet time
+  std::vector<Time> m_departures; //!< FT departure times of the current train
+  uint32_t        m_nextDeparture; //!< FT index of the next packet of the train in m_departures
+  Ptr<Packet>     m_packetTemplate; //!< FT tagged packet copied for every packet sent
+  uint32_t        m_templateFlowId; //!< FT flow id m_packetTemplate was built with
+  uint32_t        m_templateLabel; //!< FT label m_packetTemplate was built with
+  Address         m_traceLocal;   //!< FT local address passed to m_txTraceWithAddresses
+  Address         m_tracePeer;    //!< FT peer address passed to m_txTraceWithAddresses
+  bool            m_tracePeerValid; //!< FT true if m_peer is an IPv4 or IPv6 socket address
+  bool            m_sending;      //!< FT true in an On period
+  std::vector<std::pair<Time, DataRate> > m_rateSchedule; //!< FT rate changes, sorted by time
+  uint32_t        m_nextRateChange; //!< FT index of the next change in m_rateSchedule
+  EventId         m_rateScheduleEvent; //!< FT event of the next rate change
 
-  /// Traced Callback: transmitted packets.
+  /// Traced Callback: transmitted packets, which share the uid of the template.
   TracedCallback<Ptr<const Packet> > m_txTrace;
 
   /// Callbacks for tracing the packet Tx events, includes source and destination addresses
@@ -0,0 +1,126 @@
+/*
+ * This class is based on main-packet-tag.cc example with slight modifications:
+ * - a packet tag carrying the whole path of a packet, as (node id, output interface) hops
+ *   in a fixed size array, with the index of the next hop
+ * - added by FtOnOffApplication when it has a source route (SetSourceRoute)
+ * - used in FtIpv4StaticRouting to forward without a table lookup (SourceRouting),
+ *   which advances the hop index at every hop
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/tag.h"
+#include "ft-source-route-tag.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtSourceRouteTag");
+
+NS_OBJECT_ENSURE_REGISTERED (FtSourceRouteTag);
+
+FtSourceRouteTag::FtSourceRouteTag ()
+  : m_nHops (0),
+    m_hopIndex (0)
+{
+}
+
+TypeId 
+FtSourceRouteTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FtSourceRouteTag")
+    .SetParent<Tag> ()
+    .AddConstructor<FtSourceRouteTag> ()
+  ;
+  return tid;
+}
+
+TypeId 
+FtSourceRouteTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t 
+FtSourceRouteTag::GetSerializedSize (void) const
+{
+  // hop count and hop index, then a 4 byte node id and a 1 byte interface per hop
+  return 2 + m_nHops * 5;
+}
+
+void 
+FtSourceRouteTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_nHops);
+  i.WriteU8 (m_hopIndex);
+  for (uint32_t hop = 0; hop < m_nHops; hop++)
+    {
+      i.WriteU32 (m_nodes[hop]);
+      i.WriteU8 (m_interfaces[hop]);
+    }
+}
+
+void 
+FtSourceRouteTag::Deserialize (TagBuffer i)
+{
+  m_nHops = i.ReadU8 ();
+  m_hopIndex = i.ReadU8 ();
+  NS_ASSERT (m_nHops <= MAX_HOPS && m_hopIndex <= m_nHops);
+  for (uint32_t hop = 0; hop < m_nHops; hop++)
+    {
+      m_nodes[hop] = i.ReadU32 ();
+      m_interfaces[hop] = i.ReadU8 ();
+    }
+}
+
+void 
+FtSourceRouteTag::Print (std::ostream &os) const
+{
+  os << "hops=";
+  for (uint32_t hop = 0; hop < m_nHops; hop++)
+    {
+      os << (hop ? "," : "") << (hop == m_hopIndex ? "*" : "")
+         << m_nodes[hop] << ":" << (uint32_t)m_interfaces[hop];
+    }
+}
+
+void 
+FtSourceRouteTag::AddHop (uint32_t nodeId, uint32_t interface)
+{
+  NS_ASSERT_MSG (m_nHops < MAX_HOPS, "FtSourceRouteTag::AddHop (): too many hops");
+  NS_ASSERT_MSG (interface <= MAX_INTERFACE, "FtSourceRouteTag::AddHop (): interface out of range");
+  m_nodes[m_nHops] = nodeId;
+  m_interfaces[m_nHops] = static_cast<uint8_t> (interface);
+  m_nHops++;
+}
+
+uint32_t 
+FtSourceRouteTag::GetNHops (void) const
+{
+  return m_nHops;
+}
+
+uint32_t 
+FtSourceRouteTag::GetHopIndex (void) const
+{
+  return m_hopIndex;
+}
+
+bool 
+FtSourceRouteTag::GetOutputInterface (uint32_t nodeId, uint32_t &interface) const
+{
+  if (m_hopIndex >= m_nHops || m_nodes[m_hopIndex] != nodeId)
+    {
+      return false;
+    }
+  interface = m_interfaces[m_hopIndex];
+  return true;
+}
+
+void 
+FtSourceRouteTag::Advance (void)
+{
+  NS_ASSERT_MSG (m_hopIndex < m_nHops, "FtSourceRouteTag::Advance (): route is done");
+  m_hopIndex++;
+}
+
+} // namespace ns3
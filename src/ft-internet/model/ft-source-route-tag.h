@@ -0,0 +1,79 @@
+/*
+ * This class is based on main-packet-tag.cc example with slight modifications:
+ * - a packet tag carrying the whole path of a packet, as (node id, output interface) hops
+ *   in a fixed size array, with the index of the next hop
+ * - added by FtOnOffApplication when it has a source route (SetSourceRoute)
+ * - used in FtIpv4StaticRouting to forward without a table lookup (SourceRouting),
+ *   which advances the hop index at every hop
+ */
+
+#ifndef FT_SOURCE_ROUTE_TAG
+#define FT_SOURCE_ROUTE_TAG
+
+#include "ns3/tag.h"
+#include <iostream>
+
+namespace ns3 {
+
+class FtSourceRouteTag : public Tag
+{
+public:
+  /// Largest number of hops of a route
+  static const uint32_t MAX_HOPS = 64;
+  /// Largest output interface of a hop
+  static const uint32_t MAX_INTERFACE = 255;
+
+  FtSourceRouteTag ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \brief Append a hop to the route.
+   * \param nodeId the node forwarding the packet
+   * \param interface the output interface of that node
+   */
+  void AddHop (uint32_t nodeId, uint32_t interface);
+
+  /**
+   * \return the number of hops of the route
+   */
+  uint32_t GetNHops (void) const;
+
+  /**
+   * \return the index of the next hop, GetNHops () once the route is done
+   */
+  uint32_t GetHopIndex (void) const;
+
+  /**
+   * \brief Output interface of the next hop, if the next hop is at a node.
+   *
+   * Only the hop at the hop index is read, the route is not searched; the
+   * node id guards against a packet that left its route.
+   *
+   * \param nodeId the node
+   * \param interface set to the output interface of the next hop
+   * \return false if the route is done or its next hop is at another node
+   */
+  bool GetOutputInterface (uint32_t nodeId, uint32_t &interface) const;
+
+  /**
+   * \brief Move the hop index to the following hop; the router replaces
+   * the tag of the packet it forwards with the advanced one.
+   */
+  void Advance (void);
+
+private:
+  uint8_t m_nHops;                       //!< number of hops
+  uint8_t m_hopIndex;                    //!< index of the next hop
+  uint32_t m_nodes[MAX_HOPS];            //!< node of every hop
+  uint8_t m_interfaces[MAX_HOPS];        //!< output interface of every hop
+};
+
+} // namespace ns3
+
+#endif /* FT_SOURCE_ROUTE_TAG */
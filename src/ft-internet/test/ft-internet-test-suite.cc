@@ -1,49 +1,1355 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
-// Include a header file from your module to test.
-//#include "ns3/ft-internet.h"
+// The lookup structures of FtIpv4StaticRouting against the linear table
+// scan of the original LookupStatic (flowId, dest, oif), and its route
+// changes against a reference table.
 
-// An essential include is test.h
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 #include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/packet.h"
+#include "ns3/node-container.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/socket.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/data-rate.h"
+#include "ns3/ft-tag.h"
+#include "ns3/ft-source-route-tag.h"
+#include "ns3/ft-label-tag.h"
+#include "ns3/ft-ipv4-prefix-trie.h"
+#include "ns3/ft-ipv4-routing-table.h"
+#include "ns3/ft-ipv4-static-routing.h"
+#include "ns3/ft-ipv4-static-routing-helper.h"
+#include "ns3/ft-onoff-application.h"
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
-// This is an example TestCase.
-class FtInternetTestCase1 : public TestCase
+// A route of the reference table; the table is kept in insertion order
+struct ReferenceRoute
+{
+  uint32_t id;                      // slot in the trie, gateway on a node
+  uint32_t firstFlowId;             // flow id, 0 for the routes without flowId
+  uint32_t lastFlowId;              // last flow id of a range route
+  bool range;                       // added by AddFlowRangeRouteTo
+  Ipv4Address network;
+  Ipv4Mask mask;
+  uint32_t interface;
+  uint32_t metric;
+};
+
+// Masks of the random routes: prefixes from /0 to /32, host routes twice as
+// likely, and masks that are not prefixes.  Ipv4Mask::GetPrefixLength of a
+// mask with its lowest bit set is 32, so some of those compete with the
+// host routes.
+static const char *g_masks[] = {
+  "0.0.0.0", "255.0.0.0", "255.255.0.0", "255.255.255.0", "255.255.255.252",
+  "255.255.255.254", "255.255.255.255", "255.255.255.255",
+  "255.255.0.255", "255.255.0.3", "255.255.252.1", "255.0.255.255"
+};
+
+// Destinations of the random routes and of the lookups
+static Ipv4Address
+RandomDestination (Ptr<UniformRandomVariable> random)
+{
+  return Ipv4Address (0xac100000 | (random->GetInteger (0, 3) << 8) | random->GetInteger (0, 7));
+}
+
+static ReferenceRoute
+RandomRoute (Ptr<UniformRandomVariable> random, uint32_t id, uint32_t nInterfaces)
+{
+  ReferenceRoute route;
+  route.id = id;
+  route.firstFlowId = 0;
+  route.lastFlowId = 0;
+  route.range = false;
+  route.mask = Ipv4Mask (g_masks[random->GetInteger (0, sizeof (g_masks) / sizeof (g_masks[0]) - 1)]);
+  route.network = RandomDestination (random).CombineMask (route.mask);
+  route.interface = random->GetInteger (1, nInterfaces);
+  route.metric = random->GetInteger (0, 1);
+  return route;
+}
+
+// The scan of LookupStatic (flowId, dest, oif) over the given routes: the
+// longest Ipv4Mask::GetPrefixLength, the first route of length 32, else
+// the lowest metric and the last route among equal metrics.  interface 0
+// accepts every interface.  Returns the index of the route or -1.
+static int32_t
+ScanRoutes (const std::vector<ReferenceRoute> &routes, bool range, uint32_t flowId,
+            Ipv4Address dest, uint32_t interface)
+{
+  int32_t result = -1;
+  uint16_t longest_mask = 0;
+  uint32_t shortest_metric = 0xffffffff;
+  for (uint32_t i = 0; i < routes.size (); i++)
+    {
+      const ReferenceRoute &route = routes[i];
+      if (route.range != range || flowId < route.firstFlowId || flowId > route.lastFlowId)
+        {
+          continue;
+        }
+      if (!route.mask.IsMatch (dest, route.network))
+        {
+          continue;
+        }
+      if (interface != 0 && route.interface != interface)
+        {
+          continue;
+        }
+      uint16_t masklen = route.mask.GetPrefixLength ();
+      if (masklen < longest_mask)
+        {
+          continue;
+        }
+      if (masklen > longest_mask)
+        {
+          shortest_metric = 0xffffffff;
+        }
+      longest_mask = masklen;
+      if (route.metric > shortest_metric)
+        {
+          continue;
+        }
+      shortest_metric = route.metric;
+      result = i;
+      if (masklen == 32)
+        {
+          break;
+        }
+    }
+  return result;
+}
+
+// The routes of the flow itself first, then the ranges covering it
+static int32_t
+ReferenceLookup (const std::vector<ReferenceRoute> &routes, uint32_t flowId, Ipv4Address dest,
+                 uint32_t interface)
+{
+  int32_t result = ScanRoutes (routes, false, flowId, dest, interface);
+  if (result < 0 && flowId != 0)
+    {
+      result = ScanRoutes (routes, true, flowId, dest, interface);
+    }
+  return result;
+}
+
+// FtIpv4PrefixTrie against the scan, with routes removed in between
+class FtPrefixTrieTestCase : public TestCase
 {
 public:
-  FtInternetTestCase1 ();
-  virtual ~FtInternetTestCase1 ();
+  FtPrefixTrieTestCase ();
 
 private:
   virtual void DoRun (void);
+  void Check (const FtIpv4PrefixTrie &trie, const std::vector<ReferenceRoute> &routes);
 };
 
-// Add some help text to this case to describe what it is intended to test
-FtInternetTestCase1::FtInternetTestCase1 ()
-  : TestCase ("FtInternet test case (does nothing)")
+FtPrefixTrieTestCase::FtPrefixTrieTestCase ()
+  : TestCase ("FtIpv4PrefixTrie selects the route of the linear scan")
+{
+}
+
+void
+FtPrefixTrieTestCase::Check (const FtIpv4PrefixTrie &trie, const std::vector<ReferenceRoute> &routes)
 {
+  NS_TEST_ASSERT_MSG_EQ (trie.GetN (), routes.size (), "Wrong number of routes in the trie");
+  for (uint32_t dest = 0; dest < 4 * 8; dest++)
+    {
+      Ipv4Address address (0xac100000 | ((dest / 8) << 8) | (dest % 8));
+      for (uint32_t interface = 0; interface <= 3; interface++)
+        {
+          int32_t expected = ReferenceLookup (routes, 0, address, interface);
+          uint32_t slot = 0;
+          uint32_t examined = 0;
+          bool found = trie.Lookup (address, interface == 0, interface, slot, examined);
+          NS_TEST_ASSERT_MSG_EQ (found, expected >= 0, "Route found by only one lookup to " << address
+                                 << " on interface " << interface);
+          if (found && expected >= 0)
+            {
+              NS_TEST_ASSERT_MSG_EQ (slot, routes[expected].id, "Other route selected to " << address
+                                     << " on interface " << interface);
+            }
+        }
+    }
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-FtInternetTestCase1::~FtInternetTestCase1 ()
+void
+FtPrefixTrieTestCase::DoRun (void)
+{
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (1);
+  FtIpv4PrefixTrie trie;
+  std::vector<ReferenceRoute> routes;
+  for (uint32_t id = 0; id < 200; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      FtIpv4PrefixTrie::Route entry = { route.id, route.interface, route.metric, route.id };
+      trie.Insert (route.network, route.mask, entry);
+      routes.push_back (route);
+    }
+  Check (trie, routes);
+
+  while (routes.size () > 50)
+    {
+      uint32_t i = random->GetInteger (0, routes.size () - 1);
+      NS_TEST_ASSERT_MSG_EQ (trie.Remove (routes[i].network, routes[i].mask, routes[i].id), true,
+                             "Route not removed");
+      routes.erase (routes.begin () + i);
+    }
+  Check (trie, routes);
+}
+
+// FtIpv4RoutingTable against a reference list in insertion order, with
+// removals, slot reuse and an interface parked and unparked
+class FtRoutingTableTestCase : public TestCase
+{
+public:
+  FtRoutingTableTestCase ();
+
+private:
+  // a route of the reference list and the slot the table gave it
+  struct StoredRoute
+  {
+    uint32_t slot;
+    uint32_t flowId;
+    Ipv4Address dest;
+    Ipv4Address gateway;
+    uint32_t interface;
+    uint32_t metric;
+  };
+
+  virtual void DoRun (void);
+  void AddRoute (uint32_t id);
+  void Check (const std::string &phase);
+
+  FtIpv4RoutingTable m_table;
+  std::vector<StoredRoute> m_routes;
+};
+
+FtRoutingTableTestCase::FtRoutingTableTestCase ()
+  : TestCase ("FtIpv4RoutingTable keeps the routes in insertion order")
+{
+}
+
+void
+FtRoutingTableTestCase::AddRoute (uint32_t id)
+{
+  StoredRoute route;
+  route.flowId = id % 5 + 1;
+  route.dest = Ipv4Address (0xac100000 | (id << 8));
+  route.gateway = Ipv4Address (0xc0a80001 + id);
+  route.interface = id % 3 + 1;
+  route.metric = id;
+  route.slot = m_table.Add (route.flowId, route.dest, Ipv4Mask ("255.255.255.0"), route.gateway,
+                            route.interface, route.metric);
+  m_routes.push_back (route);
+}
+
+void
+FtRoutingTableTestCase::Check (const std::string &phase)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetN (), m_routes.size (), phase << ": wrong number of routes");
+  for (uint32_t i = 0; i < m_routes.size () && i < m_table.GetN (); i++)
+    {
+      const StoredRoute &route = m_routes[i];
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetSlot (i), route.slot, phase << ": other slot at index " << i);
+      NS_TEST_ASSERT_MSG_EQ (m_table.IsLive (route.slot), true, phase << ": slot " << route.slot << " not live");
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetFlowId (route.slot), route.flowId, phase << ": flow id of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetDest (route.slot), route.dest, phase << ": destination of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetGateway (route.slot), route.gateway, phase << ": gateway of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetInterface (route.slot), route.interface, phase << ": interface of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetMetric (route.slot), route.metric, phase << ": metric of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (m_table.GetPrefixLength (route.slot), 24, phase << ": prefix length of slot " << route.slot);
+      FtIpv4RoutingTableEntry entry = m_table.GetEntry (route.slot);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetFlowId (), route.flowId, phase << ": flow id of the entry of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetDestNetwork (), route.dest, phase << ": destination of the entry of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetGateway (), route.gateway, phase << ": gateway of the entry of slot " << route.slot);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetInterface (), route.interface, phase << ": interface of the entry of slot " << route.slot);
+    }
+}
+
+void
+FtRoutingTableTestCase::DoRun (void)
+{
+  for (uint32_t id = 0; id < 30; id++)
+    {
+      AddRoute (id);
+    }
+  Check ("added");
+
+  for (uint32_t i = m_routes.size (); i-- > 0; )
+    {
+      if (i % 3 == 0)
+        {
+          m_table.Remove (m_routes[i].slot);
+          m_routes.erase (m_routes.begin () + i);
+        }
+    }
+  Check ("removed");
+
+  // freed slots are reused, the new routes are still last in the order
+  for (uint32_t id = 30; id < 35; id++)
+    {
+      AddRoute (id);
+      NS_TEST_ASSERT_MSG_LT (m_routes.back ().slot, 30, "Freed slot not reused");
+    }
+  Check ("added in freed slots");
+
+  std::vector<StoredRoute> all = m_routes;
+  std::vector<uint32_t> slots = m_table.GetInterfaceSlots (2);
+  NS_TEST_ASSERT_MSG_GT (slots.size (), 0, "No route on interface 2");
+  for (uint32_t i = 0; i < slots.size (); i++)
+    {
+      m_table.Park (slots[i]);
+      NS_TEST_ASSERT_MSG_EQ (m_table.IsParked (slots[i]), true, "Slot " << slots[i] << " not parked");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetInterfaceSlots (2).size (), 0, "Parked routes left in the interface index");
+  for (uint32_t i = m_routes.size (); i-- > 0; )
+    {
+      if (m_routes[i].interface == 2)
+        {
+          m_routes.erase (m_routes.begin () + i);
+        }
+    }
+  Check ("interface 2 parked");
+  for (uint32_t flowId = 1; flowId <= 5; flowId++)
+    {
+      uint32_t nParked = 0;
+      for (uint32_t i = 0; i < all.size (); i++)
+        {
+          nParked += all[i].interface == 2 && all[i].flowId == flowId;
+        }
+      std::vector<uint32_t> parked;
+      m_table.GetParkedFlowSlots (flowId, parked);
+      NS_TEST_ASSERT_MSG_EQ (parked.size (), nParked, "Wrong number of parked routes of flow " << flowId);
+    }
+
+  // unparked routes are back at their place in the order
+  std::vector<uint32_t> restored;
+  m_table.UnparkInterface (2, restored);
+  NS_TEST_ASSERT_MSG_EQ (restored.size (), slots.size (), "Wrong number of routes unparked");
+  m_routes = all;
+  Check ("interface 2 unparked");
+}
+
+// Node 0 reaches one peer through each of its interfaces 1 to 3; the
+// routes installed on node 0 are kept in a reference table, and RouteOutput
+// is checked against the scan of the routes of the interfaces up
+class FtRoutingTestCase : public TestCase
+{
+public:
+  FtRoutingTestCase (std::string name);
+
+protected:
+  void CreateNodes (void);
+  void AddRoute (const ReferenceRoute &route);
+  Ptr<Ipv4Route> Lookup (uint32_t flowId, Ipv4Address dest, uint32_t interface);
+  void Check (const std::string &phase, uint32_t lastFlowId);
+  static Ipv4Address GetGateway (uint32_t id);
+
+  FtIpv4StaticRoutingHelper m_routingHelper;
+  NodeContainer m_nodes;
+  Ptr<Ipv4> m_ipv4;
+  Ptr<FtIpv4StaticRouting> m_routing;
+  std::vector<ReferenceRoute> m_routes;
+};
+
+FtRoutingTestCase::FtRoutingTestCase (std::string name)
+  : TestCase (name)
+{
+}
+
+Ipv4Address
+FtRoutingTestCase::GetGateway (uint32_t id)
+{
+  // the gateway tells the routes apart
+  return Ipv4Address (0xc0a80001 + id);
+}
+
+void
+FtRoutingTestCase::CreateNodes (void)
+{
+  m_nodes = NodeContainer ();
+  m_nodes.Create (4);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (m_routingHelper);
+  internet.Install (m_nodes);
+  SimpleNetDeviceHelper simple;
+  Ipv4AddressHelper addresses ("10.1.1.0", "255.255.255.0");
+  for (uint32_t peer = 1; peer <= 3; peer++)
+    {
+      addresses.Assign (simple.Install (NodeContainer (m_nodes.Get (0), m_nodes.Get (peer))));
+      addresses.NewNetwork ();
+    }
+  m_ipv4 = m_nodes.Get (0)->GetObject<Ipv4> ();
+  m_routing = m_routingHelper.GetStaticRouting (m_ipv4);
+  NS_TEST_ASSERT_MSG_NE (m_routing, 0, "No FtIpv4StaticRouting on the node");
+}
+
+void
+FtRoutingTestCase::AddRoute (const ReferenceRoute &route)
+{
+  if (route.range)
+    {
+      m_routing->AddFlowRangeRouteTo (route.firstFlowId, route.lastFlowId, route.network, route.mask,
+                                      GetGateway (route.id), route.interface, route.metric);
+    }
+  else if (route.firstFlowId == 0)
+    {
+      m_routing->AddNetworkRouteTo (route.network, route.mask, GetGateway (route.id), route.interface,
+                                    route.metric);
+    }
+  else
+    {
+      m_routing->AddNetworkRouteTo (route.firstFlowId, route.network, route.mask, GetGateway (route.id),
+                                    route.interface, route.metric);
+    }
+  m_routes.push_back (route);
+}
+
+Ptr<Ipv4Route>
+FtRoutingTestCase::Lookup (uint32_t flowId, Ipv4Address dest, uint32_t interface)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  if (flowId != 0)
+    {
+      FtTag tag;
+      tag.SetSimpleValue (flowId);
+      p->AddByteTag (tag);
+    }
+  Ipv4Header header;
+  header.SetDestination (dest);
+  Socket::SocketErrno sockerr;
+  Ptr<NetDevice> oif = interface == 0 ? 0 : m_ipv4->GetNetDevice (interface);
+  return m_routing->RouteOutput (p, header, oif, sockerr);
+}
+
+void
+FtRoutingTestCase::Check (const std::string &phase, uint32_t lastFlowId)
+{
+  std::vector<ReferenceRoute> live;
+  for (uint32_t i = 0; i < m_routes.size (); i++)
+    {
+      if (m_ipv4->IsUp (m_routes[i].interface))
+        {
+          live.push_back (m_routes[i]);
+        }
+    }
+  for (uint32_t flowId = 0; flowId <= lastFlowId; flowId++)
+    {
+      for (uint32_t dest = 0; dest < 4 * 8; dest++)
+        {
+          Ipv4Address address (0xac100000 | ((dest / 8) << 8) | (dest % 8));
+          for (uint32_t interface = 0; interface <= 3; interface++)
+            {
+              Ptr<Ipv4Route> route = Lookup (flowId, address, interface);
+              int32_t expected = ReferenceLookup (live, flowId, address, interface);
+              NS_TEST_ASSERT_MSG_EQ ((route != 0), (expected >= 0), phase << ": route found by only one "
+                                     "lookup for flow " << flowId << " to " << address << " on interface "
+                                     << interface);
+              if (route != 0 && expected >= 0)
+                {
+                  NS_TEST_ASSERT_MSG_EQ (route->GetGateway (), GetGateway (live[expected].id),
+                                         phase << ": other route selected for flow " << flowId << " to "
+                                         << address << " on interface " << interface);
+                  NS_TEST_ASSERT_MSG_EQ (route->GetOutputDevice (), m_ipv4->GetNetDevice (live[expected].interface),
+                                         phase << ": other output device for flow " << flowId << " to "
+                                         << address);
+                }
+            }
+        }
+    }
+}
+
+// Routes without flowId and routes of flows, with routes removed by index
+// and an interface going down and up
+class FtFlowRoutesTestCase : public FtRoutingTestCase
+{
+public:
+  FtFlowRoutesTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FtFlowRoutesTestCase::FtFlowRoutesTestCase ()
+  : FtRoutingTestCase ("FtIpv4StaticRouting flow routes select the route of the linear scan")
+{
+}
+
+void
+FtFlowRoutesTestCase::DoRun (void)
+{
+  CreateNodes ();
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (2);
+  for (uint32_t id = 0; id < 300; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      if (random->GetInteger (0, 9) != 0)
+        {
+          route.firstFlowId = random->GetInteger (1, 16);
+          route.lastFlowId = route.firstFlowId;
+        }
+      AddRoute (route);
+    }
+  Check ("added", 16);
+  uint32_t nConnected = m_routing->GetNRoutes () - m_routes.size ();
+
+  // the connected routes of the interfaces are left in place
+  for (uint32_t removed = 0; removed < 100; )
+    {
+      uint32_t i = random->GetInteger (0, m_routing->GetNRoutes () - 1);
+      Ipv4Address gateway = m_routing->GetRoute (i).GetGateway ();
+      if (gateway == Ipv4Address::GetZero ())
+        {
+          continue;
+        }
+      m_routing->RemoveRoute (i);
+      for (uint32_t j = 0; j < m_routes.size (); j++)
+        {
+          if (GetGateway (m_routes[j].id) == gateway)
+            {
+              m_routes.erase (m_routes.begin () + j);
+              break;
+            }
+        }
+      removed++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), m_routes.size () + nConnected, "Wrong number of routes");
+  Check ("removed", 16);
+
+  m_ipv4->SetDown (2);
+  Check ("interface 2 down", 16);
+  m_ipv4->SetUp (2);
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), m_routes.size () + nConnected, "Routes lost by interface 2");
+  Check ("interface 2 up", 16);
+
+  Simulator::Destroy ();
+}
+
+// The same lookups through the FIB compiled by Freeze, with flows changed
+// after Freeze and an interface going down and up
+class FtFreezeTestCase : public FtRoutingTestCase
+{
+public:
+  FtFreezeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FtFreezeTestCase::FtFreezeTestCase ()
+  : FtRoutingTestCase ("FtIpv4StaticRouting frozen routes select the route of the linear scan")
+{
+}
+
+void
+FtFreezeTestCase::DoRun (void)
+{
+  CreateNodes ();
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (3);
+  uint32_t id = 0;
+  for (; id < 300; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      if (random->GetInteger (0, 9) != 0)
+        {
+          route.firstFlowId = random->GetInteger (1, 16);
+          route.lastFlowId = route.firstFlowId;
+        }
+      AddRoute (route);
+    }
+  m_routing->Freeze ();
+  NS_TEST_ASSERT_MSG_EQ (m_routing->IsFrozen (), true, "Routes not frozen");
+  Check ("frozen", 16);
+
+  // flows changed after Freeze are looked up outside of the FIB
+  for (; id < 340; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      route.firstFlowId = random->GetInteger (1, 16);
+      route.lastFlowId = route.firstFlowId;
+      AddRoute (route);
+    }
+  Check ("added after Freeze", 16);
+
+  m_ipv4->SetDown (1);
+  Check ("interface 1 down after Freeze", 16);
+  m_ipv4->SetUp (1);
+  Check ("interface 1 up after Freeze", 16);
+
+  Simulator::Destroy ();
+}
+
+// Flow range routes behind the routes of the flows, then flows merged into
+// ranges by AggregateFlowRoutes next to ranges that cover some of them
+class FtFlowRangeTestCase : public FtRoutingTestCase
+{
+public:
+  FtFlowRangeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FtFlowRangeTestCase::FtFlowRangeTestCase ()
+  : FtRoutingTestCase ("FtIpv4StaticRouting flow ranges select the route of the linear scan")
 {
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-FtInternetTestCase1::DoRun (void)
+FtFlowRangeTestCase::DoRun (void)
+{
+  CreateNodes ();
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (4);
+  uint32_t id = 0;
+  // routes without flowId, routes of flows 1 to 16, ranges up to flow 24
+  for (; id < 400; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      uint32_t kind = random->GetInteger (0, 9);
+      if (kind == 0)
+        {
+          route.firstFlowId = 0;
+        }
+      else if (kind <= 7)
+        {
+          route.firstFlowId = random->GetInteger (1, 16);
+        }
+      else
+        {
+          route.range = true;
+          route.firstFlowId = random->GetInteger (1, 20);
+        }
+      route.lastFlowId = route.range ? route.firstFlowId + random->GetInteger (1, 4) : route.firstFlowId;
+      AddRoute (route);
+    }
+  Check ("ranges", 24);
+
+  // GetRoute gives the flow ids of every route, a range as one entry
+  int32_t firstRange = -1;
+  for (uint32_t i = 0; i < m_routing->GetNRoutes (); i++)
+    {
+      FtIpv4RoutingTableEntry entry = m_routing->GetRoute (i);
+      if (entry.GetGateway () == Ipv4Address::GetZero ())
+        {
+          continue;
+        }
+      const ReferenceRoute &route = m_routes[entry.GetGateway ().Get () - GetGateway (0).Get ()];
+      NS_TEST_ASSERT_MSG_EQ (entry.GetFlowId (), route.firstFlowId, "Wrong flow id of route " << i);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetLastFlowId (), route.lastFlowId, "Wrong last flow id of route " << i);
+      if (route.range && firstRange < 0)
+        {
+          firstRange = i;
+        }
+    }
+  NS_TEST_ASSERT_MSG_NE (firstRange, -1, "No range route");
+  // removing a range route by index removes it for all its flows
+  Ipv4Address gateway = m_routing->GetRoute (firstRange).GetGateway ();
+  uint32_t nRanges = m_routing->GetNFlowRangeRoutes ();
+  m_routing->RemoveRoute (firstRange);
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNFlowRangeRoutes (), nRanges - 1, "Range route not removed");
+  m_routes.erase (m_routes.begin () + (gateway.Get () - GetGateway (0).Get ()));
+  Check ("range removed", 24);
+
+  // flows 30 to 69 have a single route, shared by runs of consecutive
+  // flows; two ranges cover some of them
+  for (uint32_t flowId = 30; flowId < 70; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      for (uint32_t end = std::min (flowId + random->GetInteger (1, 5), 70U); flowId < end; flowId++)
+        {
+          route.firstFlowId = flowId;
+          route.lastFlowId = flowId;
+          AddRoute (route);
+        }
+    }
+  for (uint32_t first = 40; first <= 60; first += 20, id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      route.range = true;
+      route.firstFlowId = first;
+      route.lastFlowId = first + 5;
+      AddRoute (route);
+    }
+  Check ("before aggregation", 72);
+
+  uint32_t nRoutes = m_routing->GetNRoutes ();
+  nRanges = m_routing->GetNFlowRangeRoutes ();
+  uint32_t removed = m_routing->AggregateFlowRoutes ();
+  NS_TEST_ASSERT_MSG_GT (removed, 0, "No route aggregated");
+  NS_TEST_ASSERT_MSG_GT (m_routing->GetNFlowRangeRoutes (), nRanges, "No range added");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), nRoutes - removed, "Wrong number of routes after aggregation");
+  Check ("aggregated", 72);
+
+  m_routing->Freeze ();
+  Check ("aggregated and frozen", 72);
+  m_ipv4->SetDown (3);
+  Check ("interface 3 down", 72);
+  m_ipv4->SetUp (3);
+  Check ("interface 3 up", 72);
+
+  Simulator::Destroy ();
+}
+
+// Routes saved by SaveRoutesAll and loaded by LoadRoutesAll into a fresh
+// node set give the same lookups; a file of other inputs, format version
+// or nodes is refused
+class FtRouteSnapshotTestCase : public FtRoutingTestCase
+{
+public:
+  FtRouteSnapshotTestCase ();
+
+private:
+  virtual void DoRun (void);
+  // gateway selected for every flow, destination and output interface,
+  // zero where no route is found
+  std::vector<Ipv4Address> GetLookups (void);
+};
+
+FtRouteSnapshotTestCase::FtRouteSnapshotTestCase ()
+  : FtRoutingTestCase ("FtIpv4StaticRoutingHelper route snapshots keep the lookups")
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+}
+
+std::vector<Ipv4Address>
+FtRouteSnapshotTestCase::GetLookups (void)
+{
+  std::vector<Ipv4Address> gateways;
+  for (uint32_t flowId = 0; flowId <= 52; flowId++)
+    {
+      for (uint32_t dest = 0; dest < 4 * 8; dest++)
+        {
+          Ipv4Address address (0xac100000 | ((dest / 8) << 8) | (dest % 8));
+          for (uint32_t interface = 0; interface <= 3; interface++)
+            {
+              Ptr<Ipv4Route> route = Lookup (flowId, address, interface);
+              gateways.push_back (route != 0 ? route->GetGateway () : Ipv4Address::GetZero ());
+            }
+        }
+    }
+  return gateways;
+}
+
+void
+FtRouteSnapshotTestCase::DoRun (void)
+{
+  const uint64_t digest = 0x0123456789abcdefULL;
+  std::string filename = CreateTempDirFilename ("ft-routes.bin");
+
+  CreateNodes ();
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (5);
+  uint32_t id = 0;
+  for (; id < 300; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      uint32_t kind = random->GetInteger (0, 9);
+      if (kind == 0)
+        {
+          route.firstFlowId = 0;
+        }
+      else if (kind <= 7)
+        {
+          route.firstFlowId = random->GetInteger (1, 16);
+        }
+      else
+        {
+          route.range = true;
+          route.firstFlowId = random->GetInteger (1, 20);
+        }
+      route.lastFlowId = route.range ? route.firstFlowId + random->GetInteger (1, 4) : route.firstFlowId;
+      AddRoute (route);
+    }
+  // flows 30 to 49 share their route in runs, merged by AggregateFlowRoutes
+  for (uint32_t flowId = 30; flowId < 50; id++)
+    {
+      ReferenceRoute route = RandomRoute (random, id, 3);
+      for (uint32_t end = std::min (flowId + random->GetInteger (1, 5), 50U); flowId < end; flowId++)
+        {
+          route.firstFlowId = flowId;
+          route.lastFlowId = flowId;
+          AddRoute (route);
+        }
+    }
+  m_routing->AggregateFlowRoutes ();
+  m_routing->Freeze ();
+  Check ("saved", 52);
+  std::vector<Ipv4Address> saved = GetLookups ();
+  uint32_t nRoutes = m_routing->GetNRoutes ();
+  FtIpv4StaticRoutingHelper::SaveRoutesAll (filename, digest);
+
+  // the same file with another format version
+  std::string otherVersion = CreateTempDirFilename ("ft-routes-version.bin");
+  {
+    std::ifstream is (filename.c_str (), std::ios::in | std::ios::binary);
+    std::string contents ((std::istreambuf_iterator<char> (is)), std::istreambuf_iterator<char> ());
+    NS_TEST_ASSERT_MSG_GT (contents.size (), 8, "Route file too short");
+    contents[4]++;
+    std::ofstream os (otherVersion.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+    os.write (contents.data (), contents.size ());
+  }
+  Simulator::Destroy ();
+
+  CreateNodes ();
+  uint32_t nConnected = m_routing->GetNRoutes ();
+  NS_TEST_ASSERT_MSG_EQ (FtIpv4StaticRoutingHelper::LoadRoutesAll (filename, digest + 1), false,
+                         "Route file of other inputs loaded");
+  NS_TEST_ASSERT_MSG_EQ (FtIpv4StaticRoutingHelper::LoadRoutesAll (otherVersion, digest), false,
+                         "Route file of another format version loaded");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), nConnected, "Routes added by a refused file");
+  NS_TEST_ASSERT_MSG_EQ (FtIpv4StaticRoutingHelper::LoadRoutesAll (filename, digest), true,
+                         "Route file not loaded");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), nRoutes, "Wrong number of routes loaded");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->IsFrozen (), true, "Loaded routes not frozen");
+  std::vector<Ipv4Address> loaded = GetLookups ();
+  for (uint32_t i = 0; i < saved.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (loaded[i], saved[i], "Other route after loading, lookup " << i);
+    }
+  Simulator::Destroy ();
+
+  // a node set of another size
+  CreateNodes ();
+  NodeContainer extra;
+  extra.Create (1);
+  NS_TEST_ASSERT_MSG_EQ (FtIpv4StaticRoutingHelper::LoadRoutesAll (filename, digest), false,
+                         "Route file of other nodes loaded");
+  Simulator::Destroy ();
+}
+
+// Nodes 0 to 3 in a line, interface 1 of every node towards node 0 and
+// interface 2 towards node 3; node 0 sends UDP packets to node 3.  Flow 7
+// has flow routes along the line, flow 8 none.  The IP transmissions of
+// every node and the packets received by node 3 are recorded.
+class FtLineTestCase : public TestCase
+{
+public:
+  FtLineTestCase (std::string name);
+  void Send (Ptr<Packet> p, uint32_t flowId);
+
+protected:
+  // an IP transmission, the packet with its tags
+  struct Transmission
+  {
+    uint32_t node;
+    uint32_t interface;
+    Ptr<const Packet> packet;
+  };
+
+  void CreateLine (const std::string &attribute);
+  // the transmissions of the packets of a payload size
+  std::vector<Transmission> GetTransmissions (uint32_t size) const;
+  // the received packet of a payload size, 0 if none
+  Ptr<Packet> GetReceived (uint32_t size) const;
+  Ptr<FtIpv4StaticRouting> GetRouting (uint32_t node);
+
+  NodeContainer m_nodes;
+  std::vector<Ipv4Address> m_nextHops;  //!< address of node k + 1 on the link of nodes k and k + 1
+  Ipv4Address m_sinkAddress;
+
+private:
+  void Transmitted (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+  void Received (Ptr<Socket> socket);
+
+  FtIpv4StaticRoutingHelper m_routingHelper;
+  Ptr<Socket> m_source;
+  Ptr<Socket> m_sink;
+  std::vector<Transmission> m_transmissions;
+  std::vector<Ptr<Packet> > m_received;
+};
+
+FtLineTestCase::FtLineTestCase (std::string name)
+  : TestCase (name)
+{
+}
+
+void
+FtLineTestCase::CreateLine (const std::string &attribute)
+{
+  m_nodes.Create (4);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (m_routingHelper);
+  internet.Install (m_nodes);
+  SimpleNetDeviceHelper simple;
+  Ipv4AddressHelper addresses ("10.1.1.0", "255.255.255.0");
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      Ipv4InterfaceContainer interfaces =
+        addresses.Assign (simple.Install (NodeContainer (m_nodes.Get (node), m_nodes.Get (node + 1))));
+      m_nextHops.push_back (interfaces.GetAddress (1));
+      addresses.NewNetwork ();
+    }
+  m_sinkAddress = m_nextHops.back ();
+  for (uint32_t node = 0; node < 4; node++)
+    {
+      GetRouting (node)->SetAttribute (attribute, BooleanValue (true));
+      m_nodes.Get (node)->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+        "Tx", MakeCallback (&FtLineTestCase::Transmitted, this));
+    }
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      GetRouting (node)->AddHostRouteTo (7, m_sinkAddress, m_nextHops[node], node == 0 ? 1 : 2);
+    }
+
+  m_sink = Socket::CreateSocket (m_nodes.Get (3), UdpSocketFactory::GetTypeId ());
+  m_sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  m_sink->SetRecvCallback (MakeCallback (&FtLineTestCase::Received, this));
+  m_source = Socket::CreateSocket (m_nodes.Get (0), UdpSocketFactory::GetTypeId ());
+  m_source->Bind ();
+}
+
+Ptr<FtIpv4StaticRouting>
+FtLineTestCase::GetRouting (uint32_t node)
+{
+  return m_routingHelper.GetStaticRouting (m_nodes.Get (node)->GetObject<Ipv4> ());
+}
+
+void
+FtLineTestCase::Send (Ptr<Packet> p, uint32_t flowId)
+{
+  FtTag tag;
+  tag.SetSimpleValue (flowId);
+  p->AddByteTag (tag);
+  m_source->SendTo (p, 0, InetSocketAddress (m_sinkAddress, 9));
+}
+
+void
+FtLineTestCase::Transmitted (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  Transmission transmission;
+  transmission.node = ipv4->GetObject<Node> ()->GetId ();
+  transmission.interface = interface;
+  transmission.packet = p->Copy ();
+  m_transmissions.push_back (transmission);
+}
+
+void
+FtLineTestCase::Received (Ptr<Socket> socket)
+{
+  Ptr<Packet> p;
+  while ((p = socket->Recv ()))
+    {
+      m_received.push_back (p);
+    }
+}
+
+std::vector<FtLineTestCase::Transmission>
+FtLineTestCase::GetTransmissions (uint32_t size) const
+{
+  // the transmitted packets carry the IP and UDP headers
+  std::vector<Transmission> transmissions;
+  for (uint32_t i = 0; i < m_transmissions.size (); i++)
+    {
+      if (m_transmissions[i].packet->GetSize () == size + 28)
+        {
+          transmissions.push_back (m_transmissions[i]);
+        }
+    }
+  return transmissions;
+}
+
+Ptr<Packet>
+FtLineTestCase::GetReceived (uint32_t size) const
+{
+  for (uint32_t i = 0; i < m_received.size (); i++)
+    {
+      if (m_received[i]->GetSize () == size)
+        {
+          return m_received[i];
+        }
+    }
+  return 0;
+}
+
+// A packet of flow 8 follows its FtSourceRouteTag, advanced at every hop; a
+// packet of flow 7 whose route names another node is looked up by flow
+class FtSourceRoutingTestCase : public FtLineTestCase
+{
+public:
+  FtSourceRoutingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FtSourceRoutingTestCase::FtSourceRoutingTestCase ()
+  : FtLineTestCase ("FtIpv4StaticRouting forwards packets by their source route")
+{
+}
+
+void
+FtSourceRoutingTestCase::DoRun (void)
+{
+  CreateLine ("SourceRouting");
+  FtSourceRouteTag route;
+  route.AddHop (m_nodes.Get (0)->GetId (), 1);
+  route.AddHop (m_nodes.Get (1)->GetId (), 2);
+  route.AddHop (m_nodes.Get (2)->GetId (), 2);
+  Ptr<Packet> routed = Create<Packet> (100);
+  routed->AddPacketTag (route);
+  Simulator::Schedule (Seconds (1), &FtLineTestCase::Send, this, routed, 8U);
+
+  FtSourceRouteTag elsewhere;
+  elsewhere.AddHop (m_nodes.Get (3)->GetId (), 1);
+  Ptr<Packet> looked = Create<Packet> (200);
+  looked->AddPacketTag (elsewhere);
+  Simulator::Schedule (Seconds (2), &FtLineTestCase::Send, this, looked, 7U);
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+
+  std::vector<Transmission> transmissions = GetTransmissions (100);
+  NS_TEST_ASSERT_MSG_EQ (transmissions.size (), 3, "Source routed packet not sent by every hop");
+  const uint32_t interfaces[] = { 1, 2, 2 };
+  for (uint32_t i = 0; i < transmissions.size () && i < 3; i++)
+    {
+      FtSourceRouteTag tag;
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].node, m_nodes.Get (i)->GetId (), "Hop " << i << " sent by another node");
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].interface, interfaces[i], "Hop " << i << " through another interface");
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].packet->PeekPacketTag (tag), true, "Source route lost at hop " << i);
+      NS_TEST_ASSERT_MSG_EQ (tag.GetHopIndex (), i + 1, "Hop index not advanced at hop " << i);
+    }
+  Ptr<Packet> received = GetReceived (100);
+  NS_TEST_ASSERT_MSG_NE (received, 0, "Source routed packet not received");
+  FtSourceRouteTag tag;
+  if (received != 0 && received->PeekPacketTag (tag))
+    {
+      NS_TEST_ASSERT_MSG_EQ (tag.GetHopIndex (), tag.GetNHops (), "Source route not done at the sink");
+    }
+
+  // the packet of flow 7 is forwarded by the flow routes, its tag untouched
+  NS_TEST_ASSERT_MSG_EQ (GetTransmissions (200).size (), 3, "Looked up packet not sent by every hop");
+  received = GetReceived (200);
+  NS_TEST_ASSERT_MSG_NE (received, 0, "Looked up packet not received");
+  if (received != 0 && received->PeekPacketTag (tag))
+    {
+      NS_TEST_ASSERT_MSG_EQ (tag.GetHopIndex (), 0, "Hop index advanced off the route");
+    }
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (GetRouting (node)->GetStatistics ().sourceRouted, 1,
+                             "Wrong number of source routed packets on node " << node);
+    }
+
+  Simulator::Destroy ();
+}
+
+// A packet of flow 8 follows its label switched path, its label swapped at
+// every hop; a packet of flow 7 with a label unknown to the nodes is
+// looked up by flow
+class FtLabelSwitchingTestCase : public FtLineTestCase
+{
+public:
+  FtLabelSwitchingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FtLabelSwitchingTestCase::FtLabelSwitchingTestCase ()
+  : FtLineTestCase ("FtIpv4StaticRouting forwards packets by their label")
+{
+}
+
+void
+FtLabelSwitchingTestCase::DoRun (void)
+{
+  CreateLine ("LabelSwitching");
+  std::vector<FtIpv4StaticRoutingHelper::PathHop> hops;
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      FtIpv4StaticRoutingHelper::PathHop hop;
+      hop.node = m_nodes.Get (node);
+      hop.nextHop = m_nextHops[node];
+      hop.interface = node == 0 ? 1 : 2;
+      hops.push_back (hop);
+    }
+  // labels taken on nodes 1 and 2 first, so that every hop of the path
+  // has another label
+  for (uint32_t node = 1; node < 3; node++)
+    {
+      for (uint32_t k = 0; k < node; k++)
+        {
+          GetRouting (node)->AddLabelRoute (0, m_nextHops[node], 2);
+        }
+    }
+  FtIpv4StaticRoutingHelper helper;
+  uint32_t label = helper.AddLabelPath (hops);
+  NS_TEST_ASSERT_MSG_NE (label, 0, "No label assigned to the path");
+
+  FtLabelTag first;
+  first.SetLabel (label);
+  Ptr<Packet> switched = Create<Packet> (100);
+  switched->AddPacketTag (first);
+  Simulator::Schedule (Seconds (1), &FtLineTestCase::Send, this, switched, 8U);
+
+  FtLabelTag unknown;
+  unknown.SetLabel (999);
+  Ptr<Packet> looked = Create<Packet> (200);
+  looked->AddPacketTag (unknown);
+  Simulator::Schedule (Seconds (2), &FtLineTestCase::Send, this, looked, 7U);
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+
+  // every hop sends the label of the next one, the last hop label 0
+  std::vector<Transmission> transmissions = GetTransmissions (100);
+  NS_TEST_ASSERT_MSG_EQ (transmissions.size (), 3, "Label switched packet not sent by every hop");
+  uint32_t previous = label;
+  for (uint32_t i = 0; i < transmissions.size () && i < 3; i++)
+    {
+      FtLabelTag tag;
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].node, m_nodes.Get (i)->GetId (), "Hop " << i << " sent by another node");
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].interface, hops[i].interface, "Hop " << i << " through another interface");
+      NS_TEST_ASSERT_MSG_EQ (transmissions[i].packet->PeekPacketTag (tag), true, "Label lost at hop " << i);
+      NS_TEST_ASSERT_MSG_NE (tag.GetLabel (), previous, "Label not swapped at hop " << i);
+      if (i == 2)
+        {
+          NS_TEST_ASSERT_MSG_EQ (tag.GetLabel (), 0, "Label left after the last hop");
+        }
+      previous = tag.GetLabel ();
+    }
+  NS_TEST_ASSERT_MSG_NE (GetReceived (100), 0, "Label switched packet not received");
+
+  // the packet of flow 7 is forwarded by the flow routes, its label untouched
+  transmissions = GetTransmissions (200);
+  NS_TEST_ASSERT_MSG_EQ (transmissions.size (), 3, "Looked up packet not sent by every hop");
+  for (uint32_t i = 0; i < transmissions.size (); i++)
+    {
+      FtLabelTag tag;
+      if (transmissions[i].packet->PeekPacketTag (tag))
+        {
+          NS_TEST_ASSERT_MSG_EQ (tag.GetLabel (), 999, "Unknown label swapped at hop " << i);
+        }
+    }
+  NS_TEST_ASSERT_MSG_NE (GetReceived (200), 0, "Looked up packet not received");
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (GetRouting (node)->GetStatistics ().labelSwitched, 1,
+                             "Wrong number of label switched packets on node " << node);
+    }
+
+  helper.RemoveLabelPath (hops, label);
+  for (uint32_t node = 0; node < 3; node++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (GetRouting (node)->GetNLabelRoutes (), node, "Label route left on node " << node);
+    }
+
+  Simulator::Destroy ();
+}
+
+// A flow route with a backup next hop on another interface: lookups switch
+// to the backup while the interface of the route is down and back once it
+// is up, with and without the route cache; moving the flow away drops the
+// backup with its route
+class FtBackupRouteTestCase : public FtRoutingTestCase
+{
+public:
+  FtBackupRouteTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Run (uint32_t cacheSize);
+  // checks the gateway of a flow twice, the second lookup from the cache;
+  // a zero gateway expects no route
+  void CheckGateway (const std::string &phase, uint32_t flowId, Ipv4Address gateway);
+
+  Ipv4Address m_dest;
+};
+
+FtBackupRouteTestCase::FtBackupRouteTestCase ()
+  : FtRoutingTestCase ("FtIpv4StaticRouting switches to backup routes while an interface is down"),
+    m_dest ("172.16.0.1")
+{
+}
+
+void
+FtBackupRouteTestCase::CheckGateway (const std::string &phase, uint32_t flowId, Ipv4Address gateway)
+{
+  for (uint32_t k = 0; k < 2; k++)
+    {
+      Ptr<Ipv4Route> route = Lookup (flowId, m_dest, 0);
+      if (gateway == Ipv4Address::GetZero ())
+        {
+          NS_TEST_ASSERT_MSG_EQ (route, 0, phase << ": route found for flow " << flowId);
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_NE (route, 0, phase << ": no route for flow " << flowId);
+          if (route != 0)
+            {
+              NS_TEST_ASSERT_MSG_EQ (route->GetGateway (), gateway, phase << ": other route for flow " << flowId);
+            }
+        }
+    }
+}
+
+void
+FtBackupRouteTestCase::Run (uint32_t cacheSize)
+{
+  CreateNodes ();
+  m_routing->SetAttribute ("RouteCacheSize", UintegerValue (cacheSize));
+  // flow 5 through interface 1, protected through interface 2; flow 6
+  // through interface 1 without backup
+  m_routing->AddHostRouteTo (5, m_dest, GetGateway (0), 1);
+  m_routing->AddHostRouteTo (6, m_dest, GetGateway (1), 1);
+  uint32_t nRoutes = m_routing->GetNRoutes ();
+  FtIpv4StaticRoutingHelper::FlowRoute backup = { 5, m_nodes.Get (0), m_dest, GetGateway (2), 2 };
+  NS_TEST_ASSERT_MSG_EQ (m_routingHelper.AddBackupRoutes (std::vector<FtIpv4StaticRoutingHelper::FlowRoute> (1, backup)), 1,
+                         "Route not protected");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNBackupRoutes (), 1, "Wrong number of backups");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), nRoutes, "Backup counted as a route");
+  CheckGateway ("protected", 5, GetGateway (0));
+  CheckGateway ("protected", 6, GetGateway (1));
+
+  m_ipv4->SetDown (1);
+  CheckGateway ("interface 1 down", 5, GetGateway (2));
+  CheckGateway ("interface 1 down", 6, Ipv4Address::GetZero ());
+  m_ipv4->SetUp (1);
+  CheckGateway ("interface 1 up", 5, GetGateway (0));
+  CheckGateway ("interface 1 up", 6, GetGateway (1));
+
+  // the backup is not used while the route is up
+  m_ipv4->SetDown (2);
+  CheckGateway ("backup interface down", 5, GetGateway (0));
+  m_ipv4->SetUp (2);
+
+  // rerouting flow 5 removes its route, and with it the backup
+  FtIpv4StaticRoutingHelper::FlowRoute oldRoute = { 5, m_nodes.Get (0), m_dest, GetGateway (0), 1 };
+  FtIpv4StaticRoutingHelper::FlowRoute newRoute = { 5, m_nodes.Get (0), m_dest, GetGateway (3), 3 };
+  m_routingHelper.RerouteFlows (std::vector<FtIpv4StaticRoutingHelper::FlowRoute> (1, oldRoute),
+                                std::vector<FtIpv4StaticRoutingHelper::FlowRoute> (1, newRoute));
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNBackupRoutes (), 0, "Backup left after its route was removed");
+  NS_TEST_ASSERT_MSG_EQ (m_routing->GetNRoutes (), nRoutes, "Wrong number of routes after reroute");
+  CheckGateway ("rerouted", 5, GetGateway (3));
+  m_ipv4->SetDown (3);
+  CheckGateway ("rerouted, interface 3 down", 5, Ipv4Address::GetZero ());
+  m_ipv4->SetUp (3);
+
+  Simulator::Destroy ();
+}
+
+void
+FtBackupRouteTestCase::DoRun (void)
+{
+  Run (65536);
+  Run (0);
+}
+
+// Departure times of FtOnOffApplication (Tx trace) across SetRate: 1000
+// byte packets at 8000 bit/s leave every second from time 1; at 2.5 s the
+// 4000 bits generated towards the third packet are kept
+class FtOnOffSetRateTestCase : public TestCase
+{
+public:
+  FtOnOffSetRateTestCase ();
+
+private:
+  virtual void DoRun (void);
+  // runs the application until 3.9 s with the given rate changes and
+  // returns the departure times
+  std::vector<Time> Run (uint32_t burstSize, const std::vector<std::pair<Time, DataRate> > &changes);
+  void Check (const std::string &phase, const std::vector<Time> &departures, const double *expected,
+              uint32_t n);
+  void Sent (Ptr<const Packet> p);
+
+  std::vector<Time> m_departures;
+};
+
+FtOnOffSetRateTestCase::FtOnOffSetRateTestCase ()
+  : TestCase ("FtOnOffApplication SetRate keeps the bits generated at the old rate")
+{
+}
+
+void
+FtOnOffSetRateTestCase::Sent (Ptr<const Packet> p)
+{
+  m_departures.push_back (Simulator::Now ());
+}
+
+std::vector<Time>
+FtOnOffSetRateTestCase::Run (uint32_t burstSize, const std::vector<std::pair<Time, DataRate> > &changes)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  FtIpv4StaticRoutingHelper routingHelper;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (routingHelper);
+  internet.Install (nodes);
+  SimpleNetDeviceHelper simple;
+  Ipv4AddressHelper addresses ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = addresses.Assign (simple.Install (nodes));
+
+  Ptr<FtOnOffApplication> app = CreateObject<FtOnOffApplication> ();
+  app->SetAttribute ("Remote", AddressValue (InetSocketAddress (interfaces.GetAddress (1), 9)));
+  app->SetAttribute ("PacketSize", UintegerValue (1000));
+  app->SetAttribute ("DataRate", DataRateValue (DataRate ("8000bps")));
+  app->SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=100]"));
+  app->SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  app->SetAttribute ("BurstSize", UintegerValue (burstSize));
+  app->TraceConnectWithoutContext ("Tx", MakeCallback (&FtOnOffSetRateTestCase::Sent, this));
+  nodes.Get (0)->AddApplication (app);
+  app->SetStartTime (Seconds (0));
+  for (uint32_t i = 0; i < changes.size (); i++)
+    {
+      Simulator::Schedule (changes[i].first, &FtOnOffApplication::SetRate, app, changes[i].second);
+    }
+
+  m_departures.clear ();
+  Simulator::Stop (Seconds (3.9));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return m_departures;
+}
+
+void
+FtOnOffSetRateTestCase::Check (const std::string &phase, const std::vector<Time> &departures,
+                               const double *expected, uint32_t n)
+{
+  NS_TEST_ASSERT_MSG_EQ (departures.size (), n, phase << ": wrong number of packets");
+  for (uint32_t i = 0; i < departures.size () && i < n; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (departures[i].GetSeconds (), expected[i], 1e-6,
+                                 phase << ": wrong departure time of packet " << i);
+    }
+}
+
+void
+FtOnOffSetRateTestCase::DoRun (void)
+{
+  std::vector<std::pair<Time, DataRate> > changes;
+  changes.push_back (std::make_pair (Seconds (2.5), DataRate ("16000bps")));
+  // the remaining 4000 bits take 0.25 s at the new rate
+  const double doubled[] = { 1, 2, 2.75, 3.25, 3.75 };
+  Check ("8000 to 16000 bit/s", Run (1, changes), doubled, 5);
+
+  // in burst mode the train drawn at the old rate is drawn again
+  Check ("8000 to 16000 bit/s in trains of 4", Run (4, changes), doubled, 5);
+
+  // paused from 2.5 s to 3 s, the 4000 bits are kept over the pause
+  changes[0].second = DataRate ("0bps");
+  changes.push_back (std::make_pair (Seconds (3), DataRate ("16000bps")));
+  const double paused[] = { 1, 2, 3.25, 3.75 };
+  Check ("8000 to 0 to 16000 bit/s", Run (1, changes), paused, 4);
+  Check ("8000 to 0 to 16000 bit/s in trains of 4", Run (4, changes), paused, 4);
 }
 
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
@@ -60,9 +1366,17 @@ FtInternetTestSuite::FtInternetTestSuite ()
   : TestSuite ("ft-internet", UNIT)
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
-  AddTestCase (new FtInternetTestCase1, TestCase::QUICK);
+  AddTestCase (new FtRoutingTableTestCase, TestCase::QUICK);
+  AddTestCase (new FtPrefixTrieTestCase, TestCase::QUICK);
+  AddTestCase (new FtFlowRoutesTestCase, TestCase::QUICK);
+  AddTestCase (new FtFreezeTestCase, TestCase::QUICK);
+  AddTestCase (new FtFlowRangeTestCase, TestCase::QUICK);
+  AddTestCase (new FtRouteSnapshotTestCase, TestCase::QUICK);
+  AddTestCase (new FtSourceRoutingTestCase, TestCase::QUICK);
+  AddTestCase (new FtLabelSwitchingTestCase, TestCase::QUICK);
+  AddTestCase (new FtBackupRouteTestCase, TestCase::QUICK);
+  AddTestCase (new FtOnOffSetRateTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
 static FtInternetTestSuite ftInternetTestSuite;
-